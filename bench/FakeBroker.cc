@@ -0,0 +1,552 @@
+/**
+ * @file FakeBroker.cc
+ * @brief Local kafka broker stand-in class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "FakeBroker.hh"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Kafka API keys served.
+ */
+const int16_t PRODUCE = 0;
+const int16_t METADATA = 3;
+const int16_t API_VERSIONS = 18;
+
+/**
+ * Big endian reader of a request.
+ */
+class Reader {
+public:
+    Reader(const string& data, size_t offset) : data_(data), offset_(offset) {
+    }
+
+    size_t offset() const {
+        return offset_;
+    }
+
+    int16_t int16() {
+        return static_cast<int16_t>(unsigned64(2));
+    }
+
+    int32_t int32() {
+        return static_cast<int32_t>(unsigned64(4));
+    }
+
+    int64_t int64() {
+        return static_cast<int64_t>(unsigned64(8));
+    }
+
+    string str() {
+        int16_t length = int16();
+
+        if (length < 0) return string();
+
+        need(length);
+        offset_ += length;
+
+        return data_.substr(offset_ - length, length);
+    }
+
+    void skip(size_t length) {
+        need(length);
+        offset_ += length;
+    }
+
+private:
+    const string& data_;
+    size_t offset_;
+
+    void need(size_t length) {
+        if (data_.length() - offset_ < length) throw out_of_range("Truncated request");
+    }
+
+    uint64_t unsigned64(size_t length) {
+        need(length);
+
+        uint64_t value = 0;
+
+        for (size_t i = 0; i < length; ++i) {
+            value = (value << 8) | static_cast<unsigned char>(data_[offset_++]);
+        }
+
+        return value;
+    }
+};
+
+/**
+ * Big endian writer of a response.
+ */
+class Writer {
+public:
+    string& data() {
+        return data_;
+    }
+
+    void int16(int16_t value) {
+        put(static_cast<uint16_t>(value), 2);
+    }
+
+    void int32(int32_t value) {
+        put(static_cast<uint32_t>(value), 4);
+    }
+
+    void int64(int64_t value) {
+        put(static_cast<uint64_t>(value), 8);
+    }
+
+    void str(const string& value) {
+        int16(value.length());
+        data_ += value;
+    }
+
+private:
+    string data_;
+
+    void put(uint64_t value, size_t length) {
+        for (size_t i = length; i > 0; --i) {
+            data_ += static_cast<char>((value >> ((i - 1) * 8)) & 0xFF);
+        }
+    }
+};
+
+} // namespace
+
+/*-- constructors/destructor --*/
+
+FakeBroker::FakeBroker() :
+    latency_(0), errorRate_(0), errorCode_(6), partitions_(1), listenFd_(-1), port_(0),
+    random_(2013), messages_(0), bytes_(0), errors_(0), stopped_(false) {
+}
+
+FakeBroker::~FakeBroker() {
+    stop();
+}
+
+/*-- getters/setters --*/
+
+void FakeBroker::latency(int latency) {
+    latency_ = latency;
+}
+
+void FakeBroker::errorRate(double errorRate) {
+    errorRate_ = errorRate;
+}
+
+void FakeBroker::errorCode(int16_t errorCode) {
+    errorCode_ = errorCode;
+}
+
+void FakeBroker::partitions(int32_t partitions) {
+    partitions_ = partitions;
+}
+
+int FakeBroker::port() const {
+    return port_;
+}
+
+uint64_t FakeBroker::messages() const {
+    return messages_.load();
+}
+
+uint64_t FakeBroker::bytes() const {
+    return bytes_.load();
+}
+
+uint64_t FakeBroker::errors() const {
+    return errors_.load();
+}
+
+/*-- methods --*/
+
+void FakeBroker::start() {
+    sockaddr_in address;
+    socklen_t length = sizeof(address);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+
+    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (listenFd_ < 0
+        || bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+        || listen(listenFd_, SOMAXCONN) < 0
+        || getsockname(listenFd_, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+
+        throw runtime_error(string("Fake broker listen failed: ") + strerror(errno));
+    }
+
+    fcntl(listenFd_, F_SETFL, O_NONBLOCK);
+    port_ = ntohs(address.sin_port);
+
+    thread_ = thread(&FakeBroker::run, this);
+}
+
+void FakeBroker::stop() {
+    stopped_ = true;
+
+    if (thread_.joinable()) thread_.join();
+
+    for (map<int, Connection>::iterator it = connections_.begin(); it != connections_.end(); ++it) {
+        close(it->first);
+    }
+
+    connections_.clear();
+    responses_.clear();
+
+    if (listenFd_ >= 0) close(listenFd_);
+    listenFd_ = -1;
+}
+
+void FakeBroker::run() {
+    vector<pollfd> fds;
+    vector<int> failed;
+    char buffer[64 * 1024];
+
+    while (!stopped_) {
+
+        /* Wait for requests, or the next delayed response */
+
+        fds.clear();
+
+        pollfd listener = { listenFd_, POLLIN, 0 };
+        fds.push_back(listener);
+
+        for (map<int, Connection>::iterator it = connections_.begin(); it != connections_.end(); ++it) {
+            pollfd connection = { it->first, short(POLLIN | (it->second.output.empty() ? 0 : POLLOUT)), 0 };
+            fds.push_back(connection);
+        }
+
+        int timeout = 100;
+
+        if (!responses_.empty()) {
+            int64_t wait = chrono::duration_cast<chrono::milliseconds>(
+                responses_.front().due - Clock::now()).count();
+
+            timeout = static_cast<int>(max<int64_t>(0, min<int64_t>(wait, timeout)));
+        }
+
+        if (poll(&fds[0], fds.size(), timeout) < 0 && errno != EINTR) break;
+
+        /* New connections */
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+
+            while ((fd = accept(listenFd_, NULL, NULL)) >= 0) {
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                connections_[fd];
+            }
+        }
+
+        /* Requests and pending output */
+
+        failed.clear();
+
+        for (size_t i = 1; i < fds.size(); ++i) {
+            map<int, Connection>::iterator it = connections_.find(fds[i].fd);
+
+            if (it == connections_.end()) continue;
+
+            if (fds[i].revents & POLLIN) {
+                ssize_t count = read(fds[i].fd, buffer, sizeof(buffer));
+
+                if (count == 0 || (count < 0 && errno != EAGAIN && errno != EINTR)) {
+                    failed.push_back(fds[i].fd);
+                    continue;
+                }
+
+                if (count > 0) it->second.input.append(buffer, count);
+
+                if (!process(fds[i].fd, it->second)) {
+                    failed.push_back(fds[i].fd);
+                    continue;
+                }
+            }
+            else if (fds[i].revents & (POLLERR | POLLHUP)) {
+                failed.push_back(fds[i].fd);
+                continue;
+            }
+
+            if (!send(fds[i].fd, it->second)) failed.push_back(fds[i].fd);
+        }
+
+        /* Delayed responses now due */
+
+        Clock::time_point now = Clock::now();
+
+        while (!responses_.empty() && responses_.front().due <= now) {
+            map<int, Connection>::iterator it = connections_.find(responses_.front().fd);
+
+            if (it != connections_.end()) {
+                it->second.output += responses_.front().data;
+
+                if (!send(it->first, it->second)) failed.push_back(it->first);
+            }
+
+            responses_.pop_front();
+        }
+
+        for (size_t i = 0; i < failed.size(); ++i) {
+            if (connections_.erase(failed[i]) > 0) close(failed[i]);
+        }
+    }
+}
+
+bool FakeBroker::process(int fd, Connection& connection) {
+    size_t offset = 0;
+
+    /* Size prefixed requests */
+
+    while (connection.input.length() - offset >= 4) {
+        Reader reader(connection.input, offset);
+        int32_t size = reader.int32();
+
+        if (size < 0) return false;
+
+        if (connection.input.length() - offset - 4 < static_cast<size_t>(size)) break;
+
+        try {
+            if (!answer(fd, connection.input.substr(offset + 4, size))) return false;
+        }
+        catch (const out_of_range&) {
+            return false;
+        }
+
+        offset += 4 + size;
+    }
+
+    connection.input.erase(0, offset);
+
+    return true;
+}
+
+bool FakeBroker::answer(int fd, const string& request) {
+    Reader reader(request, 0);
+
+    int16_t apiKey = reader.int16();
+    reader.int16(); // version, only 0 is announced
+    int32_t correlationId = reader.int32();
+    reader.str();   // client id
+
+    Writer response;
+    response.int32(0); // size, set below
+    response.int32(correlationId);
+
+    int delay = 0;
+
+    switch (apiKey) {
+    case PRODUCE: {
+        string body = produce(request, reader.offset());
+
+        if (body.empty()) return true; // acks=0
+
+        response.data() += body;
+        delay = latency_;
+        break;
+    }
+    case METADATA:
+        response.data() += metadata(request, reader.offset());
+        break;
+    case API_VERSIONS:
+        response.int16(0);
+        response.int32(3);
+        response.int16(PRODUCE); response.int16(0); response.int16(0);
+        response.int16(METADATA); response.int16(0); response.int16(0);
+        response.int16(API_VERSIONS); response.int16(0); response.int16(0);
+        break;
+    default:
+        return false;
+    }
+
+    string& data = response.data();
+    uint32_t size = htonl(data.length() - 4);
+    memcpy(&data[0], &size, 4);
+
+    // Keep the responses of a connection in order, behind delayed ones
+    bool queued = false;
+
+    for (size_t i = 0; i < responses_.size() && !queued; ++i) {
+        queued = responses_[i].fd == fd;
+    }
+
+    if (delay == 0 && !queued) {
+        connections_[fd].output += data;
+    }
+    else {
+        Response delayed = { Clock::now() + chrono::milliseconds(delay), fd, data };
+
+        if (!responses_.empty() && responses_.back().due > delayed.due) {
+            delayed.due = responses_.back().due;
+        }
+
+        responses_.push_back(delayed);
+    }
+
+    return true;
+}
+
+string FakeBroker::metadata(const string& request, size_t offset) {
+    Reader reader(request, offset);
+    vector<string> topics;
+
+    int32_t count = reader.int32();
+
+    for (int32_t i = 0; i < count; ++i) {
+        topics.push_back(reader.str());
+        topics_[topics.back()] = true;
+    }
+
+    if (count <= 0) {
+        for (map<string, bool>::iterator it = topics_.begin(); it != topics_.end(); ++it) {
+            topics.push_back(it->first);
+        }
+    }
+
+    Writer body;
+
+    // This broker, node 0
+    body.int32(1);
+    body.int32(0);
+    body.str("127.0.0.1");
+    body.int32(port_);
+
+    body.int32(topics.size());
+
+    for (size_t i = 0; i < topics.size(); ++i) {
+        body.int16(0);
+        body.str(topics[i]);
+        body.int32(partitions_);
+
+        for (int32_t partition = 0; partition < partitions_; ++partition) {
+            body.int16(0);
+            body.int32(partition);
+            body.int32(0); // leader
+            body.int32(1); // replicas
+            body.int32(0);
+            body.int32(1); // in sync replicas
+            body.int32(0);
+        }
+    }
+
+    return body.data();
+}
+
+string FakeBroker::produce(const string& request, size_t offset) {
+    Reader reader(request, offset);
+    uniform_real_distribution<double> uniform(0, 1);
+
+    int16_t acks = reader.int16();
+    reader.int32(); // timeout
+
+    Writer body;
+    int32_t topicCount = reader.int32();
+
+    body.int32(topicCount);
+
+    for (int32_t t = 0; t < topicCount; ++t) {
+        string topic = reader.str();
+        int32_t partitionCount = reader.int32();
+
+        topics_[topic] = true;
+        body.str(topic);
+        body.int32(partitionCount);
+
+        for (int32_t p = 0; p < partitionCount; ++p) {
+            int32_t partition = reader.int32();
+            int32_t setSize = reader.int32();
+
+            Reader set(request, reader.offset());
+            reader.skip(setSize);
+
+            body.int32(partition);
+
+            if (errorRate_ > 0 && uniform(random_) < errorRate_) {
+                errors_++;
+                body.int16(errorCode_);
+                body.int64(-1);
+                continue;
+            }
+
+            /* Message set: [offset size message]... */
+
+            int64_t messages = 0;
+
+            while (set.offset() + 12 <= reader.offset()) {
+                set.int64();
+                int32_t size = set.int32();
+
+                if (size < 0 || set.offset() + size > reader.offset()) break; // partial
+
+                set.skip(size);
+                ++messages;
+            }
+
+            int64_t& next = offsets_[make_pair(topic, partition)];
+
+            body.int16(0);
+            body.int64(next);
+
+            next += messages;
+            messages_ += messages;
+            bytes_ += setSize;
+        }
+    }
+
+    return acks == 0 ? string() : body.data();
+}
+
+bool FakeBroker::send(int fd, Connection& connection) {
+
+    while (!connection.output.empty()) {
+        ssize_t count = ::send(fd, connection.output.data(), connection.output.length(),
+            MSG_NOSIGNAL);
+
+        if (count < 0) return errno == EAGAIN || errno == EINTR;
+
+        connection.output.erase(0, count);
+    }
+
+    return true;
+}
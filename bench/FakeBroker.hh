@@ -0,0 +1,236 @@
+/**
+ * @file FakeBroker.hh
+ * @brief Local kafka broker stand-in class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_FAKE_BROKER_HH_
+#define _LOG2KAFKA_FAKE_BROKER_HH_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+
+/**
+ * In-process kafka broker stand-in for load tests.
+ *
+ * It listens on a loopback port and speaks just enough of the version 0
+ * protocol for a producer: metadata requests, answered with itself as the
+ * leader of every partition, and produce requests, whose message sets are
+ * counted and discarded. Acknowledgements can be delayed, and a fraction of
+ * the partitions can be answered with an error code.
+ */
+class FakeBroker {
+public:
+
+    FakeBroker();
+    virtual ~FakeBroker();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Set the delay of the produce acknowledgements, in milliseconds.
+     */
+    void latency(int latency);
+
+    /**
+     * Set the fraction of produce requests partitions answered with an error.
+     */
+    void errorRate(double errorRate);
+
+    /**
+     * Set the error code of the failed partitions, ej. 6 for
+     * NOT_LEADER_FOR_PARTITION.
+     */
+    void errorCode(int16_t errorCode);
+
+    /**
+     * Set the number of partitions of every topic.
+     */
+    void partitions(int32_t partitions);
+
+    /**
+     * Return the listening port, once started.
+     */
+    int port() const;
+
+    /**
+     * Return the messages accepted.
+     */
+    uint64_t messages() const;
+
+    /**
+     * Return the message set bytes accepted.
+     */
+    uint64_t bytes() const;
+
+    /**
+     * Return the partitions answered with an error.
+     */
+    uint64_t errors() const;
+
+    /*-- methods --*/
+
+    /**
+     * Listen on an ephemeral loopback port and serve in a new thread.
+     */
+    void start();
+
+    /**
+     * Stop serving and close all the connections.
+     */
+    void stop();
+
+private:
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * A client connection.
+     */
+    struct Connection {
+        std::string input;  /**< received bytes not yet processed */
+        std::string output; /**< response bytes not yet sent */
+    };
+
+    /**
+     * A response waiting for its delay.
+     */
+    struct Response {
+        Clock::time_point due;
+        int fd;
+        std::string data;
+    };
+
+    /*-- fields --*/
+
+    /**
+     * Acknowledgements delay, in milliseconds.
+     */
+    int latency_;
+
+    /**
+     * Fraction of partitions answered with an error, and the error.
+     */
+    double errorRate_;
+    int16_t errorCode_;
+
+    /**
+     * Partitions of every topic.
+     */
+    int32_t partitions_;
+
+    /**
+     * Listening socket and port.
+     */
+    int listenFd_;
+    int port_;
+
+    /**
+     * Open connections, by descriptor.
+     */
+    std::map<int, Connection> connections_;
+
+    /**
+     * Delayed responses, in due time order.
+     */
+    std::deque<Response> responses_;
+
+    /**
+     * Next offset of each partition.
+     */
+    std::map<std::pair<std::string, int32_t>, int64_t> offsets_;
+
+    /**
+     * Topics seen, reported by metadata requests for all topics.
+     */
+    std::map<std::string, bool> topics_;
+
+    /**
+     * Error injection random source.
+     */
+    std::mt19937 random_;
+
+    /**
+     * Statistics.
+     */
+    std::atomic<uint64_t> messages_;
+    std::atomic<uint64_t> bytes_;
+    std::atomic<uint64_t> errors_;
+
+    /**
+     * Server thread and its stop flag.
+     */
+    std::thread thread_;
+    std::atomic<bool> stopped_;
+
+    /*-- methods --*/
+
+    /**
+     * Server thread body.
+     */
+    void run();
+
+    /**
+     * Process the complete requests received in a connection.
+     *
+     * @return false if the connection must be closed
+     */
+    bool process(int fd, Connection& connection);
+
+    /**
+     * Answer a request, given without its size prefix. Returns false for
+     * unsupported requests.
+     */
+    bool answer(int fd, const std::string& request);
+
+    /**
+     * Build the body of a metadata response.
+     */
+    std::string metadata(const std::string& request, size_t offset);
+
+    /**
+     * Build the body of a produce response, or an empty string if no
+     * acknowledgement was requested.
+     */
+    std::string produce(const std::string& request, size_t offset);
+
+    /**
+     * Send what the connection output can take without blocking.
+     *
+     * @return false if the connection failed
+     */
+    bool send(int fd, Connection& connection);
+};
+
+#endif /* _LOG2KAFKA_FAKE_BROKER_HH_ */
@@ -0,0 +1,159 @@
+/**
+ * @file LineGenerator.cc
+ * @brief Synthetic log lines generator class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstdio>
+#include <stdexcept>
+
+#include "LineGenerator.hh"
+
+using namespace std;
+
+namespace {
+
+const char* const METHODS[] = { "GET", "GET", "GET", "POST" };
+
+const char* const PATHS[] = {
+    "/", "/index.html", "/web/guest/home", "/c/portal/login", "/images/logo.png",
+    "/api/jsonws/invoke", "/documents/10180/0/report.pdf"
+};
+
+const int STATUSES[] = { 200, 200, 200, 200, 304, 302, 404, 500 };
+
+const char* const REFERERS[] = { "-", "http://www.example.com/", "http://www.example.com/web/guest/home" };
+
+const char* const AGENTS[] = {
+    "Mozilla/5.0 (Windows NT 6.1; WOW64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/30.0.1599.69 Safari/537.36",
+    "Mozilla/5.0 (X11; Linux x86_64; rv:24.0) Gecko/20100101 Firefox/24.0",
+    "curl/7.29.0"
+};
+
+template <typename T, size_t N>
+size_t countOf(T (&)[N]) {
+    return N;
+}
+
+} // namespace
+
+/*-- constructors/destructor --*/
+
+LineGenerator::LineGenerator(const string& format, size_t length, size_t deviation,
+    unsigned seed) : length_(length, deviation), random_(seed), second_(0) {
+
+    if (format == "apache-combined") {
+        format_ = APACHE_COMBINED;
+    }
+    else if (format == "websphere") {
+        format_ = WEBSPHERE;
+    }
+    else if (format == "liferay") {
+        format_ = LIFERAY;
+    }
+    else {
+        throw invalid_argument("Unknown log format: " + format);
+    }
+}
+
+LineGenerator::~LineGenerator() {
+}
+
+/*-- methods --*/
+
+void LineGenerator::next(string& line) {
+    char buffer[512];
+
+    /* Timestamp, formatted once per second */
+
+    time_t now = time(NULL);
+
+    if (now != second_) {
+        struct tm utc;
+
+        gmtime_r(&now, &utc);
+        strftime(buffer, sizeof(buffer),
+            format_ == LIFERAY ? "%a %b %d %H:%M:%S UTC %Y" : "[%d/%b/%Y:%H:%M:%S +0000]", &utc);
+
+        second_ = now;
+        timestamp_ = buffer;
+    }
+
+    /* Fixed fields */
+
+    uint32_t r = random_();
+    int status = STATUSES[r % countOf(STATUSES)];
+
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u - - %s \"%s %s HTTP/1.1\" %d ",
+        10 + (r >> 8) % 200, (r >> 16) & 0xFF, (r >> 24) & 0xFF, 1 + r % 254,
+        timestamp_.c_str(), METHODS[(r >> 3) % countOf(METHODS)],
+        PATHS[(r >> 5) % countOf(PATHS)], status);
+
+    line = buffer;
+
+    if (status == 304) {
+        line += "-";
+    }
+    else {
+        snprintf(buffer, sizeof(buffer), "%u", unsigned(200 + random_() % 90000));
+        line += buffer;
+    }
+
+    line += " \"";
+    line += REFERERS[r % countOf(REFERERS)];
+    line += "\" \"";
+    line += AGENTS[(r >> 7) % countOf(AGENTS)];
+
+    /* Trailing fields, then pad the user agent up to the drawn length */
+
+    string trailer = "\"";
+
+    switch (format_) {
+    case WEBSPHERE:
+        snprintf(buffer, sizeof(buffer), " **%u/%u**", unsigned(random_() % 5),
+            unsigned(1000 + random_() % 9000000));
+        trailer += buffer;
+        break;
+    case LIFERAY:
+        snprintf(buffer, sizeof(buffer), " %08X%08X%08X%08X %u", unsigned(random_()),
+            unsigned(random_()), unsigned(random_()), unsigned(random_()),
+            unsigned(1 + random_() % 4000));
+        trailer += buffer;
+        break;
+    default:
+        break;
+    }
+
+    double length = length_(random_);
+
+    if (length > line.length() + trailer.length() + 1) {
+        size_t padding = static_cast<size_t>(length) - line.length() - trailer.length();
+
+        line += ' ';
+        line.append(padding - 1, 'x');
+    }
+
+    line += trailer;
+}
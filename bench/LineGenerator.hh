@@ -0,0 +1,99 @@
+/**
+ * @file LineGenerator.hh
+ * @brief Synthetic log lines generator class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_LINE_GENERATOR_HH_
+#define _LOG2KAFKA_LINE_GENERATOR_HH_
+
+#include <ctime>
+#include <random>
+#include <string>
+
+/**
+ * Generator of synthetic access log lines matching the bundled schemas
+ * (apache-combined, websphere and liferay in src/conf).
+ *
+ * Line lengths follow a normal distribution: the user agent field is
+ * padded, or the line left as is when shorter than the fixed fields.
+ */
+class LineGenerator {
+public:
+
+    /**
+     * Class constructor.
+     *
+     * @param format the schema name, ej. apache-combined
+     * @param length mean line length
+     * @param deviation line length standard deviation
+     * @param seed random source seed, for reproducible runs
+     */
+    LineGenerator(const std::string& format, size_t length, size_t deviation,
+        unsigned seed = 2013);
+    virtual ~LineGenerator();
+
+    /*-- methods --*/
+
+    /**
+     * Generate the next line.
+     */
+    void next(std::string& line);
+
+private:
+
+    /**
+     * Supported formats.
+     */
+    enum Format {
+        APACHE_COMBINED,
+        WEBSPHERE,
+        LIFERAY
+    };
+
+    /*-- fields --*/
+
+    Format format_;
+
+    /**
+     * Line length distribution.
+     */
+    std::normal_distribution<double> length_;
+
+    /**
+     * Random source.
+     */
+    std::mt19937 random_;
+
+    /**
+     * Timestamp of the current second, formatted.
+     */
+    time_t second_;
+    std::string timestamp_;
+};
+
+#endif /* _LOG2KAFKA_LINE_GENERATOR_HH_ */
@@ -0,0 +1,288 @@
+/**
+ * @file log2kafka_bench.cc
+ * @brief Hot paths microbenchmarks.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <avro/Generic.hh>
+#include <avro/Stream.hh>
+#include <boost/program_options.hpp>
+
+#include "ClientFacade.hh"
+#include "Options.hh"
+#include "Serializer.hh"
+
+using namespace std;
+
+namespace po = boost::program_options;
+
+/*
+ * Every benchmark iteration processes one line of a corpus, cycling through
+ * it, so the items/s rate is lines per second and bytes/s is the input
+ * throughput. The allocs counter is the heap allocations per line.
+ */
+
+/*-- allocations accounting --*/
+
+static atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+
+    void* p = malloc(size == 0 ? 1 : size);
+
+    if (p == NULL) throw bad_alloc();
+
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+namespace {
+
+/**
+ * The lines of a bundled corpus.
+ */
+struct Corpus {
+    vector<string> lines;
+    int64_t bytes;
+};
+
+/**
+ * Client facade whose messages never reach kafka.
+ */
+class StubFacade : public ClientFacade {
+protected:
+    int produce(rd_kafka_topic_t*, int32_t, char* payload, size_t, const void*, size_t,
+        void*) {
+
+        delete[] payload;
+        return 0;
+    }
+};
+
+/**
+ * Load (once) the corpus of a log format.
+ */
+const Corpus& corpus(const string& format) {
+    static map<string, Corpus> corpora;
+
+    Corpus& corpus = corpora[format];
+
+    if (corpus.lines.empty()) {
+        ifstream file((string(LOG2KAFKA_CORPUS_DIR) + "/" + format + ".log").c_str());
+        string line;
+
+        corpus.bytes = 0;
+
+        while (getline(file, line)) {
+            corpus.bytes += line.length();
+            corpus.lines.push_back(line);
+        }
+
+        if (corpus.lines.empty()) throw runtime_error("Missing corpus for " + format);
+    }
+
+    return corpus;
+}
+
+/**
+ * Return the schema file of a log format.
+ */
+string schema(const string& format) {
+    return string(LOG2KAFKA_CONF_DIR) + "/" + format + ".conf";
+}
+
+/**
+ * Set the per line and per byte rates, and the allocations per line.
+ */
+void report(benchmark::State& state, const Corpus& corpus, uint64_t allocated) {
+    int64_t lines = corpus.lines.size();
+    int64_t iterations = state.iterations();
+
+    state.SetItemsProcessed(iterations);
+    state.SetBytesProcessed(iterations / lines * corpus.bytes
+        + iterations % lines * (corpus.bytes / lines));
+    state.counters["allocs"] = benchmark::Counter(allocated, benchmark::Counter::kAvgIterations);
+}
+
+/*-- benchmarks --*/
+
+void mapperMap(benchmark::State& state, const string& format) {
+    const Corpus& lines = corpus(format);
+    Serializer serializer(schema(format));
+    avro::GenericDatum datum(serializer.mapper());
+    size_t next = 0;
+
+    uint64_t before = allocations.load();
+
+    for (auto _ : state) {
+        serializer.mapper().map(datum, lines.lines[next]);
+        if (++next == lines.lines.size()) next = 0;
+    }
+
+    report(state, lines, allocations.load() - before);
+}
+
+void serializerMap(benchmark::State& state, const string& format) {
+    const Corpus& lines = corpus(format);
+    Serializer serializer(schema(format));
+    avro::GenericDatum datum(serializer.mapper());
+    size_t next = 0;
+
+    uint64_t before = allocations.load();
+
+    // The built-in format parser, against mapperMap with the pattern
+    for (auto _ : state) {
+        serializer.map(lines.lines[next], datum);
+        if (++next == lines.lines.size()) next = 0;
+    }
+
+    report(state, lines, allocations.load() - before);
+}
+
+void serializerSerialize(benchmark::State& state, const string& format) {
+    const Corpus& lines = corpus(format);
+    Serializer serializer(schema(format));
+
+    // Map once, measure the encoding only
+    vector<avro::GenericDatum> data(lines.lines.size(), avro::GenericDatum(serializer.mapper()));
+
+    for (size_t i = 0; i < lines.lines.size(); ++i) {
+        serializer.map(lines.lines[i], data[i]);
+    }
+
+    size_t next = 0;
+
+    uint64_t before = allocations.load();
+
+    for (auto _ : state) {
+        auto_ptr<avro::OutputStream> output = avro::memoryOutputStream();
+        serializer.serialize(data[next], output);
+        benchmark::DoNotOptimize(output->byteCount());
+        if (++next == data.size()) next = 0;
+    }
+
+    report(state, lines, allocations.load() - before);
+}
+
+void serializerEncode(benchmark::State& state, const string& format) {
+    const Corpus& lines = corpus(format);
+    Serializer serializer(schema(format));
+    size_t next = 0;
+
+    uint64_t before = allocations.load();
+
+    // Mapping and encoding in a single pass, without datum
+    for (auto _ : state) {
+        auto_ptr<avro::OutputStream> output = avro::memoryOutputStream();
+        serializer.encode(lines.lines[next], output);
+        benchmark::DoNotOptimize(output->byteCount());
+        if (++next == lines.lines.size()) next = 0;
+    }
+
+    report(state, lines, allocations.load() - before);
+}
+
+void clientFacadeSendMessage(benchmark::State& state, const string& format) {
+    const Corpus& lines = corpus(format);
+    string schemaFile = schema(format);
+
+    // Nothing listens on the broker, the stub keeps messages from queueing
+    const char* argv[] = {"log2kafka_bench", "-b", "localhost:9", "-t", "bench", "-s",
+        schemaFile.c_str()};
+    po::variables_map vm;
+
+    Options::parseCommandLine(sizeof(argv) / sizeof(argv[0]), argv, vm);
+    po::notify(vm);
+
+    StubFacade facade;
+    facade.configure(vm);
+
+    Channel& channel = *facade.defaultChannel();
+    size_t next = 0;
+
+    uint64_t before = allocations.load();
+
+    for (auto _ : state) {
+        facade.sendMessage(channel, lines.lines[next]);
+        if (++next == lines.lines.size()) next = 0;
+    }
+
+    report(state, lines, allocations.load() - before);
+}
+
+} /* namespace */
+
+BENCHMARK_CAPTURE(mapperMap, apache_combined, string("apache-combined"));
+BENCHMARK_CAPTURE(mapperMap, websphere, string("websphere"));
+BENCHMARK_CAPTURE(mapperMap, liferay, string("liferay"));
+
+BENCHMARK_CAPTURE(serializerMap, apache_combined, string("apache-combined"));
+BENCHMARK_CAPTURE(serializerMap, websphere, string("websphere"));
+BENCHMARK_CAPTURE(serializerMap, liferay, string("liferay"));
+
+BENCHMARK_CAPTURE(serializerSerialize, apache_combined, string("apache-combined"));
+BENCHMARK_CAPTURE(serializerSerialize, websphere, string("websphere"));
+BENCHMARK_CAPTURE(serializerSerialize, liferay, string("liferay"));
+
+BENCHMARK_CAPTURE(serializerEncode, apache_combined, string("apache-combined"));
+BENCHMARK_CAPTURE(serializerEncode, websphere, string("websphere"));
+BENCHMARK_CAPTURE(serializerEncode, liferay, string("liferay"));
+
+BENCHMARK_CAPTURE(clientFacadeSendMessage, apache_combined, string("apache-combined"));
+BENCHMARK_CAPTURE(clientFacadeSendMessage, websphere, string("websphere"));
+BENCHMARK_CAPTURE(clientFacadeSendMessage, liferay, string("liferay"));
+
+BENCHMARK_MAIN();
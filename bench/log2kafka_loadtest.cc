@@ -0,0 +1,271 @@
+/**
+ * @file log2kafka_loadtest.cc
+ * @brief End to end load test against a local fake broker.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "ClientFacade.hh"
+#include "FakeBroker.hh"
+#include "LineGenerator.hh"
+#include "Metrics.hh"
+#include "Options.hh"
+#include "Util.hh"
+
+using namespace std;
+
+namespace po = boost::program_options;
+
+/*
+ * Generates lines at a fixed rate for a while, sends them through the
+ * ClientFacade to an in-process fake broker, waits for the deliveries and
+ * reports the throughput and the enqueue to acknowledgement latencies.
+ *
+ * Unrecognized options are passed to log2kafka, so the producer can be
+ * tuned as usual, ej. --kafka.queue.buffering.max.ms 50
+ *
+ * With --threads, each thread sends to its own topic, like the daemon
+ * workers, and is placed on the CPUs given by the --cpus.worker options, so
+ * runs with and without them show the effect of the placement.
+ */
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+double seconds(Clock::duration duration) {
+    return chrono::duration_cast<chrono::duration<double>>(duration).count();
+}
+
+double milliseconds(uint64_t nanoseconds) {
+    return nanoseconds / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    po::options_description description("Load test options");
+    po::variables_map vm;
+
+    description.add_options()
+        ("help,h", "produce help message")
+        ("format,f", po::value<string>()->default_value("apache-combined"),
+            "log format (apache-combined, websphere or liferay)")
+        ("rate,r", po::value<double>()->default_value(10000),
+            "lines per second, 0 for as fast as possible")
+        ("duration,d", po::value<double>()->default_value(10), "seconds generating lines")
+        ("threads", po::value<int>()->default_value(1),
+            "threads generating and sending lines, sharing the rate")
+        ("length", po::value<size_t>()->default_value(250), "mean line length")
+        ("length-deviation", po::value<size_t>()->default_value(50),
+            "line length standard deviation")
+        ("drain-timeout", po::value<int>()->default_value(30000),
+            "maximum wait for the deliveries at the end, in milliseconds")
+        ("broker.latency", po::value<int>()->default_value(0),
+            "broker acknowledgement delay, in milliseconds")
+        ("broker.error-rate", po::value<double>()->default_value(0),
+            "fraction of produce requests partitions failed by the broker")
+        ("broker.error-code", po::value<int>()->default_value(6),
+            "kafka error code of the failures (6 = NOT_LEADER_FOR_PARTITION)")
+        ("broker.partitions", po::value<int>()->default_value(1), "partitions per topic");
+
+    vector<string> forwarded;
+
+    try {
+        po::parsed_options parsed = po::command_line_parser(argc, argv)
+            .options(description).allow_unregistered().run();
+
+        po::store(parsed, vm);
+        po::notify(vm);
+
+        forwarded = po::collect_unrecognized(parsed.options, po::include_positional);
+    }
+    catch (const exception& e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (vm.count("help")) {
+        cout << "Usage: " << argv[0] << " [options] [log2kafka options]" << endl << description;
+        return EXIT_SUCCESS;
+    }
+
+    string format = vm["format"].as<string>();
+    double rate = vm["rate"].as<double>();
+
+    size_t threadCount = max(vm["threads"].as<int>(), 1);
+
+    try {
+        vector<LineGenerator> generators;
+
+        for (size_t i = 0; i < threadCount; ++i) {
+            generators.push_back(LineGenerator(format, vm["length"].as<size_t>(),
+                vm["length-deviation"].as<size_t>(), 2013 + i));
+        }
+
+        /* Broker */
+
+        FakeBroker broker;
+
+        broker.latency(vm["broker.latency"].as<int>());
+        broker.errorRate(vm["broker.error-rate"].as<double>());
+        broker.errorCode(vm["broker.error-code"].as<int>());
+        broker.partitions(vm["broker.partitions"].as<int>());
+        broker.start();
+
+        /* Producer, the forwarded options take precedence */
+
+        string brokerList = "127.0.0.1:" + to_string(broker.port());
+        string schema = string(LOG2KAFKA_CONF_DIR) + "/" + format + ".conf";
+        po::variables_map options;
+
+        vector<const char*> arguments(1, BUILD_NAME);
+        for (size_t i = 0; i < forwarded.size(); ++i) arguments.push_back(forwarded[i].c_str());
+
+        Options::parseCommandLine(arguments.size(), &arguments[0], options);
+
+        const char* defaults[] = { BUILD_NAME, "-b", brokerList.c_str(), "-t", "loadtest", "-s",
+            schema.c_str() };
+
+        Options::parseCommandLine(sizeof(defaults) / sizeof(defaults[0]), defaults, options);
+        po::notify(options);
+        Options::validate(options);
+
+        ClientFacade facade;
+        facade.configure(options);
+
+        /* Generate, each thread to its own channel */
+
+        vector<Channel*> channels(1, facade.defaultChannel());
+        vector<cpu_set_t> cpus;
+
+        for (size_t i = 1; i < threadCount; ++i) {
+            channels.push_back(facade.channel("loadtest-" + to_string(i), schema));
+        }
+
+        if (options.count("cpus.worker")) {
+            const vector<string>& lists = options["cpus.worker"].as<vector<string>>();
+
+            for (size_t i = 0; i < lists.size(); ++i) cpus.push_back(Util::cpuSet(lists[i]));
+        }
+
+        atomic<uint64_t> lines(0);
+        atomic<uint64_t> bytes(0);
+
+        double threadRate = rate / threadCount;
+
+        Clock::time_point start = Clock::now();
+        Clock::time_point end = start + chrono::duration_cast<Clock::duration>(
+            chrono::duration<double>(vm["duration"].as<double>()));
+
+        auto send = [&](size_t index) {
+            if (!cpus.empty()) Util::pinThread(cpus[index % cpus.size()]);
+
+            LineGenerator& generator = generators[index];
+            Channel& channel = *channels[index];
+
+            // Allocated after the placement, on the local node
+            string line;
+            uint64_t sent = 0;
+            uint64_t sentBytes = 0;
+            Clock::time_point now = Clock::now();
+
+            while (now < end) {
+                uint64_t due = threadRate > 0
+                    ? static_cast<uint64_t>(seconds(now - start) * threadRate) + 1 : sent + 1000;
+
+                while (sent < due) {
+                    generator.next(line);
+                    facade.sendMessage(channel, line);
+
+                    sentBytes += line.length();
+                    ++sent;
+                }
+
+                // Serve the delivery reports, waiting a little when ahead
+                facade.poll(threadRate > 0 ? 1 : 0);
+                now = Clock::now();
+            }
+
+            lines += sent;
+            bytes += sentBytes;
+        };
+
+        vector<thread> threads;
+
+        for (size_t i = 0; i < threadCount; ++i) threads.push_back(thread(send, i));
+        for (size_t i = 0; i < threadCount; ++i) threads[i].join();
+
+        Clock::time_point generated = Clock::now();
+
+        /* Drain */
+
+        int remaining = facade.flush(vm["drain-timeout"].as<int>());
+
+        Clock::time_point drained = Clock::now();
+
+        /* Report */
+
+        double sending = seconds(generated - start);
+        double total = seconds(drained - start);
+
+        cout << fixed << setprecision(1)
+             << "format           " << format << "\n"
+             << "threads          " << threadCount << "\n"
+             << "lines            " << lines << "\n"
+             << "lines/s          " << lines / sending << "\n"
+             << "bytes/s          " << bytes / sending << "\n"
+             << "delivered        " << Metrics::total(Metrics::MESSAGES_DELIVERED) << "\n"
+             << "delivered/s      " << Metrics::total(Metrics::MESSAGES_DELIVERED) / total << "\n"
+             << "delivery failed  " << Metrics::total(Metrics::DELIVERY_FAILURES) << "\n"
+             << "produce refused  " << Metrics::total(Metrics::PRODUCE_FAILURES) << "\n"
+             << "parse failures   " << Metrics::total(Metrics::PARSE_FAILURES) << "\n"
+             << "undelivered      " << remaining << "\n"
+             << "drain seconds    " << seconds(drained - generated) << "\n"
+             << setprecision(3)
+             << "latency p50 ms   " << milliseconds(Metrics::quantile(Metrics::DELIVERY, 0.5)) << "\n"
+             << "latency p99 ms   " << milliseconds(Metrics::quantile(Metrics::DELIVERY, 0.99)) << "\n"
+             << "latency p999 ms  " << milliseconds(Metrics::quantile(Metrics::DELIVERY, 0.999)) << "\n"
+             << "broker messages  " << broker.messages() << "\n"
+             << "broker bytes     " << broker.bytes() << "\n"
+             << "broker errors    " << broker.errors() << endl;
+
+        return remaining == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const exception& e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,449 @@
+/**
+ * @file ArchiveReader.cc
+ * @brief Compressed log files line reader class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "ArchiveReader.hh"
+#include "MemoryBudget.hh"
+
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr ArchiveReader::logger(Logger::getLogger("ArchiveReader"));
+#endif
+
+namespace {
+
+/**
+ * Decompressed chunk size.
+ */
+const size_t CHUNK_SIZE = 1024 * 1024;
+
+/**
+ * Chunks queued per unit.
+ */
+const size_t QUEUED_CHUNKS = 4;
+
+/**
+ * Compressed size of the zstd frame groups.
+ */
+const size_t UNIT_SIZE = 8 * 1024 * 1024;
+
+/**
+ * Units started ahead of the one being read, per thread.
+ */
+const size_t LOOKAHEAD = 2;
+
+/**
+ * Wait for the memory budget between two admission attempts, in ms.
+ */
+const int BUDGET_WAIT = 10;
+
+const unsigned char GZIP_MAGIC[] = { 0x1F, 0x8B };
+const unsigned char ZSTD_MAGIC[] = { 0x28, 0xB5, 0x2F, 0xFD };
+
+inline bool startsWith(const char* data, size_t size, const unsigned char* magic, size_t length) {
+    return size >= length && memcmp(data, magic, length) == 0;
+}
+
+} // namespace
+
+/*-- constructors/destructor --*/
+
+ArchiveReader::ArchiveReader(const vector<string>& paths, size_t threads, size_t capacity) :
+    LineReader(-1, capacity), started_(0), current_(0), offset_(0), stopped_(false),
+    lookahead_(LOOKAHEAD * max<size_t>(threads, 1)) {
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        open(paths[i]);
+    }
+
+    for (size_t i = 0; i < max<size_t>(threads, 1); ++i) {
+        threads_.push_back(thread(&ArchiveReader::work, this));
+    }
+}
+
+ArchiveReader::~ArchiveReader() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopped_ = true;
+    }
+
+    consumed_.notify_all();
+
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        threads_[i].join();
+    }
+
+    for (size_t i = 0; i < files_.size(); ++i) {
+        munmap(const_cast<char*>(files_[i].data), files_[i].size);
+    }
+
+    size_t queued = chunk_.size();
+
+    for (size_t i = 0; i < units_.size(); ++i) {
+        for (size_t c = 0; c < units_[i]->chunks.size(); ++c) queued += units_[i]->chunks[c].size();
+    }
+
+    MemoryBudget::release(MemoryBudget::INPUT, queued);
+}
+
+/*-- methods --*/
+
+ssize_t ArchiveReader::receive(char* buffer, size_t size) {
+
+    // The chunk being read is only used by the reading thread
+    while (offset_ == chunk_.size()) {
+        unique_lock<mutex> lock(mutex_);
+
+        if (current_ == units_.size()) return 0;
+
+        Unit& unit = *units_[current_];
+
+        produced_.wait(lock, [&unit] { return !unit.chunks.empty() || unit.done; });
+
+        if (!unit.chunks.empty()) {
+            MemoryBudget::release(MemoryBudget::INPUT, chunk_.size());
+
+            chunk_.swap(unit.chunks.front());
+            unit.chunks.pop_front();
+            offset_ = 0;
+        }
+        else {
+            ++current_;
+        }
+
+        lock.unlock();
+        consumed_.notify_all();
+    }
+
+    size_t count = min(size, chunk_.size() - offset_);
+
+    memcpy(buffer, chunk_.data() + offset_, count);
+    offset_ += count;
+
+    return count;
+}
+
+void ArchiveReader::open(const string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) throw runtime_error("Unable to open input file " + path + ": " + strerror(errno));
+
+    struct stat status;
+
+    if (fstat(fd, &status) < 0) {
+        close(fd);
+        throw runtime_error("Unable to read input file " + path + ": " + strerror(errno));
+    }
+
+    File file;
+    file.path = path;
+    file.size = status.st_size;
+    file.data = NULL;
+
+    if (file.size == 0) {
+        close(fd);
+        return;
+    }
+
+    void* data = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) throw runtime_error("Unable to map input file " + path + ": " + strerror(errno));
+
+    madvise(data, file.size, MADV_SEQUENTIAL);
+    file.data = static_cast<const char*>(data);
+
+    if (startsWith(file.data, file.size, GZIP_MAGIC, sizeof(GZIP_MAGIC))) {
+        file.format = GZIP;
+    }
+    else if (startsWith(file.data, file.size, ZSTD_MAGIC, sizeof(ZSTD_MAGIC))) {
+        file.format = ZSTD;
+    }
+    else {
+        file.format = PLAIN;
+    }
+
+    files_.push_back(file);
+
+    /* Units: gzip members can not be found without inflating them, so a
+     * gzip file is a single unit. Zstd frames carry their size and are
+     * grouped in units of about UNIT_SIZE. */
+
+    vector<size_t> bounds(1, 0);
+
+#ifdef HAVE_ZSTD
+    if (file.format == ZSTD) {
+        for (size_t position = 0; position < file.size;) {
+            size_t frame = ZSTD_findFrameCompressedSize(file.data + position, file.size - position);
+
+            if (ZSTD_isError(frame)) break; // the decoder will report it
+
+            position += frame;
+
+            if (position - bounds.back() >= UNIT_SIZE && position < file.size) {
+                bounds.push_back(position);
+            }
+        }
+    }
+#endif
+
+    bounds.push_back(file.size);
+
+    for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+        unique_ptr<Unit> unit(new Unit());
+
+        unit->file = files_.size() - 1;
+        unit->begin = bounds[i];
+        unit->end = bounds[i + 1];
+        unit->last = i + 2 == bounds.size();
+        unit->done = false;
+
+        units_.push_back(move(unit));
+    }
+
+    LOG_DEBUG("Input file " << path << ": " << file.size << " bytes, "
+        << bounds.size() - 1 << " units");
+}
+
+void ArchiveReader::work() {
+    unique_lock<mutex> lock(mutex_);
+
+    for (;;) {
+        consumed_.wait(lock, [this] {
+            return stopped_ || started_ == units_.size()
+                || started_ < current_ + lookahead_;
+        });
+
+        if (stopped_ || started_ == units_.size()) return;
+
+        Unit& unit = *units_[started_++];
+
+        lock.unlock();
+
+        try {
+            decode(unit);
+        }
+        catch (exception& e) {
+            LOG_ERROR("Input file " << files_[unit.file].path << ": " << e.what());
+        }
+
+        lock.lock();
+        unit.done = true;
+        produced_.notify_all();
+    }
+}
+
+void ArchiveReader::decode(Unit& unit) {
+    const File& file = files_[unit.file];
+    const char* data = file.data + unit.begin;
+    size_t size = unit.end - unit.begin;
+
+    string chunk(CHUNK_SIZE, '\0');
+    size_t used = 0;
+    char last = '\n';
+    bool cancelled = false;
+
+    // Each full chunk is queued, and replaced by a new one
+    auto flush = [&]() -> bool {
+        if (used == 0) return true;
+
+        last = chunk[used - 1];
+        chunk.resize(used);
+        used = 0;
+
+        bool queued = emit(unit, chunk);
+
+        chunk.assign(CHUNK_SIZE, '\0');
+        return queued;
+    };
+
+    // A unit cut short by bad data still ends its partial last line, so it
+    // isn't joined with the first line of the next unit or file
+    auto terminate = [&]() {
+        if (flush() && last != '\n') {
+            chunk.assign(1, '\n');
+            emit(unit, chunk);
+        }
+    };
+
+    if (file.format == GZIP) {
+        z_stream stream;
+
+        memset(&stream, 0, sizeof(stream));
+
+        if (inflateInit2(&stream, 15 + 16) != Z_OK) throw runtime_error("Unable to initialize zlib");
+
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+
+        size_t consumed = 0;
+        int result;
+
+        for (;;) {
+            stream.avail_in = static_cast<uInt>(min<size_t>(size - consumed, 1 << 30));
+            stream.next_out = reinterpret_cast<Bytef*>(&chunk[used]);
+            stream.avail_out = static_cast<uInt>(CHUNK_SIZE - used);
+
+            uInt available = stream.avail_in;
+
+            result = inflate(&stream, Z_NO_FLUSH);
+            consumed += available - stream.avail_in;
+            used = CHUNK_SIZE - stream.avail_out;
+
+            if (result == Z_STREAM_END) {
+                // Multi-member file, ej. concatenated or written by pigz
+                if (consumed == size || (data[consumed] & 0xFF) != GZIP_MAGIC[0]) break;
+
+                inflateReset(&stream);
+            }
+            else if (result != Z_OK && (result != Z_BUF_ERROR || stream.avail_out > 0)) {
+                break; // corrupt, or no progress possible at the end of the data
+            }
+
+            if (used == CHUNK_SIZE && !flush()) {
+                cancelled = true;
+                break;
+            }
+        }
+
+        inflateEnd(&stream);
+
+        if (result != Z_STREAM_END && !cancelled) {
+            terminate();
+            throw runtime_error(result == Z_BUF_ERROR ? "truncated gzip data" : "corrupt gzip data");
+        }
+    }
+    else if (file.format == ZSTD) {
+#ifdef HAVE_ZSTD
+        ZSTD_DStream* stream = ZSTD_createDStream();
+
+        ZSTD_initDStream(stream);
+
+        ZSTD_inBuffer input = { data, size, 0 };
+        size_t result;
+
+        // Output left in the decoder when the input ends fills the chunk
+        for (;;) {
+            ZSTD_outBuffer output = { &chunk[0], CHUNK_SIZE, used };
+
+            result = ZSTD_decompressStream(stream, &output, &input);
+            used = output.pos;
+
+            if (ZSTD_isError(result)) break;
+
+            if (used == CHUNK_SIZE) {
+                if (!flush()) {
+                    cancelled = true;
+                    break;
+                }
+            }
+            else if (input.pos == input.size) {
+                break;
+            }
+        }
+
+        ZSTD_freeDStream(stream);
+
+        if (!cancelled && result != 0) {
+            terminate();
+            throw runtime_error(ZSTD_isError(result) ?
+                string("corrupt zstd data: ") + ZSTD_getErrorName(result) : "truncated zstd data");
+        }
+#else
+        throw runtime_error("zstd input files not supported by this build");
+#endif
+    }
+    else {
+        for (size_t position = 0; position < size; position += CHUNK_SIZE) {
+            used = min(CHUNK_SIZE, size - position);
+            memcpy(&chunk[0], data + position, used);
+
+            if (!flush()) return;
+        }
+    }
+
+    if (cancelled || !flush()) return;
+
+    // The last line of a file without a line terminator ends with the file
+    if (unit.last && last != '\n') {
+        chunk.assign(1, '\n');
+        emit(unit, chunk);
+    }
+}
+
+bool ArchiveReader::emit(Unit& unit, string& chunk) {
+
+    // Units ahead wait for the memory budget, the one being read can not
+    while (!MemoryBudget::acquire(MemoryBudget::INPUT, chunk.size())) {
+        {
+            lock_guard<mutex> lock(mutex_);
+
+            if (stopped_) return false;
+
+            if (current_ < units_.size() && units_[current_].get() == &unit) {
+                MemoryBudget::charge(MemoryBudget::INPUT, chunk.size());
+                break;
+            }
+        }
+
+        MemoryBudget::wait(BUDGET_WAIT);
+    }
+
+    unique_lock<mutex> lock(mutex_);
+
+    consumed_.wait(lock, [this, &unit] { return stopped_ || unit.chunks.size() < QUEUED_CHUNKS; });
+
+    if (stopped_) {
+        MemoryBudget::release(MemoryBudget::INPUT, chunk.size());
+        return false;
+    }
+
+    unit.chunks.push_back(string());
+    unit.chunks.back().swap(chunk);
+
+    lock.unlock();
+    produced_.notify_all();
+
+    return true;
+}
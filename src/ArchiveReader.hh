@@ -0,0 +1,195 @@
+/**
+ * @file ArchiveReader.hh
+ * @brief Compressed log files line reader class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_ARCHIVE_READER_HH_
+#define _LOG2KAFKA_ARCHIVE_READER_HH_
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.hh"
+#include "LineReader.hh"
+
+/**
+ * Line reader over a list of log files, plain or compressed with gzip or
+ * zstd (if built with libzstd), ej. rotated logs being replayed.
+ *
+ * The files are split in units decompressed in parallel by a pool of
+ * threads: each file, and each group of independent frames of zstd files.
+ * The units are read back in order, so the lines keep the order of the
+ * files. Each unit queues a bounded number of decompressed chunks, and only
+ * a few units ahead of the one being read are started, so memory is
+ * bounded however large the files are. The queued chunks are charged to
+ * the input stage of the MemoryBudget, the units ahead waiting for it.
+ */
+class ArchiveReader: public LineReader {
+public:
+
+    /**
+     * Class constructor. Open the files and start the threads.
+     *
+     * @param paths the files to read, in order
+     * @param threads the decompression threads
+     * @param capacity the buffer size, which is also the maximum line length
+     * @throw std::runtime_error if a file can not be opened
+     */
+    ArchiveReader(const std::vector<std::string>& paths, size_t threads, size_t capacity);
+    virtual ~ArchiveReader();
+
+protected:
+
+    /*-- methods --*/
+
+    /**
+     * Copy decompressed data, waiting for it if needed.
+     *
+     * @return the bytes copied, or 0 after the last file
+     */
+    virtual ssize_t receive(char* buffer, size_t size);
+
+private:
+
+    /**
+     * File formats.
+     */
+    enum Format {
+        PLAIN,
+        GZIP,
+        ZSTD
+    };
+
+    /**
+     * A mapped file.
+     */
+    struct File {
+        std::string path;
+        const char* data;
+        size_t size;
+        Format format;
+    };
+
+    /**
+     * A range of a file decompressed by a single thread.
+     */
+    struct Unit {
+        size_t file;
+        size_t begin;
+        size_t end;
+        bool last;                      /**< last unit of the file */
+        std::deque<std::string> chunks; /**< decompressed and not yet read */
+        bool done;                      /**< all its chunks are queued */
+    };
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /*-- fields --*/
+
+    /**
+     * Mapped files.
+     */
+    std::vector<File> files_;
+
+    /**
+     * Units of all the files, in order.
+     */
+    std::vector<std::unique_ptr<Unit>> units_;
+
+    /**
+     * Next unit to start, and unit being read.
+     */
+    size_t started_;
+    size_t current_;
+
+    /**
+     * Chunk being read, and the position in it.
+     */
+    std::string chunk_;
+    size_t offset_;
+
+    /**
+     * Whether the reader is being destroyed.
+     */
+    bool stopped_;
+
+    /**
+     * Units started ahead of the one being read.
+     */
+    size_t lookahead_;
+
+    /**
+     * Units and chunks lock, and conditions.
+     */
+    std::mutex mutex_;
+    std::condition_variable produced_;
+    std::condition_variable consumed_;
+
+    /**
+     * Decompression threads.
+     */
+    std::vector<std::thread> threads_;
+
+    /*-- methods --*/
+
+    /**
+     * Map a file and split it in units.
+     */
+    void open(const std::string& path);
+
+    /**
+     * Decompression thread body.
+     */
+    void work();
+
+    /**
+     * Decompress a unit.
+     */
+    void decode(Unit& unit);
+
+    /**
+     * Queue a chunk of a unit, waiting for room.
+     *
+     * @return false if the reader is being destroyed
+     */
+    bool emit(Unit& unit, std::string& chunk);
+};
+
+#endif /* _LOG2KAFKA_ARCHIVE_READER_HH_ */
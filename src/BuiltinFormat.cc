@@ -0,0 +1,530 @@
+/**
+ * @file BuiltinFormat.cc
+ * @brief Built-in log formats parsers class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cstring>
+
+#include "BuiltinFormat.hh"
+#include "Mapper.hh"
+
+using namespace std;
+
+namespace {
+
+typedef BuiltinFormat::Span Span;
+
+/*
+ * Character classes of the patterns, without locale lookups.
+ */
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline bool isWord(char c) {
+    return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+inline const char* skipDigits(const char* p, const char* end) {
+    while (p < end && isDigit(*p)) ++p;
+    return p;
+}
+
+inline const char* skipWord(const char* p, const char* end) {
+    while (p < end && isWord(*p)) ++p;
+    return p;
+}
+
+/*
+ * Scanners. Each one matches its part of the entry at p, stores the bounds
+ * of its field (if it captures one) and continues with the rest of the
+ * layout, so a lazy scanner can try its next candidate when the rest does
+ * not match.
+ */
+
+/** \\s+ */
+struct Blanks {
+    static const size_t captures = 0;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        const char* q = p;
+
+        while (q < end && isBlank(*q)) ++q;
+
+        return q > p && Next::parse(q, end, out);
+    }
+};
+
+/** \\s */
+struct Blank {
+    static const size_t captures = 0;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        return p < end && isBlank(*p) && Next::parse(p + 1, end, out);
+    }
+};
+
+/** (\\d+.\\d+.\\d+.\\d+) */
+struct Address {
+    static const size_t captures = 1;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        const char* q = p;
+
+        for (int i = 0; i < 4; ++i) {
+            if (i > 0 && q++ == end) return false;
+
+            const char* digits = q;
+
+            q = skipDigits(q, end);
+            if (q == digits) return false;
+        }
+
+        *out = Span(p, q);
+
+        return Next::parse(q, end, out + 1);
+    }
+};
+
+/** ([\\-\\w]+) */
+struct Word {
+    static const size_t captures = 1;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        const char* q = p;
+
+        while (q < end && (isWord(*q) || *q == '-')) ++q;
+        if (q == p) return false;
+
+        *out = Span(p, q);
+
+        return Next::parse(q, end, out + 1);
+    }
+};
+
+/** (\\w+) */
+struct Name {
+    static const size_t captures = 1;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        const char* q = skipWord(p, end);
+
+        if (q == p) return false;
+
+        *out = Span(p, q);
+
+        return Next::parse(q, end, out + 1);
+    }
+};
+
+/** (\\d+) */
+struct Number {
+    static const size_t captures = 1;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        const char* q = skipDigits(p, end);
+
+        if (q == p) return false;
+
+        *out = Span(p, q);
+
+        return Next::parse(q, end, out + 1);
+    }
+};
+
+/** (\\-|\\d+) */
+struct Size {
+    static const size_t captures = 1;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        const char* q = p < end && *p == '-' ? p + 1 : skipDigits(p, end);
+
+        if (q == p) return false;
+
+        *out = Span(p, q);
+
+        return Next::parse(q, end, out + 1);
+    }
+};
+
+/** \\[(\\d+\\/\\S+\\/\\d+:\\d+:\\d+:\\d+\\s+[-+]{0,1}\\d+)\\] */
+struct Bracketed {
+    static const size_t captures = 1;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        if (p == end || *p != '[') return false;
+
+        // The date and time can not span blanks, so the first ones end them
+        const char* begin = p + 1;
+        const char* time = begin;
+
+        while (time < end && !isBlank(*time)) ++time;
+
+        if (!isTime(begin, time)) return false;
+
+        // Time zone
+        const char* q = time;
+
+        while (q < end && isBlank(*q)) ++q;
+        if (q == time) return false;
+
+        if (q < end && (*q == '-' || *q == '+')) ++q;
+
+        const char* zone = q;
+
+        q = skipDigits(q, end);
+        if (q == zone || q == end || *q != ']') return false;
+
+        *out = Span(begin, q);
+
+        return Next::parse(q + 1, end, out + 1);
+    }
+
+    /**
+     * Return true if the text is \\d+\\/\\S+\\/\\d+:\\d+:\\d+:\\d+, without blanks.
+     * The time is matched backwards from the end, as the \\S+ month may
+     * contain any of its characters.
+     */
+    static bool isTime(const char* begin, const char* end) {
+        const char* q = end;
+
+        for (int i = 0; i < 4; ++i) {
+            const char* digits = q;
+
+            while (q > begin && isDigit(q[-1])) --q;
+            if (q == digits || q == begin) return false;
+
+            if (*--q != (i < 3 ? ':' : '/')) return false;
+        }
+
+        // Day, and a month of one character at least
+        const char* day = skipDigits(begin, q);
+
+        return day > begin && *day == '/' && q - day > 1;
+    }
+};
+
+/** (\\w{3}\\s\\w{3}\\s\\d{2}\\s\\d+:\\d+:\\d+\\s\\w+\\s\\d{4}) */
+struct Date {
+    static const size_t captures = 1;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        const char* q = p;
+
+        // Day and month names, day of month
+        if (end - q < 11) return false;
+
+        for (int i = 0; i < 3; ++i) if (!isWord(*q++)) return false;
+        if (!isBlank(*q++)) return false;
+        for (int i = 0; i < 3; ++i) if (!isWord(*q++)) return false;
+        if (!isBlank(*q++)) return false;
+        if (!isDigit(*q++) || !isDigit(*q++)) return false;
+        if (!isBlank(*q++)) return false;
+
+        // Time
+        for (int i = 0; i < 3; ++i) {
+            if (i > 0 && (q == end || *q++ != ':')) return false;
+
+            const char* digits = q;
+
+            q = skipDigits(q, end);
+            if (q == digits) return false;
+        }
+
+        // Time zone and year
+        if (q == end || !isBlank(*q++)) return false;
+
+        const char* zone = q;
+
+        q = skipWord(q, end);
+        if (q == zone || end - q < 5 || !isBlank(*q++)) return false;
+
+        for (int i = 0; i < 4; ++i) if (!isDigit(*q++)) return false;
+
+        *out = Span(p, q);
+
+        return Next::parse(q, end, out + 1);
+    }
+};
+
+/** \\"(.*?)\\s+HTTP\\/\\d+\\.\\d+\\" */
+struct Request {
+    static const size_t captures = 1;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        if (p == end || *p != '"') return false;
+
+        const char* begin = p + 1;
+
+        // The shortest request followed by the protocol and the rest
+        for (const char* q = begin; q < end; ++q) {
+            if (!isBlank(*q)) continue;
+
+            const char* r = q;
+
+            while (r < end && isBlank(*r)) ++r;
+
+            const char* after = protocol(r, end);
+
+            if (after != NULL) {
+                *out = Span(begin, q);
+                if (Next::parse(after, end, out + 1)) return true;
+            }
+
+            q = r - 1;
+        }
+
+        return false;
+    }
+
+    /**
+     * Match HTTP/<major>.<minor>" and return where it ends, or NULL.
+     */
+    static const char* protocol(const char* p, const char* end) {
+        if (end - p < 5 || memcmp(p, "HTTP/", 5) != 0) return NULL;
+
+        const char* q = p + 5;
+        const char* digits = q;
+
+        q = skipDigits(q, end);
+        if (q == digits || q == end || *q++ != '.') return NULL;
+
+        digits = q;
+        q = skipDigits(q, end);
+        if (q == digits || q == end || *q != '"') return NULL;
+
+        return q + 1;
+    }
+};
+
+/** \\"(.*?)\\" */
+struct Quoted {
+    static const size_t captures = 1;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        if (p == end || *p != '"') return false;
+
+        const char* begin = p + 1;
+        const char* q = begin;
+
+        // The shortest value followed by the rest
+        while ((q = static_cast<const char*>(memchr(q, '"', end - q))) != NULL) {
+            *out = Span(begin, q);
+            if (Next::parse(q + 1, end, out + 1)) return true;
+            ++q;
+        }
+
+        return false;
+    }
+};
+
+/** (\\*\\*\\d+/\\d+\\*\\*) */
+struct Elapsed {
+    static const size_t captures = 1;
+
+    template <typename Next>
+    static bool parse(const char* p, const char* end, Span* out) {
+        if (end - p < 2 || p[0] != '*' || p[1] != '*') return false;
+
+        const char* q = p + 2;
+        const char* digits = q;
+
+        q = skipDigits(q, end);
+        if (q == digits || q == end || *q++ != '/') return false;
+
+        digits = q;
+        q = skipDigits(q, end);
+        if (q == digits || end - q < 2 || q[0] != '*' || q[1] != '*') return false;
+
+        q += 2;
+        *out = Span(p, q);
+
+        return Next::parse(q, end, out + 1);
+    }
+};
+
+/*
+ * A format layout, its scanners in order. The whole entry must match.
+ */
+
+template <typename... Scanners>
+struct Layout;
+
+template <>
+struct Layout<> {
+    static const size_t fields = 0;
+
+    static bool parse(const char* p, const char* end, Span*) {
+        return p == end;
+    }
+};
+
+template <typename Scanner, typename... Rest>
+struct Layout<Scanner, Rest...> {
+    static const size_t fields = Scanner::captures + Layout<Rest...>::fields;
+
+    static bool parse(const char* p, const char* end, Span* out) {
+        return Scanner::template parse<Layout<Rest...>>(p, end, out);
+    }
+};
+
+/*
+ * The formats of the shipped configuration files, as their patterns.
+ */
+
+typedef Layout<Address, Blanks, Word, Blanks, Word, Blanks, Bracketed, Blanks, Request,
+    Blanks, Number, Blanks, Size, Blanks, Quoted, Blanks, Quoted> ApacheCombined;
+
+typedef Layout<Address, Blanks, Word, Blanks, Word, Blanks, Bracketed, Blanks, Request,
+    Blanks, Number, Blanks, Size, Blanks, Quoted, Blanks, Quoted, Blanks, Elapsed> WebSphere;
+
+typedef Layout<Address, Blanks, Word, Blanks, Word, Blanks, Date, Blanks, Request,
+    Blanks, Number, Blanks, Size, Blanks, Quoted, Blanks, Quoted, Blank, Name,
+    Blanks, Number> Liferay;
+
+/**
+ * Parser of a format layout.
+ */
+template <typename Format>
+class LayoutFormat: public BuiltinFormat {
+public:
+
+    static_assert(Format::fields <= MAX_FIELDS, "Too many fields for a built-in format");
+
+    explicit LayoutFormat(const char* name) :
+        name_(name) {
+    }
+
+    const char* name() const {
+        return name_;
+    }
+
+    size_t fields() const {
+        return Format::fields;
+    }
+
+    bool parse(const string& entry, Span* fields) const {
+        const char* begin = entry.data();
+
+        return Format::parse(begin, begin + entry.length(), fields);
+    }
+
+private:
+
+    const char* name_;
+};
+
+/**
+ * Append an Avro long (zig-zag, variable length).
+ */
+inline void appendLong(string& buffer, int64_t value) {
+    uint64_t n = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+
+    while (n >= 0x80) {
+        buffer += static_cast<char>((n & 0x7f) | 0x80);
+        n >>= 7;
+    }
+
+    buffer += static_cast<char>(n);
+}
+
+} // namespace
+
+/*-- constructors/destructor --*/
+
+BuiltinFormat::~BuiltinFormat() {
+}
+
+/*-- static methods --*/
+
+BuiltinFormat* BuiltinFormat::create(const string& name) {
+
+    if (name == "apache-combined") return new LayoutFormat<ApacheCombined>("apache-combined");
+    if (name == "websphere") return new LayoutFormat<WebSphere>("websphere");
+    if (name == "liferay") return new LayoutFormat<Liferay>("liferay");
+
+    return NULL;
+}
+
+/*-- methods --*/
+
+bool BuiltinFormat::encodes(const avro::NodePtr& root) const {
+
+    if (root->type() != avro::AVRO_RECORD || root->leaves() != fields()) return false;
+
+    for (size_t i = 0; i < root->leaves(); ++i) {
+        if (root->leafAt(i)->type() != avro::AVRO_STRING) return false;
+    }
+
+    return true;
+}
+
+bool BuiltinFormat::map(avro::GenericDatum& datum, const string& entry) const {
+    Span spans[MAX_FIELDS];
+
+    if (!parse(entry, spans)) return false;
+
+    if (datum.type() == avro::AVRO_RECORD) {
+        avro::GenericRecord& record = datum.value<avro::GenericRecord>();
+        size_t count = min(record.fieldCount(), fields());
+
+        for (size_t i = 0; i < count; ++i) {
+            Mapper::convert(record.fieldAt(i), spans[i].first, spans[i].second);
+        }
+    }
+
+    return true;
+}
+
+bool BuiltinFormat::encode(const string& entry, string& buffer) const {
+    Span spans[MAX_FIELDS];
+
+    if (!parse(entry, spans)) return false;
+
+    for (size_t i = 0; i < fields(); ++i) {
+        appendLong(buffer, spans[i].second - spans[i].first);
+        buffer.append(spans[i].first, spans[i].second);
+    }
+
+    return true;
+}
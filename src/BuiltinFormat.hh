@@ -0,0 +1,128 @@
+/**
+ * @file BuiltinFormat.hh
+ * @brief Built-in log formats parsers class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_BUILTIN_FORMAT_HH_
+#define _LOG2KAFKA_BUILTIN_FORMAT_HH_
+
+#include <string>
+#include <utility>
+
+#include <avro/Generic.hh>
+#include <avro/Node.hh>
+
+/**
+ * Parser of one of the log formats shipped in the configuration directory,
+ * selected with the <b>format</b> directive (ej. <b>format :
+ * apache-combined</b>) instead of matching the pattern.
+ *
+ * The fields layout and delimiters of each format are fixed at compile
+ * time: each format is a sequence of hand written scanners, instantiated
+ * as a single parsing routine that only backtracks where the pattern it
+ * replaces is lazy (quoted fields).
+ *
+ * When the schema is the format record, all of its fields strings, entries
+ * can be encoded straight from the parsed fields, without building a
+ * datum.
+ */
+class BuiltinFormat {
+public:
+
+    /**
+     * Bounds of a field in the entry text.
+     */
+    typedef std::pair<const char*, const char*> Span;
+
+    /**
+     * Maximum fields of a built-in format.
+     */
+    static const size_t MAX_FIELDS = 16;
+
+    virtual ~BuiltinFormat();
+
+    /*-- static methods --*/
+
+    /**
+     * Return a new parser of a built-in format.
+     *
+     * @param name the format name: <b>apache-combined</b>,
+     *             <b>websphere</b> or <b>liferay</b>
+     * @return the parser, or NULL if the format is unknown
+     */
+    static BuiltinFormat* create(const std::string& name);
+
+    /*-- getters/setters --*/
+
+    /**
+     * Return the format name.
+     */
+    virtual const char* name() const = 0;
+
+    /**
+     * Return the number of fields of an entry.
+     */
+    virtual size_t fields() const = 0;
+
+    /*-- methods --*/
+
+    /**
+     * Split an entry into its fields.
+     *
+     * @param[in] entry the entry text
+     * @param[out] fields the fields bounds, #fields() of them
+     * @return false if the entry is not in the format
+     */
+    virtual bool parse(const std::string& entry, Span* fields) const = 0;
+
+    /**
+     * Return whether a schema is the format record: #fields() fields, all
+     * of them strings.
+     */
+    bool encodes(const avro::NodePtr& root) const;
+
+    /**
+     * Set the record fields of an entry, converting them to the field
+     * types. Fields beyond the format ones keep their value.
+     *
+     * @return false if the entry is not in the format
+     */
+    bool map(avro::GenericDatum& datum, const std::string& entry) const;
+
+    /**
+     * Append the Avro binary encoding of an entry, as a record of the
+     * format fields, all of them strings (see #encodes()).
+     *
+     * @param entry the entry text
+     * @param buffer the buffer to append to
+     * @return false if the entry is not in the format
+     */
+    bool encode(const std::string& entry, std::string& buffer) const;
+};
+
+#endif /* _LOG2KAFKA_BUILTIN_FORMAT_HH_ */
@@ -0,0 +1,401 @@
+/**
+ * @file Channel.cc
+ * @brief Topic channel class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Channel.hh"
+#include "Metrics.hh"
+
+namespace po = boost::program_options;
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr Channel::logger(Logger::getLogger("Channel"));
+#endif
+
+/*-- constructors/destructor --*/
+
+Channel::Channel() :
+    kafkaTopic_(NULL), partition_(RD_KAFKA_PARTITION_UA), destination_(0), shard_(0),
+    output_(Serializer::AVRO), pending_(NULL), bareRecords_(false), format_(LINE) {
+}
+
+Channel::~Channel() {
+    delete pending_.load();
+
+    if (kafkaTopic_ != NULL) rd_kafka_topic_destroy(kafkaTopic_);
+}
+
+/*-- getters/setters --*/
+
+void Channel::topic(std::string topic) {
+    vector<string> fields;
+
+    boost::split(fields, topic, boost::is_any_of(":"));
+
+    if (fields.size() >= 2) {
+        try {
+            partition_ = boost::lexical_cast<int>(fields[1]);
+        }
+        catch (exception& e) {
+            LOG_WARN("Invalid partition value: " << fields[1] << ". Defaulting to: " << partition_);
+        }
+    }
+
+    topic_ = fields[0];
+}
+
+const string& Channel::topic() const {
+    return topic_;
+}
+
+int Channel::partition() const {
+    return partition_;
+}
+
+rd_kafka_topic_t* Channel::kafkaTopic() const {
+    return kafkaTopic_;
+}
+
+void Channel::destination(size_t destination) {
+    destination_ = destination;
+}
+
+size_t Channel::destination() const {
+    return destination_;
+}
+
+void Channel::shard(size_t shard) {
+    shard_ = shard;
+}
+
+size_t Channel::shard() const {
+    return shard_;
+}
+
+void Channel::serializer(const string& configFile) {
+    unique_ptr<Serializer> serializer(new Serializer(configFile));
+
+    this->schema_ = configFile;
+    this->output_ = serializer->output();
+    this->serializer_ = move(serializer);
+}
+
+const shared_ptr<Serializer>& Channel::serializer() const {
+    return serializer_;
+}
+
+void Channel::bareRecords(bool bareRecords) {
+    bareRecords_ = bareRecords;
+
+    if (serializer_ && output_ == Serializer::AVRO) {
+        serializer_->output(bareRecords_ ? Serializer::DATUM : Serializer::AVRO);
+    }
+}
+
+void Channel::format(Format format) {
+    format_ = format;
+    bindEnvelope();
+}
+
+Channel::Format Channel::format() const {
+    return format_;
+}
+
+const MultilineRule* Channel::multiline() const {
+    return multiline_.get();
+}
+
+bool Channel::isRaw() const {
+    return !serializer_;
+}
+
+/*-- methods --*/
+
+bool Channel::reload() {
+
+    if (schema_.empty()) return true; // raw mode, nothing to reload
+
+    unique_ptr<Serializer> serializer;
+
+    try {
+        serializer.reset(new Serializer(schema_));
+    }
+    catch (const exception& e) {
+        LOG_ERROR("Invalid schema configuration " << schema_ << ": " << e.what()
+            << ". Keeping the current one");
+        return false;
+    }
+
+    // The pattern is compiled by the constructor, the schema must be too
+    if (!serializer->loaded() || serializer->mapper().root()->type() != avro::AVRO_RECORD) {
+        LOG_ERROR("No valid record schema in " << schema_ << ". Keeping the current one");
+        return false;
+    }
+
+    if (!serializer->ready()) {
+        LOG_ERROR("No pattern, split or JSON input in " << schema_ << ". Keeping the current one");
+        return false;
+    }
+
+    if (serializer->output() != output_) {
+        LOG_ERROR("The output of " << schema_ << " can not change without a restart."
+            << " Keeping the current one");
+        return false;
+    }
+
+    // The readers joining the lines hold their own copy of the rule
+    string start;
+    string continuation;
+
+    serializer->directive("multiline.start", start);
+    serializer->directive("multiline.continuation", continuation);
+
+    if (start != multilineStart_ || continuation != multilineContinuation_) {
+        LOG_WARN("The multiline directives of " << schema_ << " can not change without a restart."
+            << " Keeping the current ones");
+    }
+
+    // A previous reload not yet taken is superseded
+    delete pending_.exchange(serializer.release(), memory_order_acq_rel);
+
+    LOG_INFO("Reloaded " << schema_ << " for topic " << topic_);
+    return true;
+}
+
+void Channel::bindEnvelope() {
+    envelopeFields_.clear();
+
+    if (format_ != SYSLOG || !serializer_) return;
+
+    for (size_t field = 0; field < SyslogMessage::FIELD_COUNT; ++field) {
+        size_t index;
+
+        if (serializer_->mapper().fieldIndex(SyslogMessage::FIELD_NAMES[field], index)) {
+            envelopeFields_.push_back(make_pair(field, index));
+        }
+    }
+}
+
+void Channel::adopt() {
+    unique_ptr<Serializer> serializer(pending_.exchange(NULL, memory_order_acq_rel));
+
+    if (!serializer) return;
+
+    if (bareRecords_ && output_ == Serializer::AVRO) serializer->output(Serializer::DATUM);
+
+    if (throttle_) throttle_->bind(serializer->mapper());
+
+    // The previous serializer is released here, unless a sink still holds it
+    serializer_ = move(serializer);
+    bindEnvelope();
+}
+
+void Channel::configure(const po::variables_map& vm, rd_kafka_t* kafkaClient,
+    rd_kafka_topic_conf_t* kafkaTopicConfig) {
+
+    configureThrottle(vm);
+    configureMultiline(vm);
+
+    failures_.summaryInterval(vm["failures.summary-interval"].as<int>());
+
+    if (kafkaClient != NULL) {
+        kafkaTopic_ = rd_kafka_topic_new(kafkaClient, topic_.data(), kafkaTopicConfig);
+    }
+    else if (kafkaTopicConfig != NULL) {
+        rd_kafka_topic_conf_destroy(kafkaTopicConfig);
+    }
+}
+
+void Channel::configureThrottle(const po::variables_map& vm) {
+
+    if (!vm.count("throttle.rate") && !vm.count("sampling.threshold")) return;
+
+    unique_ptr<Throttle> throttle(new Throttle());
+
+    if (vm.count("throttle.rate")) {
+        throttle->rate(vm["throttle.rate"].as<int>());
+    }
+
+    if (vm.count("throttle.burst")) {
+        throttle->burst(vm["throttle.burst"].as<int>());
+    }
+
+    if (vm.count("sampling.threshold")) {
+        throttle->samplingThreshold(vm["sampling.threshold"].as<int>());
+    }
+
+    throttle->samplingRate(vm["sampling.rate"].as<int>());
+    throttle->samplingField(vm["sampling.field"].as<string>());
+    throttle->keepField(vm["sampling.keep-field"].as<string>(), vm["sampling.keep-min"].as<int>());
+
+    if (serializer_) {
+        throttle->bind(serializer_->mapper());
+    }
+
+    this->throttle_ = move(throttle);
+}
+
+void Channel::configureMultiline(const po::variables_map& vm) {
+    string start;
+    string continuation;
+
+    if (serializer_) {
+        serializer_->directive("multiline.start", multilineStart_);
+        serializer_->directive("multiline.continuation", multilineContinuation_);
+    }
+
+    if (!serializer_ || (!serializer_->directive("multiline.start", start)
+        && !serializer_->directive("multiline.continuation", continuation))) {
+
+        if (vm.count("multiline.start")) start = vm["multiline.start"].as<string>();
+        if (vm.count("multiline.continuation")) continuation = vm["multiline.continuation"].as<string>();
+    }
+
+    if (start.empty() && continuation.empty()) return;
+
+    unique_ptr<MultilineRule> multiline(new MultilineRule());
+
+    if (!start.empty()) {
+        multiline->start(start);
+    }
+    else {
+        multiline->continuation(continuation);
+    }
+
+    multiline->maxLines(max(vm["multiline.max-lines"].as<int>(), 1));
+    multiline->maxBytes(max(vm["multiline.max-bytes"].as<int>(), 1));
+    multiline->timeout(vm["multiline.timeout"].as<int>());
+
+    this->multiline_ = move(multiline);
+}
+
+bool Channel::encode(const string& entry, auto_ptr<avro::OutputStream>& data,
+    string& failure) {
+
+    bool sendRawMessage = false;
+    failure.clear();
+
+    /* Switch to a reloaded configuration between entries */
+
+    if (pending_.load(memory_order_relaxed) != NULL) adopt();
+
+    /* Apply rate limit and sampling */
+
+    bool sampled = true;
+
+    if (throttle_) {
+        // The rate limit is a hard cap, lines over it are not even mapped
+        if (!throttle_->acquire()) {
+            drop(true);
+            return false;
+        }
+
+        sampled = throttle_->sample();
+    }
+
+    if (serializer_) { // Use serialization mode
+        LOG_DEBUG("Schema defined. Using serialization mode");
+
+        try {
+            // Built-in formats are encoded in a single pass when no datum is
+            // needed, to check the keep field or to record the sample rate
+            if (format_ == LINE && sampled && !(throttle_ && throttle_->records())) {
+                Metrics::Timer timer(Metrics::SERIALIZE);
+
+                if (serializer_->encode(entry, data)) return true;
+            }
+
+            avro::GenericDatum datum(serializer_->mapper());
+
+            { // Mapping stage
+                Metrics::Timer timer(Metrics::MAP);
+
+                if (format_ == SYSLOG) {
+                    SyslogMessage message;
+
+                    if (!SyslogParser::parse(entry, message)) {
+                        throw invalid_argument("Invalid syslog header");
+                    }
+
+                    serializer_->map(message.body, datum);
+
+                    for (size_t i = 0; i < envelopeFields_.size(); ++i) {
+                        serializer_->mapper().assign(datum, envelopeFields_[i].second,
+                            message.fields[envelopeFields_[i].first]);
+                    }
+                }
+                else {
+                    serializer_->map(entry, datum);
+                }
+            }
+
+            if (throttle_) {
+                // Error entries are kept even when sampled out
+                if (!sampled && !throttle_->keep(datum)) {
+                    drop(false);
+                    return false;
+                }
+
+                throttle_->record(serializer_->mapper(), datum);
+            }
+
+            Metrics::Timer timer(Metrics::SERIALIZE);
+            serializer_->serialize(datum, data);
+        }
+        catch (exception& e) {
+            sendRawMessage = true;
+            failure = e.what();
+            failures_.count(serializer_->mapper().pattern(), e.what());
+            Metrics::count(Metrics::PARSE_FAILURES);
+        }
+    }
+    else { // Use raw mode
+        sendRawMessage = true;
+        LOG_DEBUG("No schema defined. Using raw mode");
+    }
+
+    if (sendRawMessage && !sampled) {
+        drop(false);
+        return false;
+    }
+
+    return true;
+}
+
+void Channel::drop(bool limited) {
+
+    if (limited) {
+        LOG_TRACE("Message entry dropped by rate limit");
+        throttle_->limit();
+        Metrics::count(Metrics::ENTRIES_THROTTLED);
+    }
+    else {
+        throttle_->discard();
+        Metrics::count(Metrics::ENTRIES_SAMPLED);
+    }
+}
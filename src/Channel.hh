@@ -0,0 +1,337 @@
+/**
+ * @file Channel.hh
+ * @brief Topic channel class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifndef _LOG2KAFKA_CHANNEL_HH_
+#define _LOG2KAFKA_CHANNEL_HH_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+extern "C" {
+#include <librdkafka/rdkafka.h>
+}
+
+#include "MultilineRule.hh"
+#include "ParseFailures.hh"
+#include "Serializer.hh"
+#include "SyslogParser.hh"
+#include "Throttle.hh"
+
+/**
+ * A log source route to a kafka topic.
+ *
+ * Holds everything that is specific to one target topic: the topic handle
+ * and partition, the schema serializer, the rate limiting and the failure
+ * counters. All the channels of a process share the producer handle owned
+ * by ClientFacade, or are written to files by FileSink.
+ *
+ * A channel is not thread safe: all its entries must be sent from the same
+ * thread.
+ */
+class Channel {
+public:
+
+    /**
+     * Format of the entries received.
+     */
+    enum Format {
+        LINE,  /**< the entry is the text mapped by the pattern */
+        SYSLOG /**< syslog frames, the pattern is applied to the body */
+    };
+
+    Channel();
+    virtual ~Channel();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Set the topic and possibly the partition.
+     *
+     * The format expected of the string is
+     * <b>&lt;topic_name&gt;[:&lt;partition&gt;]</b>.
+     * If omitted, a random partition will be selected.
+     *
+     * @pre The given topic value is not blank (empty or all spaces).
+     */
+    void topic(std::string topic);
+
+    /**
+     * Return the topic name.
+     */
+    const std::string& topic() const;
+
+    /**
+     * Return the topic partition.
+     */
+    int partition() const;
+
+    /**
+     * Return the kafka topic handle.
+     */
+    rd_kafka_topic_t* kafkaTopic() const;
+
+    /**
+     * Set the index of the channel destination in its client facade.
+     */
+    void destination(size_t destination);
+
+    /**
+     * Return the index of the channel destination in its client facade.
+     */
+    size_t destination() const;
+
+    /**
+     * Set the index of the kafka client of the channel in its client
+     * facade.
+     */
+    void shard(size_t shard);
+
+    /**
+     * Return the index of the kafka client of the channel in its client
+     * facade.
+     */
+    size_t shard() const;
+
+    /**
+     * Configure an AVRO serializer instance according to the specified
+     * configuration file.
+     *
+     * @param configFile the file path to the schema configuration and mapping
+     */
+    void serializer(const std::string& configFile);
+
+    /**
+     * Return the serializer, or none in raw mode.
+     *
+     * Replaced by the thread sending the entries when the configuration is
+     * reloaded. Holders keep the previous one alive.
+     */
+    const std::shared_ptr<Serializer>& serializer() const;
+
+    /**
+     * Set whether Avro records are encoded alone, without the object
+     * container, for sinks that write it.
+     */
+    void bareRecords(bool bareRecords);
+
+    /**
+     * Set the format of the entries received.
+     *
+     * With SYSLOG, the envelope fields fill the record fields with the
+     * names in SyslogMessage::FIELD_NAMES, if the schema defines them after
+     * the fields mapped by the pattern.
+     */
+    void format(Format format);
+
+    /**
+     * Return the format of the entries received.
+     */
+    Format format() const;
+
+    /**
+     * Return the rule joining the lines of a record, or NULL if each line
+     * is a record.
+     */
+    const MultilineRule* multiline() const;
+
+    /*-- methods --*/
+
+    /**
+     * Prepare the topic handle, rate limiting and failure accounting.
+     *
+     * @param vm the program options
+     * @param kafkaClient the shared kafka client handle, or NULL if the
+     *                    channel is not written to kafka
+     * @param kafkaTopicConfig the topic configuration, owned by the channel
+     *                         from here on, or NULL
+     */
+    void configure(const boost::program_options::variables_map& vm,
+        rd_kafka_t* kafkaClient, rd_kafka_topic_conf_t* kafkaTopicConfig);
+
+    /**
+     * Turn an entry into the message payload for the channel topic.
+     *
+     * @param[in] entry the entry to encode
+     * @param[out] data the serialized entry, if not raw
+     * @param[out] failure the reason why the entry could not be serialized,
+     *                     or empty
+     * @return false if the entry was discarded by the rate limit or sampling
+     */
+    bool encode(const std::string& entry, std::auto_ptr<avro::OutputStream>& data,
+        std::string& failure);
+
+    /**
+     * Return true if entries are sent raw (no schema is defined).
+     */
+    bool isRaw() const;
+
+    /**
+     * Load the schema configuration file again, and publish the new
+     * serializer if valid. The thread sending the entries switches to it
+     * before its next entry, so a line is never mapped with half a
+     * configuration and the hot path takes no lock.
+     *
+     * Multiline directives are not reloaded, a warning tells when they
+     * changed. The output directive can not change, as the sink depends on
+     * it.
+     *
+     * @return false if the file is no longer valid, the current
+     *         serializer is kept
+     */
+    bool reload();
+
+private:
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /*-- fields --*/
+
+    /**
+     * The kafka topic handle.
+     */
+    rd_kafka_topic_t* kafkaTopic_;
+
+    /**
+     * Topic name.
+     */
+    std::string topic_;
+
+    /**
+     * Topic partition.
+     * (Default: -1, random selection)
+     */
+    int partition_;
+
+    /**
+     * Destination index in the client facade, carried by the messages.
+     */
+    size_t destination_;
+
+    /**
+     * Kafka client index in the client facade.
+     */
+    size_t shard_;
+
+    /**
+     * Serializer object to use.
+     */
+    std::shared_ptr<Serializer> serializer_;
+
+    /**
+     * Schema configuration file path, and its output directive.
+     */
+    std::string schema_;
+    Serializer::Output output_;
+
+    /**
+     * Reloaded serializer, not yet taken by the thread sending the entries.
+     */
+    std::atomic<Serializer*> pending_;
+
+    /**
+     * Whether Avro records are encoded without the object container.
+     */
+    bool bareRecords_;
+
+    /**
+     * Format of the entries received.
+     */
+    Format format_;
+
+    /**
+     * Envelope fields (SyslogMessage::Field) defined in the schema, with
+     * their record field index.
+     */
+    std::vector<std::pair<size_t, size_t>> envelopeFields_;
+
+    /**
+     * Rate limiting and sampling applied to the topic, if configured.
+     */
+    std::unique_ptr<Throttle> throttle_;
+
+    /**
+     * Rule joining the lines of a record, if configured.
+     */
+    std::unique_ptr<MultilineRule> multiline_;
+
+    /**
+     * Multiline directives of the schema configuration file in use, to
+     * warn when a reload changes them.
+     */
+    std::string multilineStart_;
+    std::string multilineContinuation_;
+
+    /**
+     * Counters of the entries that failed to serialize.
+     */
+    ParseFailures failures_;
+
+    /*-- methods --*/
+
+    /**
+     * Prepare the topic rate limiting and sampling, if requested.
+     */
+    void configureThrottle(const boost::program_options::variables_map& vm);
+
+    /**
+     * Prepare the multiline record rule, if requested in the schema
+     * configuration file or in the options. The schema file takes
+     * precedence.
+     */
+    void configureMultiline(const boost::program_options::variables_map& vm);
+
+    /**
+     * Find the syslog envelope fields in the schema.
+     */
+    void bindEnvelope();
+
+    /**
+     * Switch to the reloaded serializer.
+     */
+    void adopt();
+
+    /**
+     * Account for an entry dropped by the rate limit or by the sampler.
+     */
+    void drop(bool limited);
+};
+
+#endif /* _LOG2KAFKA_CHANNEL_HH_ */
@@ -25,11 +25,57 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+#include <unistd.h>
+
 #include "ClientFacade.hh"
+#include "MemoryBudget.hh"
+#include "Metrics.hh"
 
 namespace po = boost::program_options;
 using namespace std;
 
+namespace {
+
+/**
+ * The message opaque carries the destination index in its high 16 bits and
+ * the enqueue time, in microseconds, in the low 48 bits. The time wraps
+ * every 8 years, only differences are used.
+ */
+const int OPAQUE_TIME_BITS = 48;
+const uint64_t OPAQUE_TIME_MASK = (uint64_t(1) << OPAQUE_TIME_BITS) - 1;
+
+/**
+ * Destinations that fit in the message opaque. The last index is never
+ * assigned, it marks the messages that can not be spooled.
+ */
+const size_t MAX_DESTINATIONS = 0xFFFF;
+
+/**
+ * Wait for delivery reports between two memory budget admission attempts,
+ * in ms.
+ */
+const int BUDGET_WAIT = 10;
+
+uint64_t microseconds(Metrics::Clock::time_point time) {
+    return chrono::duration_cast<chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+void* messageOpaque(size_t destination, Metrics::Clock::time_point enqueued) {
+    uint64_t packed = (uint64_t(destination) << OPAQUE_TIME_BITS)
+        | (microseconds(enqueued) & OPAQUE_TIME_MASK);
+
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(packed));
+}
+
+} // namespace
+
 #ifdef _LOG2KAFKA_USE_LOG4CXX_
 using namespace log4cxx;
 
@@ -44,49 +90,74 @@ ClientFacade::ClientFacade() {
 }
 
 ClientFacade::~ClientFacade() {
-    flush();
-    rd_kafka_topic_destroy(kafkaTopic_);
-    rd_kafka_destroy(kafkaClient_);
+    shutdown();
+
+    channels_.clear();
+
+    for (size_t i = 0; i < replayTopics_.size(); ++i) rd_kafka_topic_destroy(replayTopics_[i].second);
+    for (size_t i = 0; i < deadLetterTopics_.size(); ++i) rd_kafka_topic_destroy(deadLetterTopics_[i]);
+
+    if (kafkaTopicConfig_ != NULL) rd_kafka_topic_conf_destroy(kafkaTopicConfig_);
+
+    for (size_t i = 0; i < kafkaClients_.size(); ++i) rd_kafka_destroy(kafkaClients_[i]);
 }
 
 void ClientFacade::messageKey(std::string messageKey) {
     this->messageKey_ = messageKey;
 }
 
-void ClientFacade::topic(std::string topic) {
-    vector<string> fields;
+Channel* ClientFacade::channel(const string& topic, const string& schema,
+    Channel::Format format) {
 
-    boost::split(fields, topic, boost::is_any_of(":"));
+    string id = topic + "," + schema + (format == Channel::SYSLOG ? ",syslog" : "");
+    lock_guard<mutex> lock(channelsMutex_);
 
-    if (fields.size() >= 2) {
-        try {
-            partition_ = boost::lexical_cast<int>(fields[1]);
-        }
-        catch (exception& e) {
-            LOG_WARN("Invalid partition value: " << fields[1] << ". Defaulting to: " << partition_);
-        }
+    for (size_t i = 0; i < channels_.size(); ++i) {
+        if (channels_[i].first == id) return channels_[i].second.get();
+    }
+
+    LOG_DEBUG("New channel for topic: " << topic << ", schema: " << schema);
+
+    unique_ptr<Channel> channel(new Channel());
+    channel->topic(topic);
+
+    if (!schema.empty()) {
+        LOG_DEBUG("Schema defined. Using AVRO serialization mode");
+        channel->serializer(schema);
     }
 
-    topic_ = fields[0];
+    // Channels are spread across the producers, all the messages of a
+    // channel go through the same one so their order is kept. A single
+    // channel (ej. the standard input) uses a single producer
+    channel->shard(channels_.size() % kafkaClients_.size());
+
+    channel->format(format);
+    channel->configure(options_, kafkaClients_[channel->shard()],
+        rd_kafka_topic_conf_dup(kafkaTopicConfig_));
+    channel->destination(destination(channel->topic(), channel->partition(), messageKey_));
+
+    channels_.push_back(make_pair(id, move(channel)));
+    return channels_.back().second.get();
 }
 
-void ClientFacade::serializer(const string& configFile) {
-    unique_ptr<Serializer> serializer(new Serializer(configFile));
-    this->serializer_ = move(serializer);
+Channel* ClientFacade::defaultChannel() const {
+    return defaultChannel_;
 }
 
 void ClientFacade::initDefaults() {
-    partition_ = RD_KAFKA_PARTITION_UA;
+    kafkaConfig_ = NULL;
+    kafkaTopicConfig_ = NULL;
+    defaultChannel_ = NULL;
+    shutdownTimeout_ = Constants::DEFAULT_SHUTDOWN_TIMEOUT;
+    startupTimeout_ = Constants::DEFAULT_STARTUP_TIMEOUT;
+    dropOverBudget_ = false;
+    shutdown_ = false;
 }
 
 void ClientFacade::configure(const boost::program_options::variables_map& vm) {
 
-    topic(vm["kafka.topic"].as<string>());
-
-    if (vm.count("schema")) {
-        LOG_DEBUG("Schema defined. Using AVRO serialization mode");
-        serializer(vm["schema"].as<string>());
-    }
+    options_ = vm;
+    started_ = chrono::steady_clock::now();
 
     /* Kafka configuration */
 
@@ -149,16 +220,68 @@ void ClientFacade::configure(const boost::program_options::variables_map& vm) {
      * delivery to broker, or upon failure to deliver to broker.
      */
     rd_kafka_conf_set_dr_cb(kafkaConfig_, ClientFacade::deliverCallback);
+    rd_kafka_conf_set_opaque(kafkaConfig_, this);
 
-    /* Create Kafka handle */
+    /* librdkafka statistics, emitted every kafka.statistics.interval.ms */
+    rd_kafka_conf_set_stats_cb(kafkaConfig_, ClientFacade::statisticsCallback);
 
-    if (!(kafkaClient_ = rd_kafka_new(RD_KAFKA_PRODUCER, kafkaConfig_, errstr, sizeof(errstr)))) {
-        throw ProducerCreationException(errstr);
+    /* Create Kafka handles, each with its own queue, thread and broker
+     * connections. The last one takes the configuration object */
+
+    int shards = max(vm.count("producer.shards") ? vm["producer.shards"].as<int>()
+        : Constants::DEFAULT_PRODUCER_SHARDS, 1);
+
+    for (int i = 0; i < shards; ++i) {
+        rd_kafka_conf_t* config = i + 1 < shards ? rd_kafka_conf_dup(kafkaConfig_) : kafkaConfig_;
+        rd_kafka_t* client = rd_kafka_new(RD_KAFKA_PRODUCER, config, errstr, sizeof(errstr));
+
+        if (client == NULL) {
+            if (config != kafkaConfig_) rd_kafka_conf_destroy(config);
+            throw ProducerCreationException(errstr);
+        }
+
+        kafkaClients_.push_back(client);
     }
 
-    /* Prepare Kafka Topic */
+    if (shards > 1) LOG_DEBUG("Producing through " << shards << " kafka handles");
+
+    /* Prepare Kafka Topics */
+
+    if (vm.count("dead-letter.topic")) {
+        const string& deadLetterTopic = vm["dead-letter.topic"].as<string>();
 
-    kafkaTopic_ = rd_kafka_topic_new(kafkaClient_, topic_.data(), kafkaTopicConfig_);
+        LOG_DEBUG("Entries failing serialization will be sent to topic: " << deadLetterTopic);
+
+        for (size_t i = 0; i < kafkaClients_.size(); ++i) {
+            deadLetterTopics_.push_back(rd_kafka_topic_new(kafkaClients_[i], deadLetterTopic.data(),
+                rd_kafka_topic_conf_dup(kafkaTopicConfig_)));
+        }
+
+        // Their failure reason key is not known when spooled
+        destination(deadLetterTopic, RD_KAFKA_PARTITION_UA, "");
+    }
+    else {
+        destination("", RD_KAFKA_PARTITION_UA, "");
+    }
+
+    /* Shutdown, replaying what the previous run could not deliver */
+
+    if (vm.count("startup.timeout")) startupTimeout_ = vm["startup.timeout"].as<int>();
+    if (vm.count("shutdown.timeout")) shutdownTimeout_ = vm["shutdown.timeout"].as<int>();
+
+    if (vm.count("daemon.backpressure")) {
+        dropOverBudget_ = vm["daemon.backpressure"].as<string>() == "drop";
+    }
+
+    if (vm.count("shutdown.spool")) {
+        spool_.reset(new Spool(vm["shutdown.spool"].as<string>()));
+        replay();
+    }
+
+    if (vm.count("kafka.topic")) {
+        defaultChannel_ = channel(vm["kafka.topic"].as<string>(),
+            vm.count("schema") ? vm["schema"].as<string>() : "");
+    }
 
     /* Add brokers */
 
@@ -167,13 +290,178 @@ void ClientFacade::configure(const boost::program_options::variables_map& vm) {
 //    }
 }
 
+bool ClientFacade::warmUp() {
+
+    if (startupTimeout_ <= 0 || kafkaClients_.empty()) return true;
+
+    auto begin = chrono::steady_clock::now();
+    auto deadline = begin + chrono::milliseconds(startupTimeout_);
+
+    // Topic handles, with the producer they belong to
+    vector<pair<rd_kafka_t*, rd_kafka_topic_t*>> topics;
+
+    {
+        lock_guard<mutex> lock(channelsMutex_);
+
+        for (size_t i = 0; i < channels_.size(); ++i) {
+            Channel& channel = *channels_[i].second;
+            topics.push_back(make_pair(kafkaClients_[channel.shard()], channel.kafkaTopic()));
+        }
+    }
+
+    for (size_t i = 0; i < deadLetterTopics_.size(); ++i) {
+        topics.push_back(make_pair(kafkaClients_[i], deadLetterTopics_[i]));
+    }
+
+    /* The metadata request connects to the brokers; a topic is ready when
+     * every partition has a leader, to which the client connects next */
+
+    bool ready = true;
+    int brokers = 0;
+
+    for (size_t i = 0; i < topics.size(); ++i) {
+        string reason("timed out");
+        bool loaded = false;
+
+        for (;;) {
+            auto left = chrono::duration_cast<chrono::milliseconds>(
+                deadline - chrono::steady_clock::now()).count();
+
+            if (left <= 0) break;
+
+            const rd_kafka_metadata_t* metadata = NULL;
+            rd_kafka_resp_err_t error = rd_kafka_metadata(topics[i].first, 0, topics[i].second,
+                &metadata, left);
+
+            if (error == RD_KAFKA_RESP_ERR_NO_ERROR) {
+                error = metadata->topic_cnt > 0 ? metadata->topics[0].err
+                    : RD_KAFKA_RESP_ERR_UNKNOWN_TOPIC_OR_PART;
+
+                for (int p = 0; error == RD_KAFKA_RESP_ERR_NO_ERROR
+                    && p < metadata->topics[0].partition_cnt; ++p) {
+
+                    if (metadata->topics[0].partitions[p].leader < 0) {
+                        error = RD_KAFKA_RESP_ERR_LEADER_NOT_AVAILABLE;
+                    }
+                }
+
+                brokers = metadata->broker_cnt;
+                rd_kafka_metadata_destroy(metadata);
+            }
+
+            if (error == RD_KAFKA_RESP_ERR_NO_ERROR) {
+                loaded = true;
+                break;
+            }
+
+            reason = rd_kafka_err2str(error);
+
+            // Leader elections and topic auto creation take a moment
+            rd_kafka_poll(topics[i].first, min<int>(left, Constants::STARTUP_RETRY_INTERVAL));
+        }
+
+        if (!loaded) {
+            LOG_WARN("Topic " << rd_kafka_topic_name(topics[i].second) << " metadata not ready after "
+                << startupTimeout_ << " ms: " << reason);
+
+            ready = false;
+        }
+    }
+
+    auto now = chrono::steady_clock::now();
+
+    LOG_INFO("Warm-up of " << topics.size() << " topics on " << brokers << " brokers took "
+        << chrono::duration_cast<chrono::milliseconds>(now - begin).count() << " ms, ready "
+        << chrono::duration_cast<chrono::milliseconds>(now - started_).count()
+        << " ms after start");
+
+    return ready;
+}
+
 void ClientFacade::flush() {
-    rd_kafka_poll(kafkaClient_, Constants::DEFAULT_CALLBACK_WAITING_TIMEOUT);
+    poll(Constants::DEFAULT_CALLBACK_WAITING_TIMEOUT);
+}
+
+int ClientFacade::flush(int timeout) {
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout);
+
+    while (queued() > 0) {
+        auto left = chrono::duration_cast<chrono::milliseconds>(
+            deadline - chrono::steady_clock::now()).count();
+
+        if (left <= 0) break;
+
+        poll(min<int>(left, Constants::DEFAULT_CALLBACK_WAITING_TIMEOUT));
+    }
+
+    return queued();
+}
+
+void ClientFacade::poll(int timeout) {
+
+    if (kafkaClients_.size() == 1) {
+        rd_kafka_poll(kafkaClients_[0], timeout);
+        return;
+    }
+
+    // The wait is shared by the producers, none is served less than once
+    int share = max<int>(timeout / kafkaClients_.size(), timeout > 0 ? 1 : 0);
+
+    for (size_t i = 0; i < kafkaClients_.size(); ++i) rd_kafka_poll(kafkaClients_[i], share);
+}
+
+int ClientFacade::queued() const {
+    int count = 0;
+
+    for (size_t i = 0; i < kafkaClients_.size(); ++i) count += rd_kafka_outq_len(kafkaClients_[i]);
+
+    return count;
 }
 
-void ClientFacade::sendMessage(const string& message) {
+int ClientFacade::reload() {
+    lock_guard<mutex> lock(channelsMutex_);
+    int failed = 0;
 
-    bool sendRawMessage = false;
+    for (size_t i = 0; i < channels_.size(); ++i) {
+        if (!channels_[i].second->reload()) ++failed;
+    }
+
+    return failed;
+}
+
+int ClientFacade::shutdown() {
+
+    if (kafkaClients_.empty() || shutdown_) return 0;
+
+    shutdown_ = true;
+
+    int undelivered = flush(shutdownTimeout_);
+
+#ifdef RD_KAFKA_PURGE_F_QUEUE
+    // Fail what is left, the delivery reports spool it
+    if (undelivered > 0 && spool_) {
+        for (size_t i = 0; i < kafkaClients_.size(); ++i) {
+            rd_kafka_purge(kafkaClients_[i], RD_KAFKA_PURGE_F_QUEUE | RD_KAFKA_PURGE_F_INFLIGHT);
+        }
+
+        undelivered = flush(Constants::DEFAULT_CALLBACK_WAITING_TIMEOUT);
+    }
+#endif
+
+    if (undelivered > 0) {
+        LOG_ERROR(undelivered << " messages not delivered in " << shutdownTimeout_ << " ms, lost");
+    }
+
+    if (spool_ && spool_->written() > 0) {
+        LOG_ERROR(spool_->written() << " messages not delivered, spooled to " << spool_->path());
+    }
+
+    return undelivered;
+}
+
+void ClientFacade::sendMessage(Channel& channel, const string& message) {
+
+    string failure;
 
     /* Prepare message */
 
@@ -184,31 +472,34 @@ void ClientFacade::sendMessage(const string& message) {
         return;
     }
 
-    if (serializer_) { // Use serialization mode
-        LOG_DEBUG("Schema defined. Using serialization mode");
+    Metrics::count(Metrics::ENTRIES_RECEIVED);
 
-        try {
-            serializer_->serialize(message, dataOutput);
-        }
-        catch (exception& e) {
-            sendRawMessage = true;
-            LOG_ERROR("Using raw mode due to unexpected exception: " << e.what());
-        }
-    }
-    else { // Use raw mode
-        sendRawMessage = true;
-        LOG_DEBUG("No schema defined. Using raw mode");
-    }
+    if (!channel.encode(message, dataOutput, failure)) return;
+
+    bool sendRawMessage = channel.isRaw() || !failure.empty();
 
     /* Send request */
 
-    // Copy message key
+    rd_kafka_topic_t* targetTopic = channel.kafkaTopic();
+    int32_t targetPartition = channel.partition();
+
+    // Copy message key, or the failure reason for dead-letter entries
     size_t keyLength = messageKey_.length();
+    const char* keySource = messageKey_.data();
     char* key = NULL;
 
+    bool deadLetter = !failure.empty() && !deadLetterTopics_.empty();
+
+    if (deadLetter) {
+        targetTopic = deadLetterTopics_[channel.shard()];
+        targetPartition = RD_KAFKA_PARTITION_UA;
+        keyLength = failure.length();
+        keySource = failure.data();
+    }
+
     if (keyLength > 0) {
         key = new char[keyLength];
-        memcpy(key, messageKey_.data(), keyLength);
+        memcpy(key, keySource, keyLength);
     }
 
     // Copy message value
@@ -230,46 +521,235 @@ void ClientFacade::sendMessage(const string& message) {
         reader.readBytes(value, valueLength);
     }
 
-    if (Constants::IS_DEBUG_ENABLED) {
-        LOG_DEBUG("MESSAGE");
+    LOG_DEBUG("Message (" << valueLength << " bytes): " << Log::printable(value, valueLength));
 
-        // The entire message is not printed with standard cout mechanism
-        // due to NULL character interpretation
-        cout.write(reinterpret_cast<const char*>(value), valueLength);
-        cout << endl;
+    /* Send/Produce message. The destination and enqueue time travel as
+     * message opaque, to spool failed deliveries and measure the latency */
 
-        LOG_DEBUG("MESSAGE END");
+    Metrics::Clock::time_point enqueued = Metrics::Clock::now();
+    size_t destination = deadLetter ? 0 : channel.destination();
+
+    if (!admit(channel.shard(), destination, value, valueLength)) {
+        delete[] value;
+        if (key != NULL) delete[] key;
+        return;
     }
 
-    /* Send/Produce message. */
+    int result = produce(targetTopic, targetPartition, reinterpret_cast<char *>(value), valueLength,
+        key, keyLength, messageOpaque(destination, enqueued));
 
-    rd_kafka_produce(kafkaTopic_, partition_, RD_KAFKA_MSG_F_FREE, reinterpret_cast<char *>(value),
-        valueLength, key, keyLength, NULL);
+    Metrics::record(Metrics::PRODUCE, Metrics::Clock::now() - enqueued);
+
+    if (result == -1) {
+        // Not freed by the client when refused (ej. queue full)
+        delete[] value;
+        MemoryBudget::release(MemoryBudget::PRODUCER, valueLength);
+        Metrics::count(Metrics::PRODUCE_FAILURES);
+        LOG_DEBUG("Message refused by the kafka client (" << errno << ")");
+    }
+    else {
+        Metrics::count(Metrics::MESSAGES_PRODUCED);
+        Metrics::count(Metrics::BYTES_PRODUCED, valueLength);
 
-    LOG_DEBUG("Sent " << valueLength
-        << " bytes to topic " << rd_kafka_topic_name(kafkaTopic_)
-        << ":" << partition_);
+        LOG_DEBUG("Sent " << valueLength
+            << " bytes to topic " << rd_kafka_topic_name(targetTopic)
+            << ":" << targetPartition);
+    }
 
     /* Poll to handle delivery reports */
 
-    rd_kafka_poll(kafkaClient_, 0);
+    rd_kafka_poll(kafkaClients_[channel.shard()], 0);
 
-    if (key != NULL) delete key;
+    if (key != NULL) delete[] key;
 
     // Clean forced above by RD_KAFKA_MSG_F_FREE option
     //delete value;
 }
 
+int ClientFacade::produce(rd_kafka_topic_t* topic, int32_t partition, char* payload,
+    size_t length, const void* key, size_t keyLength, void* opaque) {
+
+    return rd_kafka_produce(topic, partition, RD_KAFKA_MSG_F_FREE, payload, length, key, keyLength,
+        opaque);
+}
+
 void ClientFacade::deliverCallback(rd_kafka_t *rk, void *payload, size_t len,
     rd_kafka_resp_err_t error_code, void *opaque, void *msg_opaque) {
 
+    // Counted, not logged: a log line per message is a throughput problem
+    // of its own
+
+    uint64_t packed = reinterpret_cast<uintptr_t>(msg_opaque);
+
+    MemoryBudget::release(MemoryBudget::PRODUCER, len);
+
     if (error_code) {
-        // TODO: show message description instead of code number
-        LOG_WARN("Message delivery failed with error code: " << error_code);
+        Metrics::count(Metrics::DELIVERY_FAILURES);
+        LOG_DEBUG("Message delivery failed with error code: " << error_code);
+
+        static_cast<ClientFacade*>(opaque)->spool(packed >> OPAQUE_TIME_BITS, payload, len);
     }
     else {
-        LOG_INFO("Message delivered (" << len << " bytes)");
+        Metrics::count(Metrics::MESSAGES_DELIVERED);
+    }
+
+    uint64_t elapsed = (microseconds(Metrics::Clock::now()) - packed) & OPAQUE_TIME_MASK;
+
+    Metrics::record(Metrics::DELIVERY, chrono::microseconds(elapsed));
+}
+
+int ClientFacade::statisticsCallback(rd_kafka_t* rk, char* json, size_t json_len, void* opaque) {
+    Metrics::statistics(rk, json, json_len);
+
+    return 0; // let librdkafka free the document
+}
+
+bool ClientFacade::admit(size_t shard, size_t destination, const uint8_t* payload, size_t length) {
+
+    while (!MemoryBudget::acquire(MemoryBudget::PRODUCER, length)) {
+        if (dropOverBudget_) {
+            Metrics::count(Metrics::ENTRIES_OVER_BUDGET);
+
+            // Not lost if spooling, sent by the next run
+            spool(destination, payload, length);
+            return false;
+        }
+
+        // Delivery reports release the budget
+        rd_kafka_poll(kafkaClients_[shard], BUDGET_WAIT);
     }
+
+    return true;
+}
+
+size_t ClientFacade::destination(const string& topic, int32_t partition, const string& key) {
+    lock_guard<mutex> lock(destinationsMutex_);
+
+    for (size_t i = 1; i < destinations_.size(); ++i) {
+        const SpoolRecord& destination = destinations_[i];
+
+        if (destination.topic == topic && destination.partition == partition
+            && destination.key == key) {
+
+            return i;
+        }
+    }
+
+    if (destinations_.size() == MAX_DESTINATIONS) {
+        LOG_WARN("Too many destinations, failed deliveries to " << topic << " will not be spooled");
+        return MAX_DESTINATIONS;
+    }
+
+    SpoolRecord destination;
+    destination.topic = topic;
+    destination.partition = partition;
+    destination.key = key;
+
+    destinations_.push_back(destination);
+
+    return destinations_.size() - 1;
+}
+
+void ClientFacade::spool(size_t destination, const void* payload, size_t length) {
+
+    if (!spool_) return;
+
+    SpoolRecord record;
+
+    {
+        lock_guard<mutex> lock(destinationsMutex_);
+
+        if (destination >= destinations_.size()) {
+            LOG_ERROR("Failed delivery of a message without destination, not spooled");
+            return;
+        }
+
+        record = destinations_[destination];
+    }
+
+    try {
+        spool_->write(record.topic, record.partition, record.key.data(), record.key.length(),
+            payload, length);
+    }
+    catch (const exception& e) {
+        LOG_ERROR(e.what());
+    }
+}
+
+void ClientFacade::replay() {
+    string replayPath = spool_->path() + ".replay";
+    size_t count = 0;
+
+    // Left by a replay that did not finish, some could be duplicated
+    if (access(replayPath.c_str(), F_OK) == 0) count += replay(replayPath);
+
+    // Moved aside first, the messages failing again go to a new spool
+    if (rename(spool_->path().c_str(), replayPath.c_str()) == 0) count += replay(replayPath);
+
+    if (count > 0) {
+        LOG_INFO("Replayed " << count << " messages spooled to " << spool_->path());
+    }
+}
+
+size_t ClientFacade::replay(const string& path) {
+    ifstream file(path.c_str(), ios::in | ios::binary);
+    SpoolRecord record;
+    size_t count = 0;
+
+    while (Spool::read(file, record)) {
+        size_t bytes = record.key.length() + record.payload.length();
+        rd_kafka_topic_t* topic = NULL;
+        size_t client = 0;
+
+        MemoryBudget::charge(MemoryBudget::SPOOL, bytes);
+
+        for (size_t i = 0; i < replayTopics_.size() && topic == NULL; ++i) {
+            if (record.topic == rd_kafka_topic_name(replayTopics_[i].second)) {
+                client = replayTopics_[i].first;
+                topic = replayTopics_[i].second;
+            }
+        }
+
+        // Each topic through a single client, so its order is kept
+        if (topic == NULL) {
+            client = replayTopics_.size() % kafkaClients_.size();
+            topic = rd_kafka_topic_new(kafkaClients_[client], record.topic.data(),
+                rd_kafka_topic_conf_dup(kafkaTopicConfig_));
+            replayTopics_.push_back(make_pair(client, topic));
+        }
+
+        void* opaque = messageOpaque(destination(record.topic, record.partition, record.key),
+            Metrics::Clock::now());
+
+        char* payload = new char[record.payload.length()];
+        memcpy(payload, record.payload.data(), record.payload.length());
+
+        // Replayed at startup, before any other stage fills the budget
+        MemoryBudget::charge(MemoryBudget::PRODUCER, record.payload.length());
+
+        // Wait for room in the queue, spool again if refused otherwise
+        while (produce(topic, record.partition, payload, record.payload.length(),
+            record.key.data(), record.key.length(), opaque) == -1) {
+
+            if (errno != ENOBUFS) {
+                spool_->write(record.topic, record.partition, record.key.data(),
+                    record.key.length(), payload, record.payload.length());
+                delete[] payload;
+                MemoryBudget::release(MemoryBudget::PRODUCER, record.payload.length());
+                break;
+            }
+
+            rd_kafka_poll(kafkaClients_[client], Constants::DEFAULT_CALLBACK_WAITING_TIMEOUT / 10);
+        }
+
+        MemoryBudget::release(MemoryBudget::SPOOL, bytes);
+
+        ++count;
+    }
+
+    remove(path.c_str());
+
+    return count;
 }
 
 /**
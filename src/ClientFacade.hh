@@ -32,10 +32,13 @@
 
 #include <string>
 #include <cstring>
+#include <chrono>
 #include <ctime>
+#include <deque>
 #include <functional>
 #include <iomanip>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include <boost/lexical_cast.hpp>
@@ -44,12 +47,19 @@ extern "C" {
 #include <librdkafka/rdkafka.h>
 }
 
-#include "Serializer.hh"
+#include "Channel.hh"
+#include "Sink.hh"
+#include "Spool.hh"
 
 /**
- * Client connection facade class.
+ * Client connection facade class, the kafka sink.
+ *
+ * Owns the kafka producer handles, shared by all the channels (target
+ * topics) of the process. Usually there is one; with more, each channel
+ * produces through one of them, so the order of its messages is kept while
+ * the client threads and broker connections are multiplied.
  */
-class ClientFacade {
+class ClientFacade: public Sink {
 public:
 
     ClientFacade();
@@ -63,30 +73,31 @@ public:
     void messageKey(std::string messageKey);
 
     /**
-     * Set the topic and possibly the partition.
-     *
-     * The format expected of the string is
-     * <b>&lt;topic_name&gt;[:&lt;partition&gt;]</b>.
-     * If omitted, a random partition will be selected.
-     *
-     * @pre The given topic value is not blank (empty or all spaces).
+     * @copydoc Sink::channel()
      */
-    void topic(std::string topic);
+    virtual Channel* channel(const std::string& topic, const std::string& schema,
+        Channel::Format format = Channel::LINE);
 
     /**
-     * Configure an AVRO serializer instance according to the specified
-     * configuration file.
-     *
-     * @param configFile the file path to the schema configuration and mapping
+     * @copydoc Sink::defaultChannel()
      */
-    void serializer(const std::string& configFile);
+    virtual Channel* defaultChannel() const;
 
     /*-- methods --*/
 
     /**
      * Prepare and establish the kafka client connection.
+     *
+     * If a topic is given in the options, it becomes the default channel.
      */
-    void configure(const boost::program_options::variables_map& vm);
+    virtual void configure(const boost::program_options::variables_map& vm);
+
+    /**
+     * Wait, up to the startup timeout, until the brokers answer and the
+     * metadata of every channel topic lists a leader for all its
+     * partitions. Does nothing if the startup timeout is 0.
+     */
+    virtual bool warmUp();
 
     /**
      * Flush message queue.
@@ -94,11 +105,57 @@ public:
     void flush();
 
     /**
-     * Send a message to kafka.
+     * Wait for the queued messages to be delivered.
      *
+     * @param timeout maximum time to wait, in milliseconds
+     * @return the messages still queued
+     */
+    virtual int flush(int timeout);
+
+    /**
+     * Serve the delivery report callbacks of every kafka client, sharing
+     * the wait among them.
+     *
+     * @param timeout maximum time to wait for events, in milliseconds
+     */
+    virtual void poll(int timeout);
+
+    /**
+     * @copydoc Sink::reload()
+     */
+    virtual int reload();
+
+    /**
+     * Stop producing: wait for the queued messages to be delivered, up to
+     * the shutdown timeout, and spool the rest if a spool file is set.
+     * Called by the destructor, if not before.
+     *
+     * @return the messages neither delivered nor spooled
+     */
+    virtual int shutdown();
+
+    using Sink::sendMessage;
+
+    /**
+     * Send a message to kafka through the given channel.
+     *
+     * @param channel the channel to use
      * @param message the message to be sent
      */
-    void sendMessage(const std::string& message);
+    virtual void sendMessage(Channel& channel, const std::string& message);
+
+protected:
+
+    /*-- methods --*/
+
+    /**
+     * Hand a message to the kafka client (see rd_kafka_produce()), which
+     * takes ownership of the payload on success.
+     *
+     * @return 0 on success, or -1 if the client refused the message
+     */
+    virtual int produce(rd_kafka_topic_t* topic, int32_t partition, char* payload, size_t length,
+        const void* key, size_t keyLength, void* opaque);
 
 private:
 
@@ -114,9 +171,9 @@ private:
     /*-- fields --*/
 
     /**
-     * The kafka client handle.
+     * The kafka client handles, channels are assigned one by index.
      */
-    rd_kafka_t* kafkaClient_;
+    std::vector<rd_kafka_t*> kafkaClients_;
 
     /**
      * The kafka configuration object;
@@ -124,14 +181,16 @@ private:
     rd_kafka_conf_t* kafkaConfig_;
 
     /**
-     * The kafka topic handle.
+     * The kafka topic configuration object, copied to every channel.
      */
-    rd_kafka_topic_t* kafkaTopic_;
+    rd_kafka_topic_conf_t* kafkaTopicConfig_;
 
     /**
-     * The kafka topic configuration object;
+     * The kafka dead-letter topic handle of each kafka client, so entries
+     * go through the client of their channel, or none if entries that fail
+     * to serialize are sent raw to their channel topic.
      */
-    rd_kafka_topic_conf_t* kafkaTopicConfig_;
+    std::vector<rd_kafka_topic_t*> deadLetterTopics_;
 
     /**
      * Kafka messake key.
@@ -139,20 +198,66 @@ private:
     std::string messageKey_;
 
     /**
-     * Topic name.
+     * Program options, used to configure new channels.
+     */
+    boost::program_options::variables_map options_;
+
+    /**
+     * Channels created so far, with their topic and schema.
+     */
+    std::vector<std::pair<std::string, std::unique_ptr<Channel>>> channels_;
+    std::mutex channelsMutex_;
+
+    /**
+     * The channel of the topic given in the options, if any.
+     */
+    Channel* defaultChannel_;
+
+    /**
+     * Maximum wait for the queued messages at shutdown, in milliseconds.
+     */
+    int shutdownTimeout_;
+
+    /**
+     * Maximum wait for the topics metadata at startup, in milliseconds, or
+     * 0 to skip the warm-up.
      */
-    std::string topic_;
+    int startupTimeout_;
 
     /**
-     * Topic partition.
-     * (Default: -1, random selection)
+     * When configure() was called, to report the startup time.
      */
-    int partition_;
+    std::chrono::steady_clock::time_point started_;
 
     /**
-     * Serializer object to use.
+     * Whether messages over the memory budget are dropped (spooled, if a
+     * spool file is set) instead of waiting for deliveries.
      */
-    std::unique_ptr<Serializer> serializer_;
+    bool dropOverBudget_;
+
+    /**
+     * Whether shutdown() was already called.
+     */
+    bool shutdown_;
+
+    /**
+     * Spool of the messages not delivered, or NULL if they are lost.
+     */
+    std::unique_ptr<Spool> spool_;
+
+    /**
+     * Topic, partition and key of the messages sent to each destination
+     * index, which the messages carry so failed deliveries can be spooled.
+     * Index 0 is the dead-letter topic.
+     */
+    std::deque<SpoolRecord> destinations_;
+    std::mutex destinationsMutex_;
+
+    /**
+     * Topic handles of the replayed messages, with the index of their kafka
+     * client. Topics are spread across the clients.
+     */
+    std::vector<std::pair<size_t, rd_kafka_topic_t*>> replayTopics_;
 
     /*-- static methods --*/
 
@@ -166,6 +271,13 @@ private:
         rd_kafka_resp_err_t error_code,
         void* opaque, void* msg_opaque);
 
+    /**
+     * Statistics callback, keeps the last document for the metrics.
+     *
+     * @see rdkafka.h
+     */
+    static int statisticsCallback(rd_kafka_t* rk, char* json, size_t json_len, void* opaque);
+
     /*-- methods --*/
 
     /**
@@ -175,10 +287,46 @@ private:
      */
     void initDefaults();
 
+    /**
+     * Return the messages queued in all the kafka clients.
+     */
+    int queued() const;
+
     /**
      * Generate an unique correlation id for a request.
      */
     int generateCorrelationId();
+
+    /**
+     * Hold a message payload within the producer stage memory budget,
+     * serving delivery reports until it fits, or dropping it.
+     *
+     * @return false if dropped
+     */
+    bool admit(size_t shard, size_t destination, const uint8_t* payload, size_t length);
+
+    /**
+     * Return the index of a destination, adding it if new.
+     */
+    size_t destination(const std::string& topic, int32_t partition, const std::string& key);
+
+    /**
+     * Write a message that failed delivery to the spool.
+     */
+    void spool(size_t destination, const void* payload, size_t length);
+
+    /**
+     * Produce again the messages of the spool file, and of a replay left
+     * unfinished.
+     */
+    void replay();
+
+    /**
+     * Produce again the messages of a spool file, then remove it.
+     *
+     * @return the messages replayed
+     */
+    size_t replay(const std::string& path);
 };
 
 #endif /* _LOG2KAFKA_CLIENT_FACADE_HH_ */
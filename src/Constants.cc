@@ -38,3 +38,38 @@ const string Constants::DEFAULT_CONFIG_PATH = "/etc/log2kafka/";
 const int Constants::DEFAULT_CALLBACK_WAITING_TIMEOUT = 1000;
 const string Constants::KAFKA_CLIENT_OPTION_PREFIX = "kafka.";
 const string Constants::KAFKA_TOPIC_OPTION_PREFIX = "kafka_topic.";
+const int Constants::DEFAULT_SAMPLING_RATE = 10;
+const string Constants::DEFAULT_SAMPLING_FIELD = "sampleRate";
+const string Constants::DEFAULT_SAMPLING_KEEP_FIELD = "status";
+const int Constants::DEFAULT_SAMPLING_KEEP_MINIMUM = 400;
+const int Constants::DEFAULT_MEMORY_BUDGET = 0;
+const int Constants::DEFAULT_FAILURE_SUMMARY_INTERVAL = 60;
+const int Constants::DEFAULT_SHUTDOWN_TIMEOUT = 10000;
+const int Constants::DEFAULT_PRODUCER_SHARDS = 1;
+const int Constants::DEFAULT_STARTUP_TIMEOUT = 0;
+const int Constants::STARTUP_RETRY_INTERVAL = 100;
+const int Constants::DEFAULT_READ_BUFFER_SIZE = 64 * 1024;
+const int Constants::DEFAULT_INPUT_THREADS = 4;
+const string Constants::DEFAULT_SINK = "kafka";
+const string Constants::DEFAULT_SINK_DIRECTORY = ".";
+const int Constants::DEFAULT_SINK_ROLL_SIZE = 256;
+const int Constants::DEFAULT_SINK_ROLL_INTERVAL = 3600;
+const int Constants::DEFAULT_SINK_BLOCK_RECORDS = 1000;
+const string Constants::DEFAULT_SINK_CODEC = "deflate";
+const string Constants::DEFAULT_SINK_FAILED_NAME = "failed";
+const int Constants::DEFAULT_DAEMON_WORKERS = 2;
+const int Constants::DEFAULT_DAEMON_QUEUE_SIZE = 10000;
+const int Constants::DAEMON_POLL_INTERVAL = 500;
+const string Constants::SOURCE_HEADER = "#log2kafka ";
+const int Constants::SYSLOG_RECEIVE_BATCH = 64;
+const int Constants::SYSLOG_MAX_DATAGRAM = 8 * 1024;
+const int Constants::DEFAULT_FILE_INTERVAL = 250;
+const int Constants::DEFAULT_FILE_IO_DEPTH = 64;
+#ifdef HAVE_LIBURING
+const string Constants::DEFAULT_FILE_ENGINE = "uring";
+#else
+const string Constants::DEFAULT_FILE_ENGINE = "read";
+#endif
+const int Constants::DEFAULT_MULTILINE_MAX_LINES = 500;
+const int Constants::DEFAULT_MULTILINE_MAX_BYTES = 256 * 1024;
+const int Constants::DEFAULT_MULTILINE_TIMEOUT = 1000;
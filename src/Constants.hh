@@ -73,6 +73,169 @@ public:
      * Value: "kafka_topic."
      */
     static const std::string KAFKA_TOPIC_OPTION_PREFIX;
+
+    /**
+     * Default N of the adaptive 1-in-N sampling: 10
+     */
+    static const int DEFAULT_SAMPLING_RATE;
+
+    /**
+     * Default record field that receives the sample rate: "sampleRate"
+     */
+    static const std::string DEFAULT_SAMPLING_FIELD;
+
+    /**
+     * Default record field checked to exempt a line from sampling: "status"
+     */
+    static const std::string DEFAULT_SAMPLING_KEEP_FIELD;
+
+    /**
+     * Default minimum keep field value that exempts a line from sampling: 400
+     */
+    static const int DEFAULT_SAMPLING_KEEP_MINIMUM;
+
+    /**
+     * Default memory budget for buffered entries and messages, in MB: 0,
+     * no limit
+     */
+    static const int DEFAULT_MEMORY_BUDGET;
+
+    /**
+     * Default minimum time between two parse failure summaries: 60 s
+     */
+    static const int DEFAULT_FAILURE_SUMMARY_INTERVAL;
+
+    /**
+     * Default maximum wait for the queued messages at shutdown: 10000 ms
+     */
+    static const int DEFAULT_SHUTDOWN_TIMEOUT;
+
+    /**
+     * Default number of kafka client handles: 1
+     */
+    static const int DEFAULT_PRODUCER_SHARDS;
+
+    /**
+     * Default maximum wait for the topics metadata at startup: 0 ms (no
+     * warm-up)
+     */
+    static const int DEFAULT_STARTUP_TIMEOUT;
+
+    /**
+     * Wait between two topic metadata requests during the warm-up: 100 ms
+     */
+    static const int STARTUP_RETRY_INTERVAL;
+
+    /**
+     * Default input read buffer size, also the maximum entry length: 64 KB
+     */
+    static const int DEFAULT_READ_BUFFER_SIZE;
+
+    /**
+     * Default threads decompressing the input files: 4
+     */
+    static const int DEFAULT_INPUT_THREADS;
+
+    /**
+     * Default sink: "kafka"
+     */
+    static const std::string DEFAULT_SINK;
+
+    /**
+     * Default file sink directory: "."
+     */
+    static const std::string DEFAULT_SINK_DIRECTORY;
+
+    /**
+     * Default size from which the sink files are rolled: 256 MB
+     */
+    static const int DEFAULT_SINK_ROLL_SIZE;
+
+    /**
+     * Default age from which the sink files are rolled: 3600 s
+     */
+    static const int DEFAULT_SINK_ROLL_INTERVAL;
+
+    /**
+     * Default records per Avro container block: 1000
+     */
+    static const int DEFAULT_SINK_BLOCK_RECORDS;
+
+    /**
+     * Default Avro container block codec: "deflate"
+     */
+    static const std::string DEFAULT_SINK_CODEC;
+
+    /**
+     * Default name of the file sink files holding the entries that failed
+     * to serialize, if no dead-letter topic is set: "failed"
+     */
+    static const std::string DEFAULT_SINK_FAILED_NAME;
+
+    /**
+     * Default number of daemon worker threads: 2
+     */
+    static const int DEFAULT_DAEMON_WORKERS;
+
+    /**
+     * Default maximum entries queued per daemon worker: 10000
+     */
+    static const int DEFAULT_DAEMON_QUEUE_SIZE;
+
+    /**
+     * Maximum time the daemon waits for input or delivery reports before
+     * checking for a stop request: 500 ms
+     */
+    static const int DAEMON_POLL_INTERVAL;
+
+    /**
+     * Header that starts a source declaration line on daemon socket
+     * connections. Value: "#log2kafka "
+     */
+    static const std::string SOURCE_HEADER;
+
+    /**
+     * Maximum syslog datagrams received in a single system call: 64
+     */
+    static const int SYSLOG_RECEIVE_BATCH;
+
+    /**
+     * Maximum syslog datagram size, longer ones are truncated: 8 KB
+     * (as recommended by RFC 5426)
+     */
+    static const int SYSLOG_MAX_DATAGRAM;
+
+    /**
+     * Default time between two checks of a daemon file at its end, for
+     * new data or rotation: 250 ms
+     */
+    static const int DEFAULT_FILE_INTERVAL;
+
+    /**
+     * Default maximum daemon file reads in flight with io_uring: 64
+     */
+    static const int DEFAULT_FILE_IO_DEPTH;
+
+    /**
+     * Default daemon files reading engine: "uring", or "read" if not built
+     * with liburing
+     */
+    static const std::string DEFAULT_FILE_ENGINE;
+
+    /**
+     * Default maximum lines joined in a multiline record: 500
+     */
+    static const int DEFAULT_MULTILINE_MAX_LINES;
+
+    /**
+     * Default maximum size of a multiline record: 256 KB
+     */
+    static const int DEFAULT_MULTILINE_MAX_BYTES;
+
+    /**
+     * Default time a multiline record waits for more lines: 1000 ms
+     */
+    static const int DEFAULT_MULTILINE_TIMEOUT;
 };
 
 #endif /* _LOG2KAFKA_CONSTANTS_HH_ */
@@ -0,0 +1,307 @@
+/**
+ * @file ContainerWriter.cc
+ * @brief Rolling Avro container files writer class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ContainerWriter.hh"
+
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr ContainerWriter::logger(Logger::getLogger("ContainerWriter"));
+#endif
+
+namespace {
+
+/**
+ * Data buffered before a write() call.
+ */
+const size_t BUFFER_SIZE = 256 * 1024;
+
+/**
+ * Seconds pending records wait to be written.
+ */
+const time_t WRITE_INTERVAL = 1;
+
+const string AVRO_DEFLATE_CODEC("deflate");
+const string AVRO_NULL_CODEC("null");
+
+/**
+ * Files opened by the process, a part of their name.
+ */
+atomic<unsigned> sequence(0);
+
+/**
+ * Append an Avro long: zig-zag encoded variable length integer.
+ */
+void appendLong(string& out, int64_t value) {
+    uint64_t n = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+
+    while (n > 0x7F) {
+        out += static_cast<char>((n & 0x7F) | 0x80);
+        n >>= 7;
+    }
+
+    out += static_cast<char>(n);
+}
+
+} // namespace
+
+/*-- constructors/destructor --*/
+
+ContainerWriter::ContainerWriter(const string& prefix, const shared_ptr<Serializer>& serializer) :
+    prefix_(prefix), serializer_(serializer), rollSize_(0), rollInterval_(0), blockRecords_(1),
+    deflate_(false), fd_(-1), size_(0), opened_(0), written_(0), records_(0) {
+
+    memset(&stream_, 0, sizeof(stream_));
+
+    // Avro deflate is raw, without zlib header
+    deflateInit2(&stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+}
+
+ContainerWriter::~ContainerWriter() {
+    try {
+        close();
+    }
+    catch (const exception& e) {
+        LOG_ERROR(e.what());
+    }
+
+    deflateEnd(&stream_);
+}
+
+/*-- getters/setters --*/
+
+void ContainerWriter::rollSize(uint64_t rollSize) {
+    rollSize_ = rollSize;
+}
+
+void ContainerWriter::rollInterval(int rollInterval) {
+    rollInterval_ = rollInterval;
+}
+
+void ContainerWriter::serializer(const shared_ptr<Serializer>& serializer) {
+
+    if (serializer == serializer_) return; // only changed by this thread
+
+    lock_guard<mutex> lock(mutex_);
+
+    roll();
+    serializer_ = serializer;
+}
+
+void ContainerWriter::blockRecords(size_t blockRecords) {
+    blockRecords_ = max<size_t>(blockRecords, 1);
+}
+
+void ContainerWriter::deflate(bool deflate) {
+    deflate_ = deflate;
+}
+
+/*-- methods --*/
+
+void ContainerWriter::append(avro::InputStream& record) {
+    lock_guard<mutex> lock(mutex_);
+
+    if (fd_ < 0) open();
+
+    const uint8_t* data;
+    size_t length;
+
+    while (record.next(&data, &length)) {
+        block_.append(reinterpret_cast<const char*>(data), length);
+    }
+
+    if (++records_ >= blockRecords_) writeBlock();
+
+    checkRoll(time(NULL));
+}
+
+void ContainerWriter::append(const char* data, size_t length) {
+    lock_guard<mutex> lock(mutex_);
+
+    if (fd_ < 0) open();
+
+    buffer_.append(data, length);
+    buffer_ += '\n';
+    size_ += length + 1;
+
+    if (buffer_.size() >= BUFFER_SIZE) writeBuffer();
+
+    checkRoll(time(NULL));
+}
+
+void ContainerWriter::tick() {
+    lock_guard<mutex> lock(mutex_);
+
+    if (fd_ < 0) return;
+
+    time_t now = time(NULL);
+
+    if (now - written_ >= WRITE_INTERVAL) {
+        writeBlock();
+        writeBuffer();
+    }
+
+    checkRoll(now);
+}
+
+void ContainerWriter::close() {
+    lock_guard<mutex> lock(mutex_);
+    roll();
+}
+
+void ContainerWriter::open() {
+    time_t now = time(NULL);
+    struct tm utc;
+    char stamp[32];
+
+    gmtime_r(&now, &utc);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &utc);
+
+    path_ = prefix_ + "-" + stamp + "-" + to_string(getpid()) + "-" + to_string(sequence++)
+        + (serializer_ ? ".avro" : ".log");
+
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+    if (fd_ < 0) throw system_error(errno, system_category(), "Unable to open " + path_);
+
+    LOG_DEBUG("Writing to " << path_);
+
+    opened_ = written_ = now;
+    size_ = 0;
+
+    if (!serializer_) return;
+
+    // Schema and codec header, the sync marker ends every block
+    sync_ = serializer_->makeSync();
+
+    auto_ptr<avro::OutputStream> header = avro::memoryOutputStream();
+    avro::EncoderPtr encoder = avro::binaryEncoder();
+
+    encoder->init(*header);
+    serializer_->writeHeader(encoder, sync_, deflate_ ? AVRO_DEFLATE_CODEC : AVRO_NULL_CODEC);
+
+    auto_ptr<avro::InputStream> input = avro::memoryInputStream(*header);
+    const uint8_t* data;
+    size_t length;
+
+    while (input->next(&data, &length)) {
+        buffer_.append(reinterpret_cast<const char*>(data), length);
+        size_ += length;
+    }
+}
+
+void ContainerWriter::writeBlock() {
+
+    if (records_ == 0) return;
+
+    const string* data = &block_;
+
+    if (deflate_) {
+        deflateReset(&stream_);
+
+        compressed_.resize(deflateBound(&stream_, block_.size()));
+
+        stream_.next_in = reinterpret_cast<Bytef*>(&block_[0]);
+        stream_.avail_in = block_.size();
+        stream_.next_out = reinterpret_cast<Bytef*>(&compressed_[0]);
+        stream_.avail_out = compressed_.size();
+
+        ::deflate(&stream_, Z_FINISH); // the bound always fits
+
+        compressed_.resize(stream_.total_out);
+        data = &compressed_;
+    }
+
+    size_t before = buffer_.size();
+
+    appendLong(buffer_, records_);
+    appendLong(buffer_, data->size());
+    buffer_.append(*data);
+    buffer_.append(reinterpret_cast<const char*>(sync_.data()), sync_.size());
+
+    size_ += buffer_.size() - before;
+
+    block_.clear();
+    records_ = 0;
+
+    if (buffer_.size() >= BUFFER_SIZE) writeBuffer();
+}
+
+void ContainerWriter::writeBuffer() {
+    const char* p = buffer_.data();
+    size_t remaining = buffer_.size();
+
+    while (remaining > 0) {
+        ssize_t count = write(fd_, p, remaining);
+
+        if (count < 0) {
+            if (errno == EINTR) continue;
+
+            buffer_.clear();
+            throw system_error(errno, system_category(), "Unable to write " + path_);
+        }
+
+        p += count;
+        remaining -= count;
+    }
+
+    buffer_.clear();
+    written_ = time(NULL);
+}
+
+void ContainerWriter::roll() {
+
+    if (fd_ < 0) return;
+
+    writeBlock();
+    writeBuffer();
+
+    ::close(fd_);
+    fd_ = -1;
+
+    LOG_DEBUG("Closed " << path_ << " (" << size_ << " bytes)");
+}
+
+void ContainerWriter::checkRoll(time_t now) {
+
+    if ((rollSize_ > 0 && size_ >= rollSize_)
+        || (rollInterval_ > 0 && now - opened_ >= rollInterval_)) {
+
+        roll();
+    }
+}
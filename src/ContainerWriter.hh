@@ -0,0 +1,239 @@
+/**
+ * @file ContainerWriter.hh
+ * @brief Rolling Avro container files writer class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_CONTAINER_WRITER_HH_
+#define _LOG2KAFKA_CONTAINER_WRITER_HH_
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <zlib.h>
+
+#include "Serializer.hh"
+
+/**
+ * Writer of the messages of a channel to local files, rolled by size and
+ * age.
+ *
+ * With a serializer, the files are standard Avro object containers: a
+ * header with the schema, then blocks of many records, optionally deflate
+ * compressed. Without it (raw entries), the files hold one entry per line.
+ *
+ * Data is buffered and appended with large write() calls to files opened
+ * with O_APPEND. Blocks never span files. Thread safe.
+ */
+class ContainerWriter {
+public:
+
+    /**
+     * Class constructor.
+     *
+     * @param prefix the files path prefix, completed with the open time, the
+     *               process id and a sequence number
+     * @param serializer the serializer of the records, or none for lines
+     */
+    ContainerWriter(const std::string& prefix, const std::shared_ptr<Serializer>& serializer);
+    virtual ~ContainerWriter();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Set the size, in bytes, from which the file is rolled.
+     */
+    void rollSize(uint64_t rollSize);
+
+    /**
+     * Set the age, in seconds, from which the file is rolled.
+     */
+    void rollInterval(int rollInterval);
+
+    /**
+     * Set the serializer of the records. A different one closes the current
+     * file, the next starts with its schema. Called by the appending thread.
+     * The writer shares it, so it outlives a reload of the channel.
+     */
+    void serializer(const std::shared_ptr<Serializer>& serializer);
+
+    /**
+     * Set the records per block.
+     */
+    void blockRecords(size_t blockRecords);
+
+    /**
+     * Set whether the blocks are deflate compressed.
+     */
+    void deflate(bool deflate);
+
+    /*-- methods --*/
+
+    /**
+     * Append an Avro binary encoded record.
+     *
+     * @throw std::system_error if the file can not be written
+     */
+    void append(avro::InputStream& record);
+
+    /**
+     * Append a line.
+     *
+     * @throw std::system_error if the file can not be written
+     */
+    void append(const char* data, size_t length);
+
+    /**
+     * Write the pending records if they waited long enough, and roll the
+     * file if it is too old.
+     */
+    void tick();
+
+    /**
+     * Write the pending records and close the file.
+     */
+    void close();
+
+private:
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /*-- fields --*/
+
+    /**
+     * Files path prefix.
+     */
+    std::string prefix_;
+
+    /**
+     * Records serializer, or none for lines.
+     */
+    std::shared_ptr<Serializer> serializer_;
+
+    /**
+     * Roll size, in bytes, and interval, in seconds.
+     */
+    uint64_t rollSize_;
+    int rollInterval_;
+
+    /**
+     * Records per block.
+     */
+    size_t blockRecords_;
+
+    /**
+     * Whether the blocks are deflate compressed.
+     */
+    bool deflate_;
+
+    /**
+     * Current file descriptor, or -1, and its path.
+     */
+    int fd_;
+    std::string path_;
+
+    /**
+     * Bytes written to the current file, buffered included.
+     */
+    uint64_t size_;
+
+    /**
+     * When the current file was opened, and when data was last written.
+     */
+    time_t opened_;
+    time_t written_;
+
+    /**
+     * Current file sync marker.
+     */
+    DataBlockSync sync_;
+
+    /**
+     * Records of the block being built, and their count.
+     */
+    std::string block_;
+    size_t records_;
+
+    /**
+     * Compressed block.
+     */
+    std::string compressed_;
+
+    /**
+     * Deflate stream, reused for every block.
+     */
+    z_stream stream_;
+
+    /**
+     * Data not yet written to the file.
+     */
+    std::string buffer_;
+
+    /**
+     * Writer state lock.
+     */
+    std::mutex mutex_;
+
+    /*-- methods --*/
+
+    /**
+     * Open a new file and write its header.
+     */
+    void open();
+
+    /**
+     * Move the pending records to the buffer as a block.
+     */
+    void writeBlock();
+
+    /**
+     * Write the buffer to the file.
+     */
+    void writeBuffer();
+
+    /**
+     * Write everything and close the file, if open.
+     */
+    void roll();
+
+    /**
+     * Roll the file if it reached the roll size or interval.
+     */
+    void checkRoll(time_t now);
+};
+
+#endif /* _LOG2KAFKA_CONTAINER_WRITER_HH_ */
@@ -0,0 +1,753 @@
+/**
+ * @file Daemon.cc
+ * @brief Multiple log sources server class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <glob.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Daemon.hh"
+#include "MemoryBudget.hh"
+#include "Metrics.hh"
+#include "Util.hh"
+
+namespace po = boost::program_options;
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr Daemon::logger(Logger::getLogger("Daemon"));
+#endif
+
+volatile sig_atomic_t Daemon::stopped_ = 0;
+
+/*-- constructors/destructor --*/
+
+Daemon::Daemon(Sink& facade) :
+    facade_(facade), bufferSize_(Constants::DEFAULT_READ_BUFFER_SIZE),
+    pollInterval_(Constants::DAEMON_POLL_INTERVAL),
+    pollerStopped_(false) {
+
+    defaultCpus_ = Util::threadCpus();
+    readerCpus_ = defaultCpus_;
+    pollerCpus_ = defaultCpus_;
+}
+
+Daemon::~Daemon() {
+
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        queues_[i]->close();
+    }
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        if (workers_[i].joinable()) workers_[i].join();
+    }
+
+    pollerStopped_ = true;
+    if (poller_.joinable()) poller_.join();
+
+    // Before the files readers go away
+    tailer_.reset();
+
+    while (!inputs_.empty()) {
+        closeInput(inputs_.size() - 1);
+    }
+
+    if (!socketPath_.empty()) unlink(socketPath_.c_str());
+
+    MemoryBudget::release(MemoryBudget::INPUT, datagrams_.size());
+}
+
+/*-- static methods --*/
+
+void Daemon::stop() {
+    stopped_ = 1;
+}
+
+void Daemon::forward(const string& socketPath, const string& declaration) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        int error = errno;
+
+        if (fd >= 0) close(fd);
+
+        throw system_error(error, system_category(), "Unable to connect to " + socketPath);
+    }
+
+    string header = Constants::SOURCE_HEADER + declaration + "\n";
+    vector<char> buffer(Constants::DEFAULT_READ_BUFFER_SIZE);
+    ssize_t count = header.length();
+
+    memcpy(&buffer[0], header.data(), count);
+
+    /* Copy standard input, in buffer sized chunks */
+
+    do {
+        for (ssize_t written = 0, n; written < count; written += n) {
+            n = write(fd, &buffer[written], count - written);
+
+            if (n < 0) {
+                if (errno == EINTR) {
+                    n = 0;
+                    continue;
+                }
+
+                close(fd);
+                throw system_error(errno, system_category(), "Connection lost");
+            }
+        }
+
+        do {
+            count = ::read(STDIN_FILENO, &buffer[0], buffer.size());
+        } while (count < 0 && errno == EINTR);
+
+    } while (count > 0);
+
+    close(fd);
+}
+
+Channel* Daemon::declare(Sink& facade, const string& declaration,
+    Channel::Format format) {
+
+    size_t comma = declaration.find(',');
+
+    if (comma == string::npos) {
+        return facade.channel(boost::trim_copy(declaration), "", format);
+    }
+
+    return facade.channel(boost::trim_copy(declaration.substr(0, comma)),
+        boost::trim_copy(declaration.substr(comma + 1)), format);
+}
+
+/*-- methods --*/
+
+void Daemon::configure(const po::variables_map& vm) {
+
+    // This thread is the reader, placed before its buffers are allocated
+    configurePlacement(vm);
+    Util::pinThread(readerCpus_);
+
+    bufferSize_ = vm["daemon.buffer-size"].as<int>();
+    pollInterval_ = max(min(Constants::DAEMON_POLL_INTERVAL, vm["multiline.timeout"].as<int>()), 1);
+
+    /* Prepare worker queues, sources are assigned to them when opened */
+
+    size_t workerCount = max(vm["daemon.workers"].as<int>(), 1);
+    WorkQueue::Backpressure backpressure =
+        vm["daemon.backpressure"].as<string>() == "drop" ? WorkQueue::DROP : WorkQueue::BLOCK;
+
+    pending_.resize(workerCount);
+
+    for (size_t i = 0; i < workerCount; ++i) {
+        queues_.push_back(unique_ptr<WorkQueue>(
+            new WorkQueue(vm["daemon.queue-size"].as<int>(), backpressure)));
+    }
+
+    /* Open sources */
+
+    if (vm.count("daemon.source")) {
+        const vector<string>& sources = vm["daemon.source"].as<vector<string>>();
+
+        for (size_t i = 0; i < sources.size(); ++i) {
+            openFifo(sources[i]);
+        }
+    }
+
+    if (vm.count("daemon.listen")) {
+        openSocket(vm["daemon.listen"].as<string>());
+    }
+
+    if (vm.count("daemon.syslog-udp")) {
+        const vector<string>& sources = vm["daemon.syslog-udp"].as<vector<string>>();
+
+        for (size_t i = 0; i < sources.size(); ++i) {
+            openSyslog(sources[i], SOCK_DGRAM);
+        }
+    }
+
+    if (vm.count("daemon.syslog-tcp")) {
+        const vector<string>& sources = vm["daemon.syslog-tcp"].as<vector<string>>();
+
+        for (size_t i = 0; i < sources.size(); ++i) {
+            openSyslog(sources[i], SOCK_STREAM);
+        }
+    }
+
+    if (vm.count("daemon.file")) {
+        const vector<string>& sources = vm["daemon.file"].as<vector<string>>();
+
+        tailer_.reset(new FileTailer(
+            vm["daemon.file-engine"].as<string>() == "uring" ? FileTailer::URING : FileTailer::READ,
+            max(vm["daemon.file-io-depth"].as<int>(), 1), vm["daemon.file-interval"].as<int>()));
+
+        for (size_t i = 0; i < sources.size(); ++i) {
+            openFiles(sources[i], vm.count("daemon.file-from-start"));
+        }
+
+        tailer_->start();
+    }
+
+    if (inputs_.empty()) {
+        throw invalid_argument("No daemon sources (--daemon.source), socket (--daemon.listen),"
+            " syslog ports (--daemon.syslog-udp, --daemon.syslog-tcp) or files (--daemon.file)"
+            " defined");
+    }
+
+    /* Start workers */
+
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers_.push_back(thread(&Daemon::work, this, i));
+    }
+
+    poller_ = thread(&Daemon::pollDeliveries, this);
+
+    LOG_INFO("Serving " << inputs_.size() << " sources with " << workerCount << " workers");
+}
+
+void Daemon::configurePlacement(const po::variables_map& vm) {
+
+    if (vm.count("cpus.reader")) readerCpus_ = Util::cpuSet(vm["cpus.reader"].as<string>());
+    if (vm.count("cpus.poller")) pollerCpus_ = Util::cpuSet(vm["cpus.poller"].as<string>());
+
+    if (vm.count("cpus.worker")) {
+        const vector<string>& lists = vm["cpus.worker"].as<vector<string>>();
+
+        for (size_t i = 0; i < lists.size(); ++i) workerCpus_.push_back(Util::cpuSet(lists[i]));
+    }
+}
+
+void Daemon::openFifo(const string& source) {
+    size_t equals = source.find('=');
+
+    if (equals == string::npos) {
+        throw invalid_argument("Invalid source '" + source + "'. Expected: <path>=<topic>[,<schema>]");
+    }
+
+    string path = source.substr(0, equals);
+    struct stat status;
+
+    if (stat(path.c_str(), &status) < 0) {
+        if (mkfifo(path.c_str(), 0660) < 0) {
+            throw system_error(errno, system_category(), "Unable to create FIFO " + path);
+        }
+    }
+    else if (!S_ISFIFO(status.st_mode)) {
+        throw invalid_argument("Source '" + path + "' is not a FIFO");
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+
+    if (fd < 0) {
+        throw system_error(errno, system_category(), "Unable to open FIFO " + path);
+    }
+
+    Input& input = addInput(FIFO, fd, declare(facade_, source.substr(equals + 1)));
+
+    // Holding a writer end ourselves, the FIFO never reports end of file
+    // when a log writer goes away (ej. on web server restarts)
+    input.writerFd = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+
+    LOG_DEBUG("Source FIFO " << path << " sent to topic " << input.channel->topic());
+}
+
+void Daemon::openSocket(const string& path) {
+    sockaddr_un address;
+
+    if (path.length() >= sizeof(address.sun_path)) {
+        throw invalid_argument("Socket path too long: " + path);
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    unlink(path.c_str());
+
+    if (fd < 0
+        || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+        || listen(fd, SOMAXCONN) < 0) {
+
+        if (fd >= 0) close(fd);
+        throw system_error(errno, system_category(), "Unable to listen on " + path);
+    }
+
+    // Connections declare their own channel
+    addInput(LISTENER, fd, NULL);
+    socketPath_ = path;
+}
+
+void Daemon::openSyslog(const string& source, int type) {
+    size_t equals = source.find('=');
+
+    if (equals == string::npos) {
+        throw invalid_argument("Invalid syslog source '" + source
+            + "'. Expected: [<address>:]<port>=<topic>[,<schema>]");
+    }
+
+    string endpoint = source.substr(0, equals);
+    int fd = Util::listenInet(endpoint, type);
+
+    Channel* channel = declare(facade_, source.substr(equals + 1), Channel::SYSLOG);
+
+    if (type == SOCK_DGRAM) {
+        addInput(DATAGRAM, fd, channel);
+
+        // Shared receive buffer, a slot per datagram of a batch
+        if (datagrams_.empty()) {
+            size_t count = Constants::SYSLOG_RECEIVE_BATCH;
+
+            datagrams_.resize(count * Constants::SYSLOG_MAX_DATAGRAM);
+            datagramVectors_.resize(count);
+            datagramHeaders_.resize(count);
+
+            for (size_t i = 0; i < count; ++i) {
+                datagramVectors_[i].iov_base = &datagrams_[i * Constants::SYSLOG_MAX_DATAGRAM];
+                datagramVectors_[i].iov_len = Constants::SYSLOG_MAX_DATAGRAM;
+
+                memset(&datagramHeaders_[i], 0, sizeof(mmsghdr));
+                datagramHeaders_[i].msg_hdr.msg_iov = &datagramVectors_[i];
+                datagramHeaders_[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            MemoryBudget::charge(MemoryBudget::INPUT, datagrams_.size());
+        }
+    }
+    else {
+        addInput(LISTENER, fd, channel);
+    }
+
+    LOG_DEBUG("Syslog " << (type == SOCK_DGRAM ? "UDP" : "TCP") << " port " << endpoint
+        << " sent to topic " << channel->topic());
+}
+
+void Daemon::openFiles(const string& source, bool fromStart) {
+    size_t equals = source.find('=');
+
+    if (equals == string::npos) {
+        throw invalid_argument("Invalid file source '" + source
+            + "'. Expected: <path or glob>=<topic>[,<schema>]");
+    }
+
+    string pattern = source.substr(0, equals);
+    Channel* channel = declare(facade_, source.substr(equals + 1));
+    glob_t paths;
+
+    // A path matching nothing is followed anyway, waiting for it
+    if (glob(pattern.c_str(), GLOB_NOCHECK, NULL, &paths) != 0) {
+        globfree(&paths);
+        throw invalid_argument("Invalid file source pattern '" + pattern + "'");
+    }
+
+    for (size_t i = 0; i < paths.gl_pathc; ++i) {
+        Input& input = addInput(TAILED, -1, channel);
+
+        tailer_->add(paths.gl_pathv[i], *input.reader, fromStart);
+        files_.push_back(&input);
+
+        LOG_DEBUG("Source file " << paths.gl_pathv[i] << " sent to topic " << channel->topic());
+    }
+
+    globfree(&paths);
+}
+
+Daemon::Input& Daemon::addInput(Kind kind, int fd, Channel* channel) {
+    unique_ptr<Input> input(new Input());
+
+    input->kind = kind;
+    input->fd = fd;
+    input->channel = NULL;
+    input->worker = 0;
+    input->writerFd = -1;
+    input->declared = channel != NULL;
+
+    if (kind == FIFO || kind == CONNECTION || kind == TAILED) {
+        input->reader.reset(new LineReader(fd, bufferSize_));
+    }
+
+    if (channel != NULL) {
+        assign(*input, channel);
+    }
+
+    inputs_.push_back(move(input));
+    return *inputs_.back();
+}
+
+void Daemon::run() {
+    vector<pollfd> fds;
+
+    while (!stopped_) {
+
+        /* Wait for input. Followed files (without descriptor, so ignored)
+         * are waited for through the tailer completions descriptor, if
+         * any, and timeout */
+
+        size_t count = inputs_.size();
+        bool completions = tailer_ && tailer_->fd() >= 0;
+
+        fds.resize(count + (completions ? 1 : 0));
+
+        for (size_t i = 0; i < count; ++i) {
+            fds[i].fd = inputs_[i]->fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        if (completions) {
+            fds[count].fd = tailer_->fd();
+            fds[count].events = POLLIN;
+            fds[count].revents = 0;
+        }
+
+        int ready = poll(&fds[0], fds.size(),
+            tailer_ ? tailer_->timeout(pollInterval_) : pollInterval_);
+
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            throw system_error(errno, system_category(), "Unable to poll sources");
+        }
+
+        if (tailer_) tailFiles();
+
+        if (ready == 0) {
+            expireRecords();
+            flushPending();
+            continue;
+        }
+
+        /* Read ready sources, closing ended connections. New connections
+         * are appended, so walking backwards skips them. */
+
+        for (size_t i = count; i-- > 0;) {
+            if (fds[i].revents == 0) continue;
+
+            Input& input = *inputs_[i];
+
+            if (input.kind == LISTENER) {
+                acceptConnection(input);
+            }
+            else if (input.kind == DATAGRAM) {
+                receiveDatagrams(input);
+            }
+            else if (readInput(input) == 0) {
+                completeRecord(input);
+                closeInput(i);
+            }
+        }
+
+        expireRecords();
+        flushPending();
+    }
+
+    LOG_INFO("Stop requested. Draining sources");
+
+    for (size_t i = 0; i < inputs_.size(); ++i) {
+        Input& input = *inputs_[i];
+        string entry;
+
+        if (input.kind == DATAGRAM) {
+            while (receiveDatagrams(input) > 0) {
+            }
+        }
+
+        if (!input.reader) continue;
+
+        // Followed files keep their last line until it is complete
+        if (input.kind != TAILED) {
+            while (readInput(input) > 0) {
+            }
+
+            if (input.channel != NULL && input.reader->rest(entry)) {
+                dispatch(input, entry);
+            }
+        }
+
+        completeRecord(input);
+    }
+
+    flushPending();
+}
+
+void Daemon::acceptConnection(Input& listener) {
+    int fd = accept4(listener.fd, NULL, NULL, SOCK_NONBLOCK);
+
+    if (fd < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            LOG_WARN("Unable to accept connection: " << strerror(errno));
+        }
+
+        return;
+    }
+
+    // Syslog connections take the channel of their port
+    addInput(CONNECTION, fd, listener.channel);
+}
+
+void Daemon::closeInput(size_t index) {
+    if (inputs_[index]->fd >= 0) close(inputs_[index]->fd);
+
+    if (inputs_[index]->writerFd >= 0) close(inputs_[index]->writerFd);
+
+    inputs_.erase(inputs_.begin() + index);
+}
+
+ssize_t Daemon::readInput(Input& input) {
+    ssize_t count;
+
+    {
+        Metrics::Timer timer(Metrics::READ);
+        count = input.reader->fill();
+    }
+
+    if (count > 0) Metrics::count(Metrics::BYTES_READ, count);
+
+    if (count < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            LOG_WARN("Source read failure: " << strerror(errno));
+            return 0;
+        }
+    }
+
+    if (!dispatchEntries(input)) return 0;
+
+    string entry;
+
+    if (count == 0 && input.channel != NULL && input.reader->rest(entry)) {
+        // End of file: send the last unterminated entry
+        dispatch(input, entry);
+    }
+
+    return count;
+}
+
+bool Daemon::dispatchEntries(Input& input) {
+    string entry;
+    bool syslog = input.channel != NULL && input.channel->format() == Channel::SYSLOG;
+
+    while (syslog ? input.reader->nextFrame(entry) : input.reader->next(entry)) {
+
+        if (!input.declared) {
+            input.declared = true;
+
+            if (entry.compare(0, Constants::SOURCE_HEADER.length(), Constants::SOURCE_HEADER) == 0) {
+                Channel* channel;
+
+                try {
+                    channel = declare(facade_, entry.substr(Constants::SOURCE_HEADER.length()));
+                }
+                catch (const exception& e) {
+                    LOG_ERROR("Connection closed: " << e.what());
+                    return false;
+                }
+
+                assign(input, channel);
+                LOG_INFO("Connection declared for topic " << input.channel->topic());
+                continue;
+            }
+
+            if (facade_.defaultChannel() == NULL) {
+                LOG_WARN("Connection closed: no source declaration and no default topic");
+                return false;
+            }
+
+            assign(input, facade_.defaultChannel());
+        }
+
+        dispatch(input, entry);
+    }
+
+    return true;
+}
+
+void Daemon::tailFiles() {
+    vector<size_t> ready;
+    size_t count;
+
+    {
+        Metrics::Timer timer(Metrics::READ);
+        count = tailer_->poll(ready);
+    }
+
+    if (count > 0) Metrics::count(Metrics::BYTES_READ, count);
+
+    for (size_t i = 0; i < ready.size(); ++i) {
+        dispatchEntries(*files_[ready[i]]);
+    }
+}
+
+int Daemon::receiveDatagrams(Input& input) {
+    int count;
+
+    {
+        Metrics::Timer timer(Metrics::READ);
+        count = recvmmsg(input.fd, &datagramHeaders_[0], datagramHeaders_.size(), MSG_DONTWAIT, NULL);
+    }
+
+    if (count < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            LOG_WARN("Syslog receive failure: " << strerror(errno));
+        }
+
+        return -1;
+    }
+
+    string entry;
+
+    for (int i = 0; i < count; ++i) {
+        if (datagramHeaders_[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            LOG_DEBUG("Syslog datagram truncated to " << Constants::SYSLOG_MAX_DATAGRAM << " bytes");
+        }
+
+        entry.assign(static_cast<const char*>(datagramVectors_[i].iov_base),
+            datagramHeaders_[i].msg_len);
+
+        Metrics::count(Metrics::BYTES_READ, datagramHeaders_[i].msg_len);
+
+        dispatch(input, entry);
+    }
+
+    return count;
+}
+
+void Daemon::assign(Input& input, Channel* channel) {
+    map<Channel*, size_t>::iterator it = assignments_.find(channel);
+
+    if (it == assignments_.end()) {
+        it = assignments_.insert(make_pair(channel, assignments_.size() % queues_.size())).first;
+    }
+
+    input.channel = channel;
+    input.worker = it->second;
+
+    if (channel->multiline() != NULL) {
+        input.assembler.reset(new MultilineAssembler(*channel->multiline()));
+    }
+}
+
+void Daemon::dispatch(Input& input, string& entry) {
+    WorkItem item;
+    item.channel = input.channel;
+
+    if (input.assembler) {
+        if (!input.assembler->add(entry, item.entry)) return;
+    }
+    else {
+        item.entry.swap(entry);
+    }
+
+    pending_[input.worker].push_back(move(item));
+}
+
+void Daemon::completeRecord(Input& input) {
+    WorkItem item;
+    item.channel = input.channel;
+
+    if (input.assembler && input.assembler->flush(item.entry)) {
+        pending_[input.worker].push_back(move(item));
+    }
+}
+
+void Daemon::expireRecords() {
+    MultilineAssembler::Clock::time_point now = MultilineAssembler::Clock::now();
+
+    for (size_t i = 0; i < inputs_.size(); ++i) {
+        Input& input = *inputs_[i];
+
+        if (input.assembler && input.assembler->expired(now)) completeRecord(input);
+    }
+}
+
+void Daemon::flushPending() {
+
+    for (size_t i = 0; i < pending_.size(); ++i) {
+        if (pending_[i].empty()) continue;
+
+        queues_[i]->push(pending_[i]);
+    }
+}
+
+void Daemon::work(size_t index) {
+
+    // Placed first, so the batches and messages it allocates are local
+    Util::pinThread(workerCpus_.empty() ? defaultCpus_ : workerCpus_[index % workerCpus_.size()]);
+
+    vector<WorkItem> batch;
+
+    // The entries are allocated by the reader thread, on its node. A placed
+    // worker copies each batch, in one pass, to buffers it allocated itself
+    // and keeps across batches, so the mapping and serialization passes read
+    // local memory and the copy doesn't allocate once the buffers are grown
+    bool copied = !workerCpus_.empty();
+    vector<string> arena;
+
+    while (queues_[index]->pop(batch)) {
+
+        if (copied) {
+            if (arena.size() < batch.size()) arena.resize(batch.size());
+
+            for (size_t i = 0; i < batch.size(); ++i) arena[i].assign(batch[i].entry);
+        }
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            try {
+                facade_.sendMessage(*batch[i].channel, copied ? arena[i] : batch[i].entry);
+            }
+            catch (exception& e) {
+                LOG_ERROR("Unexpected exception sending entry: " << e.what());
+            }
+        }
+
+        batch.clear();
+    }
+
+    if (queues_[index]->dropped() > 0) {
+        LOG_WARN("Worker " << index << " queue full: "
+            << queues_[index]->dropped() << " entries dropped");
+    }
+}
+
+void Daemon::pollDeliveries() {
+    Util::pinThread(pollerCpus_);
+
+    while (!pollerStopped_) {
+        facade_.poll(Constants::DAEMON_POLL_INTERVAL);
+    }
+}
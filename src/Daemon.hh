@@ -0,0 +1,351 @@
+/**
+ * @file Daemon.hh
+ * @brief Multiple log sources server class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifndef _LOG2KAFKA_DAEMON_HH_
+#define _LOG2KAFKA_DAEMON_HH_
+
+#include <atomic>
+#include <csignal>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+#include <sys/socket.h>
+
+#include "FileTailer.hh"
+#include "LineReader.hh"
+#include "MultilineAssembler.hh"
+#include "Sink.hh"
+#include "WorkQueue.hh"
+
+/**
+ * Long running server of many log sources.
+ *
+ * Sources are named pipes (FIFOs) declared on the command line, each with
+ * its own topic and schema, and connections to a Unix domain socket. A
+ * connection declares its topic and schema in a first header line:
+ *
+ * <b>#log2kafka &lt;topic&gt;[:&lt;partition&gt;][,&lt;schema&gt;]</b>
+ *
+ * Syslog senders are served natively on UDP and TCP ports, each port with
+ * its own topic and schema. Datagrams are received in batches and TCP
+ * connections accept both octet counted and new line framing (RFC 6587).
+ *
+ * Regular log files are followed, across rotations, by a FileTailer whose
+ * completions are waited for along with the other sources.
+ *
+ * A single thread reads all the sources. Entries are handed, in batches, to
+ * a fixed pool of worker threads that map, serialize and produce them
+ * through the shared sink. All the entries of a channel go to the
+ * same worker, so their order is preserved.
+ *
+ * The reader, each worker and the poller can be placed on their own CPUs.
+ * Each thread places itself before allocating its buffers, so they are
+ * first touched, and allocated, on the NUMA node it runs on.
+ */
+class Daemon {
+public:
+
+    /**
+     * Class constructor.
+     *
+     * @param facade the configured sink shared by all sources
+     */
+    explicit Daemon(Sink& facade);
+    virtual ~Daemon();
+
+    /*-- static methods --*/
+
+    /**
+     * Request the server to stop. Safe to call from a signal handler.
+     */
+    static void stop();
+
+    /**
+     * Thin client mode: connect to a server socket, declare the source and
+     * forward the standard input to it.
+     *
+     * @param socketPath the server Unix domain socket path
+     * @param declaration the source <b>&lt;topic&gt;[,&lt;schema&gt;]</b>
+     */
+    static void forward(const std::string& socketPath, const std::string& declaration);
+
+    /*-- methods --*/
+
+    /**
+     * Open the sources and start the worker threads.
+     */
+    void configure(const boost::program_options::variables_map& vm);
+
+    /**
+     * Serve the sources until #stop() is called, then drain the workers.
+     */
+    void run();
+
+private:
+
+    /**
+     * Kinds of sources.
+     */
+    enum Kind {
+        FIFO,       /**< named pipe */
+        CONNECTION, /**< stream socket connection, closed at EOF */
+        LISTENER,   /**< listening stream socket */
+        DATAGRAM,   /**< syslog UDP socket */
+        TAILED      /**< followed regular file, read by the tailer */
+    };
+
+    /**
+     * An open source.
+     */
+    struct Input {
+        Kind kind;
+        int fd;
+        std::unique_ptr<LineReader> reader; /**< FIFOs and connections */
+        Channel* channel;  /**< for listeners, the channel of their connections */
+        size_t worker;     /**< worker assigned to the channel */
+        int writerFd;      /**< FIFO dummy writer, keeps EOF away */
+        bool declared;     /**< header line already processed */
+        std::unique_ptr<MultilineAssembler> assembler; /**< if the channel joins lines */
+    };
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /**
+     * Stop request flag.
+     */
+    static volatile sig_atomic_t stopped_;
+
+    /*-- fields --*/
+
+    /**
+     * The sink shared by all sources.
+     */
+    Sink& facade_;
+
+    /**
+     * Open sources.
+     */
+    std::vector<std::unique_ptr<Input>> inputs_;
+
+    /**
+     * Unix domain socket path, if listening.
+     */
+    std::string socketPath_;
+
+    /**
+     * Read buffer size, which is also the maximum entry length.
+     */
+    size_t bufferSize_;
+
+    /**
+     * Maximum time waiting for input, short enough to honor the multiline
+     * records timeout.
+     */
+    int pollInterval_;
+
+    /**
+     * One queue and thread per worker.
+     */
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+
+    /**
+     * Entries read and not yet queued, per worker.
+     */
+    std::vector<std::vector<WorkItem>> pending_;
+
+    /**
+     * Syslog datagrams receive buffer, and its message headers.
+     */
+    std::vector<char> datagrams_;
+    std::vector<iovec> datagramVectors_;
+    std::vector<mmsghdr> datagramHeaders_;
+
+    /**
+     * Followed files sources, by tailer index, and their tailer.
+     */
+    std::vector<Input*> files_;
+    std::unique_ptr<FileTailer> tailer_;
+
+    /**
+     * Worker assigned to each channel.
+     */
+    std::map<Channel*, size_t> assignments_;
+
+    /**
+     * CPUs the daemon started on, kept by the threads not placed.
+     */
+    cpu_set_t defaultCpus_;
+
+    /**
+     * CPUs of the reader, of the workers (cycled) and of the poller.
+     */
+    cpu_set_t readerCpus_;
+    std::vector<cpu_set_t> workerCpus_;
+    cpu_set_t pollerCpus_;
+
+    /**
+     * Delivery reports poller thread and its stop flag.
+     */
+    std::thread poller_;
+    std::atomic<bool> pollerStopped_;
+
+    /*-- static methods --*/
+
+    /**
+     * Return the channel for a <b>&lt;topic&gt;[,&lt;schema&gt;]</b>
+     * declaration.
+     */
+    static Channel* declare(Sink& facade, const std::string& declaration,
+        Channel::Format format = Channel::LINE);
+
+    /*-- methods --*/
+
+    /**
+     * Open (creating it if needed) a FIFO declared as
+     * <b>&lt;path&gt;=&lt;topic&gt;[,&lt;schema&gt;]</b>.
+     */
+    void openFifo(const std::string& source);
+
+    /**
+     * Create and listen on the Unix domain socket.
+     */
+    void openSocket(const std::string& path);
+
+    /**
+     * Open a syslog port declared as
+     * <b>[&lt;address&gt;:]&lt;port&gt;=&lt;topic&gt;[,&lt;schema&gt;]</b>.
+     *
+     * @param source the port declaration
+     * @param type SOCK_DGRAM for UDP or SOCK_STREAM for TCP
+     */
+    void openSyslog(const std::string& source, int type);
+
+    /**
+     * Follow the files declared as
+     * <b>&lt;path or glob&gt;=&lt;topic&gt;[,&lt;schema&gt;]</b>.
+     */
+    void openFiles(const std::string& source, bool fromStart);
+
+    /**
+     * Add a source.
+     */
+    Input& addInput(Kind kind, int fd, Channel* channel);
+
+    /**
+     * Accept a pending connection on a listening socket.
+     */
+    void acceptConnection(Input& listener);
+
+    /**
+     * Close a source and forget it.
+     */
+    void closeInput(size_t index);
+
+    /**
+     * Read and dispatch the entries available in a source.
+     *
+     * @return the bytes read, 0 if the source ended or failed, or -1 if no
+     *         data was available
+     */
+    ssize_t readInput(Input& input);
+
+    /**
+     * Dispatch the complete entries buffered in a source.
+     *
+     * @return false if the source must be closed
+     */
+    bool dispatchEntries(Input& input);
+
+    /**
+     * Read and dispatch the new data of the followed files.
+     */
+    void tailFiles();
+
+    /**
+     * Receive and dispatch a batch of syslog datagrams.
+     *
+     * @return the datagrams received, or -1 if none was available
+     */
+    int receiveDatagrams(Input& input);
+
+    /**
+     * Set the channel of a source and the worker assigned to it.
+     */
+    void assign(Input& input, Channel* channel);
+
+    /**
+     * Read the CPU placement options.
+     */
+    void configurePlacement(const boost::program_options::variables_map& vm);
+
+    /**
+     * Queue an entry for the worker assigned to its source, once its
+     * record is complete.
+     */
+    void dispatch(Input& input, std::string& entry);
+
+    /**
+     * Queue the pending multiline record of a source, if any.
+     */
+    void completeRecord(Input& input);
+
+    /**
+     * Queue the multiline records that waited too long for more lines.
+     */
+    void expireRecords();
+
+    /**
+     * Hand the pending entries to the workers.
+     */
+    void flushPending();
+
+    /**
+     * Worker thread body.
+     */
+    void work(size_t index);
+
+    /**
+     * Delivery reports poller thread body.
+     */
+    void pollDeliveries();
+};
+
+#endif /* _LOG2KAFKA_DAEMON_HH_ */
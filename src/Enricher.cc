@@ -0,0 +1,172 @@
+/**
+ * @file Enricher.cc
+ * @brief Network attributes enrichment class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstring>
+
+#include "Enricher.hh"
+
+using namespace std;
+
+const char* const Enricher::FIELD_NAMES[] = { "datacenter", "vlan", "scope" };
+
+namespace {
+
+/**
+ * Scope of the addresses out of every network.
+ */
+const string EXTERNAL_SCOPE("external");
+
+/**
+ * Recent addresses cached per thread, and longest address text cached.
+ */
+const size_t RECENT_SIZE = 256;
+const size_t RECENT_TEXT = 46;
+
+/**
+ * A recent address, valid for the table of its generation.
+ */
+struct Recent {
+    uint64_t generation; /**< 0 if empty */
+    size_t length;
+    char text[RECENT_TEXT];
+    const NetworkMap::Network* network;
+};
+
+thread_local Recent recent[RECENT_SIZE];
+
+/**
+ * Slot of an address text in the cache (FNV-1a).
+ */
+inline size_t slot(const string& text) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < text.length(); ++i) {
+        hash = (hash ^ static_cast<uint8_t>(text[i])) * 1099511628211ULL;
+    }
+
+    return hash % RECENT_SIZE;
+}
+
+} // namespace
+
+/*-- constructors/destructor --*/
+
+Enricher::Enricher(shared_ptr<NetworkMap> networks) :
+    networks_(networks), table_(networks->table()), address_(0) {
+}
+
+Enricher::~Enricher() {
+}
+
+/*-- methods --*/
+
+bool Enricher::bind(const Mapper& mapper, const string& field) {
+    fields_.clear();
+
+    if (!mapper.fieldIndex(field, address_)) return false;
+
+    for (size_t attribute = 0; attribute < FIELD_COUNT; ++attribute) {
+        size_t index;
+
+        if (mapper.fieldIndex(FIELD_NAMES[attribute], index)) {
+            fields_.push_back(make_pair(attribute, index));
+        }
+    }
+
+    return true;
+}
+
+void Enricher::enrich(avro::GenericDatum& datum) {
+
+    if (datum.type() != avro::AVRO_RECORD || fields_.empty()) return;
+
+    // A reloaded table is taken between records
+    if (networks_->generation() != table_->generation()) table_ = networks_->table();
+
+    if (table_->size() == 0) return;
+
+    avro::GenericRecord& record = datum.value<avro::GenericRecord>();
+    const avro::GenericDatum& address = record.fieldAt(address_);
+
+    if (address.type() != avro::AVRO_STRING) return;
+
+    const NetworkMap::Network* network;
+
+    if (!lookup(address.value<string>(), network)) return;
+
+    for (size_t i = 0; i < fields_.size(); ++i) {
+        const string* value;
+
+        switch (fields_[i].first) {
+        case 0:
+            value = network ? &network->datacenter : NULL;
+            break;
+        case 1:
+            value = network ? &network->vlan : NULL;
+            break;
+        default:
+            value = network ? &network->scope : &EXTERNAL_SCOPE;
+        }
+
+        // Fields without a value keep their default
+        if (value == NULL) continue;
+
+        Mapper::convert(record.fieldAt(fields_[i].second), value->data(),
+            value->data() + value->length());
+    }
+}
+
+bool Enricher::lookup(const string& text, const NetworkMap::Network*& network) const {
+    Recent* entry = NULL;
+
+    if (text.length() < RECENT_TEXT) {
+        entry = &recent[slot(text)];
+
+        if (entry->generation == table_->generation() && entry->length == text.length()
+            && memcmp(entry->text, text.data(), text.length()) == 0) {
+
+            network = entry->network;
+            return true;
+        }
+    }
+
+    uint8_t address[16];
+
+    if (!NetworkMap::parse(text.c_str(), address)) return false;
+
+    network = table_->lookup(address);
+
+    if (entry != NULL) {
+        entry->generation = table_->generation();
+        entry->length = text.length();
+        memcpy(entry->text, text.data(), text.length());
+        entry->network = network;
+    }
+
+    return true;
+}
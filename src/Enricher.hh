@@ -0,0 +1,119 @@
+/**
+ * @file Enricher.hh
+ * @brief Network attributes enrichment class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_ENRICHER_HH_
+#define _LOG2KAFKA_ENRICHER_HH_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Mapper.hh"
+#include "NetworkMap.hh"
+
+/**
+ * Enrichment of mapped records with the attributes of the network of an
+ * address field (ej. the client <b>host</b>): the record fields named in
+ * #FIELD_NAMES, when defined in the schema after the mapped fields,
+ * receive the datacenter, the VLAN and the scope of the network.
+ * Addresses out of every network have the <b>external</b> scope.
+ *
+ * Recent addresses are cached per thread, by the table they were looked
+ * up in, so a reloaded table is never mixed with the previous one.
+ */
+class Enricher {
+public:
+
+    /**
+     * Enriched field names, in the order of the network attributes.
+     */
+    static const char* const FIELD_NAMES[];
+    static const size_t FIELD_COUNT = 3;
+
+    /**
+     * Class constructor.
+     *
+     * @param networks the networks map to look the addresses up in
+     */
+    explicit Enricher(std::shared_ptr<NetworkMap> networks);
+    virtual ~Enricher();
+
+    /*-- methods --*/
+
+    /**
+     * Bind the address field and the enriched fields of a record schema.
+     *
+     * @param mapper the record schema
+     * @param field the address field name
+     * @return false if the schema has no such address field
+     */
+    bool bind(const Mapper& mapper, const std::string& field);
+
+    /**
+     * Set the enriched fields of a mapped record. Records whose address
+     * field is not an address, or with no networks loaded, are left as
+     * they are.
+     */
+    void enrich(avro::GenericDatum& datum);
+
+private:
+
+    /*-- fields --*/
+
+    /**
+     * Networks map, and the table in use.
+     */
+    std::shared_ptr<NetworkMap> networks_;
+    std::shared_ptr<const NetworkMap::Table> table_;
+
+    /**
+     * Address field index.
+     */
+    size_t address_;
+
+    /**
+     * Enriched fields, as network attribute and record field indexes.
+     */
+    std::vector<std::pair<size_t, size_t>> fields_;
+
+    /*-- methods --*/
+
+    /**
+     * Look an address up, in the thread cache first.
+     *
+     * @param[in] text the address
+     * @param[out] network its network, or NULL if none
+     * @return false if the text is not an address
+     */
+    bool lookup(const std::string& text, const NetworkMap::Network*& network) const;
+};
+
+#endif /* _LOG2KAFKA_ENRICHER_HH_ */
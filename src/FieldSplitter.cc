@@ -0,0 +1,213 @@
+/**
+ * @file FieldSplitter.cc
+ * @brief Delimited and logfmt entries field splitter class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "FieldSplitter.hh"
+#include "Mapper.hh"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Return the first of three characters, or the end.
+ */
+const char* findAny(const char* p, const char* end, char a, char b, char c) {
+
+#ifdef __SSE2__
+    const __m128i first = _mm_set1_epi8(a);
+    const __m128i second = _mm_set1_epi8(b);
+    const __m128i third = _mm_set1_epi8(c);
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+        __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chunk, first),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, second), _mm_cmpeq_epi8(chunk, third)));
+
+        int mask = _mm_movemask_epi8(found);
+
+        if (mask != 0) return p + __builtin_ctz(mask);
+
+        p += 16;
+    }
+#endif
+
+    while (p < end && *p != a && *p != b && *p != c) ++p;
+
+    return p;
+}
+
+} // namespace
+
+/*-- constructors/destructor --*/
+
+FieldSplitter::FieldSplitter(char delimiter, bool pairs) :
+    delimiter_(delimiter), pairs_(pairs), quote_(delimiter), escape_(delimiter),
+    hasEscape_(false) {
+}
+
+FieldSplitter::~FieldSplitter() {
+}
+
+/*-- getters/setters --*/
+
+void FieldSplitter::quote(char quote) {
+    quote_ = quote != '\0' ? quote : delimiter_;
+}
+
+void FieldSplitter::escape(char escape) {
+    escape_ = escape != '\0' ? escape : delimiter_;
+    hasEscape_ = escape != '\0';
+}
+
+bool FieldSplitter::pairs() const {
+    return pairs_;
+}
+
+/*-- methods --*/
+
+void FieldSplitter::bind(size_t column, size_t field) {
+
+    if (columns_.size() <= column) columns_.resize(column + 1, -1);
+
+    columns_[column] = static_cast<int>(field);
+}
+
+void FieldSplitter::bind(const string& key, size_t field) {
+    keys_.push_back(make_pair(key, field));
+}
+
+void FieldSplitter::split(avro::GenericDatum& datum, const string& entry) const {
+
+    if (datum.type() != avro::AVRO_RECORD) return;
+
+    avro::GenericRecord& record = datum.value<avro::GenericRecord>();
+
+    const char* p = entry.data();
+    const char* end = p + entry.length();
+
+    string buffer;
+    size_t column = 0;
+
+    // Columns after the last one bound are not scanned
+    while (pairs_ || column < columns_.size()) {
+        const char* begin = p;
+        bool quoted = false;
+
+        for (;;) {
+            p = findAny(p, end, delimiter_, quote_, escape_);
+
+            if (p == end || *p == delimiter_) break;
+
+            quoted = true;
+
+            if (*p == escape_) {
+                p = min(p + 2, end);
+                continue;
+            }
+
+            // Quoted text, up to the closing quote, which may contain the
+            // delimiter
+            for (++p;;) {
+                p = findAny(p, end, quote_, hasEscape_ ? escape_ : quote_, quote_);
+
+                if (p == end) throw invalid_argument("Unterminated quoted field");
+
+                if (*p == quote_) break;
+
+                p = min(p + 2, end);
+            }
+
+            ++p;
+        }
+
+        if (pairs_) {
+            const char* equals = static_cast<const char*>(memchr(begin, '=', p - begin));
+
+            if (equals != NULL) {
+                size_t length = equals - begin;
+
+                for (size_t i = 0; i < keys_.size(); ++i) {
+                    const string& key = keys_[i].first;
+
+                    if (key.length() == length && memcmp(key.data(), begin, length) == 0) {
+                        set(record.fieldAt(keys_[i].second), equals + 1, p, quoted, buffer);
+                        break;
+                    }
+                }
+            }
+        }
+        else {
+            if (columns_[column] >= 0) {
+                set(record.fieldAt(columns_[column]), begin, p, quoted, buffer);
+            }
+
+            ++column;
+        }
+
+        if (p == end) break;
+
+        ++p; // delimiter
+    }
+}
+
+void FieldSplitter::set(avro::GenericDatum& field, const char* begin, const char* end,
+    bool quoted, string& buffer) const {
+
+    if (!quoted) {
+        Mapper::convert(field, begin, end);
+        return;
+    }
+
+    buffer.clear();
+
+    for (const char* p = begin; p < end; ++p) {
+        if (*p == quote_) continue;
+
+        if (hasEscape_ && *p == escape_ && p + 1 < end) {
+            switch (*++p) {
+            case 'n': buffer += '\n'; break;
+            case 'r': buffer += '\r'; break;
+            case 't': buffer += '\t'; break;
+            default: buffer += *p;
+            }
+        }
+        else {
+            buffer += *p;
+        }
+    }
+
+    Mapper::convert(field, buffer.data(), buffer.data() + buffer.length());
+}
@@ -0,0 +1,151 @@
+/**
+ * @file FieldSplitter.hh
+ * @brief Delimited and logfmt entries field splitter class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_FIELD_SPLITTER_HH_
+#define _LOG2KAFKA_FIELD_SPLITTER_HH_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <avro/Generic.hh>
+
+/**
+ * Map delimiter separated entries to the fields of a record datum, without
+ * regular expressions.
+ *
+ * In column mode the n-th field of the entry goes to the record field bound
+ * to column n. In pairs mode (logfmt) the entry is a list of
+ * <b>&lt;key&gt;=&lt;value&gt;</b> fields and each value goes to the
+ * record field bound to its key. Fields can be enclosed in quotes, which
+ * may contain the delimiter, and characters can be escaped.
+ *
+ * The entry is scanned 16 bytes at a time (SSE2) for the delimiter, quote
+ * and escape characters, and the values are converted straight into the
+ * field types.
+ */
+class FieldSplitter {
+public:
+
+    /**
+     * Class constructor.
+     *
+     * @param delimiter the fields separator
+     * @param pairs true if the fields are key-value pairs
+     */
+    FieldSplitter(char delimiter, bool pairs);
+    virtual ~FieldSplitter();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Set the quote character, none if <b>'\0'</b>.
+     */
+    void quote(char quote);
+
+    /**
+     * Set the escape character, none if <b>'\0'</b>.
+     */
+    void escape(char escape);
+
+    /**
+     * Return true if the fields are key-value pairs.
+     */
+    bool pairs() const;
+
+    /*-- methods --*/
+
+    /**
+     * Bind a column to a record field.
+     */
+    void bind(size_t column, size_t field);
+
+    /**
+     * Bind a key to a record field.
+     */
+    void bind(const std::string& key, size_t field);
+
+    /**
+     * Set the record fields bound to the columns or keys of an entry.
+     * Fields not present keep their default value.
+     *
+     * @param datum the record datum to fill
+     * @param entry the entry text
+     * @throw std::invalid_argument if a quoted field is not terminated
+     */
+    void split(avro::GenericDatum& datum, const std::string& entry) const;
+
+private:
+
+    /*-- fields --*/
+
+    /**
+     * Fields separator.
+     */
+    char delimiter_;
+
+    /**
+     * Whether the fields are key-value pairs.
+     */
+    bool pairs_;
+
+    /**
+     * Quote and escape characters, or the delimiter if none, so they can
+     * be scanned for together.
+     */
+    char quote_;
+    char escape_;
+
+    /**
+     * Whether an escape character is set.
+     */
+    bool hasEscape_;
+
+    /**
+     * Record field of each column, or -1.
+     */
+    std::vector<int> columns_;
+
+    /**
+     * Record field of each key.
+     */
+    std::vector<std::pair<std::string, size_t>> keys_;
+
+    /*-- methods --*/
+
+    /**
+     * Convert a field value and set it, removing quotes and escapes if the
+     * value has any.
+     */
+    void set(avro::GenericDatum& field, const char* begin, const char* end, bool quoted,
+        std::string& buffer) const;
+};
+
+#endif /* _LOG2KAFKA_FIELD_SPLITTER_HH_ */
@@ -0,0 +1,239 @@
+/**
+ * @file FileSink.cc
+ * @brief Local rolling files sink class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <chrono>
+
+#include <boost/filesystem.hpp>
+
+#include "FileSink.hh"
+#include "Metrics.hh"
+
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr FileSink::logger(Logger::getLogger("FileSink"));
+#endif
+
+/*-- constructors/destructor --*/
+
+FileSink::FileSink() : directory_(Constants::DEFAULT_SINK_DIRECTORY), defaultChannel_(NULL),
+    stopped_(false) {
+}
+
+FileSink::~FileSink() {
+    shutdown();
+}
+
+/*-- getters/setters --*/
+
+Channel* FileSink::channel(const string& topic, const string& schema, Channel::Format format) {
+
+    string id = topic + "," + schema + (format == Channel::SYSLOG ? ",syslog" : "");
+    lock_guard<mutex> lock(channelsMutex_);
+
+    for (size_t i = 0; i < channels_.size(); ++i) {
+        if (channels_[i].first == id) return channels_[i].second.get();
+    }
+
+    LOG_DEBUG("New file channel for topic: " << topic << ", schema: " << schema);
+
+    unique_ptr<Channel> channel(new Channel());
+    channel->topic(topic);
+
+    if (!schema.empty()) channel->serializer(schema);
+
+    channel->format(format);
+    channel->configure(options_, NULL, NULL);
+
+    // The writer adds the container header and blocks around the records
+    channel->bareRecords(true);
+
+    shared_ptr<Serializer> serializer = channel->serializer();
+
+    if (serializer && serializer->output() != Serializer::DATUM) serializer.reset();
+
+    // Channels of the same topic with different schemas get their own files
+    string name = channel->topic();
+
+    if (!schema.empty()) name += "-" + boost::filesystem::path(schema).stem().string();
+
+    {
+        lock_guard<mutex> lock(writersMutex_);
+
+        channel->destination(writers_.size());
+        writers_.push_back(makeWriter(name, serializer));
+    }
+
+    channels_.push_back(make_pair(id, move(channel)));
+    return channels_.back().second.get();
+}
+
+Channel* FileSink::defaultChannel() const {
+    return defaultChannel_;
+}
+
+/*-- methods --*/
+
+void FileSink::configure(const boost::program_options::variables_map& vm) {
+
+    options_ = vm;
+
+    if (vm.count("sink.directory")) directory_ = vm["sink.directory"].as<string>();
+
+    boost::filesystem::create_directories(directory_);
+
+    LOG_DEBUG("Writing messages to " << directory_);
+
+    failed_ = makeWriter(vm.count("dead-letter.topic") ? vm["dead-letter.topic"].as<string>()
+        : Constants::DEFAULT_SINK_FAILED_NAME, shared_ptr<Serializer>());
+
+    if (vm.count("kafka.topic")) {
+        defaultChannel_ = channel(vm["kafka.topic"].as<string>(),
+            vm.count("schema") ? vm["schema"].as<string>() : "");
+    }
+}
+
+bool FileSink::warmUp() {
+    return true;
+}
+
+int FileSink::flush(int timeout) {
+    lock_guard<mutex> lock(writersMutex_);
+
+    for (size_t i = 0; i < writers_.size(); ++i) writers_[i]->tick();
+
+    if (failed_) failed_->tick();
+
+    return 0;
+}
+
+void FileSink::poll(int timeout) {
+    flush(timeout);
+
+    // Nothing to wait for but the next writes, callers loop on poll()
+    unique_lock<mutex> lock(stoppedMutex_);
+    stoppedChanged_.wait_for(lock, chrono::milliseconds(timeout), [this] { return stopped_; });
+}
+
+int FileSink::reload() {
+    lock_guard<mutex> lock(channelsMutex_);
+    int failed = 0;
+
+    for (size_t i = 0; i < channels_.size(); ++i) {
+        if (!channels_[i].second->reload()) ++failed;
+    }
+
+    return failed;
+}
+
+int FileSink::shutdown() {
+    {
+        lock_guard<mutex> lock(stoppedMutex_);
+        stopped_ = true;
+    }
+
+    stoppedChanged_.notify_all();
+
+    lock_guard<mutex> lock(writersMutex_);
+
+    for (size_t i = 0; i < writers_.size(); ++i) writers_[i]->close();
+
+    if (failed_) failed_->close();
+
+    return 0;
+}
+
+void FileSink::sendMessage(Channel& channel, const string& message) {
+
+    string failure;
+    auto_ptr<avro::OutputStream> dataOutput = avro::memoryOutputStream();
+
+    if (message.length() == 0) {
+        LOG_WARN("Empty message entry discarded");
+        return;
+    }
+
+    Metrics::count(Metrics::ENTRIES_RECEIVED);
+
+    if (!channel.encode(message, dataOutput, failure)) return;
+
+    ContainerWriter& target = failure.empty() ? writer(channel) : *failed_;
+    size_t length = message.length();
+
+    if (channel.isRaw() || !failure.empty()) {
+        target.append(message.data(), length);
+    }
+    else if (channel.serializer()->output() == Serializer::DATUM) {
+        length = dataOutput->byteCount();
+
+        // A reloaded schema starts a new file
+        target.serializer(channel.serializer());
+
+        auto_ptr<avro::InputStream> dataInput = avro::memoryInputStream(*dataOutput);
+        target.append(*dataInput);
+    }
+    else {
+        // JSON messages, one per line
+        length = dataOutput->byteCount();
+
+        string line(length, '\0');
+        auto_ptr<avro::InputStream> dataInput = avro::memoryInputStream(*dataOutput);
+        avro::StreamReader reader(*dataInput);
+        reader.readBytes(reinterpret_cast<uint8_t*>(&line[0]), length);
+
+        target.append(line.data(), length);
+    }
+
+    Metrics::count(Metrics::MESSAGES_PRODUCED);
+    Metrics::count(Metrics::BYTES_PRODUCED, length);
+}
+
+unique_ptr<ContainerWriter> FileSink::makeWriter(const string& name,
+    const shared_ptr<Serializer>& serializer) {
+
+    unique_ptr<ContainerWriter> writer(new ContainerWriter(
+        (boost::filesystem::path(directory_) / name).string(), serializer));
+
+    writer->rollSize(static_cast<uint64_t>(options_.count("sink.roll-size")
+        ? options_["sink.roll-size"].as<int>() : Constants::DEFAULT_SINK_ROLL_SIZE) * 1024 * 1024);
+    writer->rollInterval(options_.count("sink.roll-interval")
+        ? options_["sink.roll-interval"].as<int>() : Constants::DEFAULT_SINK_ROLL_INTERVAL);
+    writer->blockRecords(options_.count("sink.block-records")
+        ? options_["sink.block-records"].as<int>() : Constants::DEFAULT_SINK_BLOCK_RECORDS);
+    writer->deflate((options_.count("sink.codec") ? options_["sink.codec"].as<string>()
+        : Constants::DEFAULT_SINK_CODEC) == "deflate");
+
+    return writer;
+}
+
+ContainerWriter& FileSink::writer(const Channel& channel) {
+    lock_guard<mutex> lock(writersMutex_);
+    return *writers_[channel.destination()];
+}
@@ -0,0 +1,192 @@
+/**
+ * @file FileSink.hh
+ * @brief Local rolling files sink class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_FILE_SINK_HH_
+#define _LOG2KAFKA_FILE_SINK_HH_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ContainerWriter.hh"
+#include "Sink.hh"
+
+/**
+ * Sink writing the messages to local files instead of kafka, for hosts
+ * without brokers or to stage data for batch loading.
+ *
+ * Each channel writes to its own rolling files, named after its topic in
+ * the sink directory: Avro object containers for the channels with a
+ * schema and AVRO output, new line separated messages otherwise. Entries
+ * that fail to serialize go raw to a separate lines file, named after the
+ * dead-letter topic.
+ */
+class FileSink: public Sink {
+public:
+
+    FileSink();
+    virtual ~FileSink();
+
+    /*-- getters/setters --*/
+
+    /**
+     * @copydoc Sink::channel()
+     */
+    virtual Channel* channel(const std::string& topic, const std::string& schema,
+        Channel::Format format = Channel::LINE);
+
+    /**
+     * @copydoc Sink::defaultChannel()
+     */
+    virtual Channel* defaultChannel() const;
+
+    /*-- methods --*/
+
+    /**
+     * Prepare the sink directory and the failed entries file.
+     *
+     * If a topic is given in the options, it becomes the default channel.
+     */
+    virtual void configure(const boost::program_options::variables_map& vm);
+
+    /**
+     * Nothing to prepare, files are opened with the first message.
+     *
+     * @return always true
+     */
+    virtual bool warmUp();
+
+    /**
+     * Write the pending messages of every file.
+     *
+     * @return always 0, writes are synchronous
+     */
+    virtual int flush(int timeout);
+
+    /**
+     * Write the pending messages that waited long enough and roll the old
+     * files, then wait for the timeout or the shutdown.
+     */
+    virtual void poll(int timeout);
+
+    /**
+     * @copydoc Sink::reload()
+     */
+    virtual int reload();
+
+    /**
+     * Write the pending messages and close the files.
+     *
+     * @return always 0
+     */
+    virtual int shutdown();
+
+    using Sink::sendMessage;
+
+    /**
+     * Write a message to the files of the given channel.
+     *
+     * @param channel the channel to use
+     * @param message the message to be sent
+     */
+    virtual void sendMessage(Channel& channel, const std::string& message);
+
+private:
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /*-- fields --*/
+
+    /**
+     * Program options, used to configure new channels and writers.
+     */
+    boost::program_options::variables_map options_;
+
+    /**
+     * Files directory.
+     */
+    std::string directory_;
+
+    /**
+     * Channels created so far, with their topic and schema.
+     */
+    std::vector<std::pair<std::string, std::unique_ptr<Channel>>> channels_;
+    std::mutex channelsMutex_;
+
+    /**
+     * The channel of the topic given in the options, if any.
+     */
+    Channel* defaultChannel_;
+
+    /**
+     * Writer of each channel, by channel destination index, and the writer
+     * of the entries that failed to serialize.
+     */
+    std::vector<std::unique_ptr<ContainerWriter>> writers_;
+    std::unique_ptr<ContainerWriter> failed_;
+
+    /**
+     * Guards the writers list, which the poller thread walks.
+     */
+    std::mutex writersMutex_;
+
+    /**
+     * Whether the sink is shut down, which ends the poll() waits.
+     */
+    bool stopped_;
+    std::mutex stoppedMutex_;
+    std::condition_variable stoppedChanged_;
+
+    /*-- methods --*/
+
+    /**
+     * Return a new writer of the files with the given name, configured by
+     * the options.
+     */
+    std::unique_ptr<ContainerWriter> makeWriter(const std::string& name,
+        const std::shared_ptr<Serializer>& serializer);
+
+    /**
+     * Return the writer of a channel.
+     */
+    ContainerWriter& writer(const Channel& channel);
+};
+
+#endif /* _LOG2KAFKA_FILE_SINK_HH_ */
@@ -0,0 +1,391 @@
+/**
+ * @file FileTailer.cc
+ * @brief Log files tailer class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBURING
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#endif
+
+#include "FileTailer.hh"
+
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr FileTailer::logger(Logger::getLogger("FileTailer"));
+#endif
+
+/*-- constructors/destructor --*/
+
+FileTailer::FileTailer(Engine engine, size_t depth, int interval) :
+    engine_(engine), depth_(max(depth, size_t(1))), interval_(chrono::milliseconds(interval)),
+    reading_(0), cursor_(0), eventFd_(-1) {
+
+#ifdef HAVE_LIBURING
+    registered_ = false;
+#else
+    if (engine_ == URING) {
+        LOG_WARN("Not built with liburing, reading files with pread()");
+        engine_ = READ;
+    }
+#endif
+}
+
+FileTailer::~FileTailer() {
+
+#ifdef HAVE_LIBURING
+    if (eventFd_ >= 0) {
+
+        // The kernel writes to the reader buffers until the reads complete
+        while (reading_ > 0) {
+            io_uring_cqe* cqe;
+
+            if (io_uring_wait_cqe(&ring_, &cqe) < 0) break;
+
+            io_uring_cqe_seen(&ring_, cqe);
+            --reading_;
+        }
+
+        io_uring_queue_exit(&ring_);
+        close(eventFd_);
+    }
+#endif
+
+    for (size_t i = 0; i < files_.size(); ++i) {
+        if (files_[i].fd >= 0) close(files_[i].fd);
+    }
+}
+
+/*-- getters/setters --*/
+
+FileTailer::Engine FileTailer::engine() const {
+    return engine_;
+}
+
+int FileTailer::fd() const {
+    return eventFd_;
+}
+
+/*-- methods --*/
+
+size_t FileTailer::add(const string& path, LineReader& reader, bool fromStart) {
+    File file;
+
+    file.path = path;
+    file.fd = -1;
+    file.device = 0;
+    file.inode = 0;
+    file.offset = 0;
+    file.reader = &reader;
+    file.reading = false;
+    file.idle = false;
+    file.due = Clock::now();
+
+    if (!open(file, fromStart)) {
+        LOG_WARN("File " << path << " not available, waiting for it");
+        file.idle = true;
+    }
+
+    files_.push_back(file);
+    return files_.size() - 1;
+}
+
+void FileTailer::start() {
+
+#ifdef HAVE_LIBURING
+    if (engine_ == URING) {
+        int result = io_uring_queue_init(depth_, &ring_, 0);
+
+        if (result < 0) {
+            LOG_WARN("Unable to set up io_uring: " << strerror(-result) << ". Reading files with pread()");
+            engine_ = READ;
+        }
+        else {
+            eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+            if (eventFd_ < 0 || io_uring_register_eventfd(&ring_, eventFd_) < 0) {
+                LOG_WARN("Unable to set up io_uring completions eventfd. Reading files with pread()");
+
+                if (eventFd_ >= 0) close(eventFd_);
+                eventFd_ = -1;
+                io_uring_queue_exit(&ring_);
+                engine_ = READ;
+            }
+        }
+    }
+
+    if (engine_ == URING && !files_.empty()) {
+
+        // Nothing was read yet, so each reader reserves its whole buffer
+        vector<iovec> buffers(files_.size());
+
+        for (size_t i = 0; i < files_.size(); ++i) {
+            buffers[i].iov_base = files_[i].reader->reserve(buffers[i].iov_len);
+        }
+
+        registered_ = io_uring_register_buffers(&ring_, &buffers[0], buffers.size()) == 0;
+
+        if (!registered_) LOG_INFO("Unable to register the file buffers with io_uring");
+    }
+#endif
+
+    LOG_INFO("Following " << files_.size() << " files with "
+        << (engine_ == URING ? "io_uring" : "pread()"));
+}
+
+int FileTailer::timeout(int maximum) const {
+    Clock::time_point now = Clock::now();
+    Clock::duration wait = chrono::milliseconds(maximum);
+
+    for (size_t i = 0; i < files_.size(); ++i) {
+        const File& file = files_[i];
+
+        if (file.reading) continue;
+
+        // With io_uring, files waiting for room in flight wait for completions
+        if (!file.idle) {
+            if (engine_ == READ || reading_ < depth_) return 0;
+            continue;
+        }
+
+        wait = min(wait, file.due - now);
+    }
+
+    if (wait <= Clock::duration::zero()) return 0;
+
+    return min<int>(chrono::duration_cast<chrono::milliseconds>(wait).count() + 1, maximum);
+}
+
+size_t FileTailer::poll(vector<size_t>& ready) {
+    ready.clear();
+
+#ifdef HAVE_LIBURING
+    if (engine_ == URING) return ringFiles(ready);
+#endif
+
+    return readFiles(ready);
+}
+
+bool FileTailer::open(File& file, bool fromStart) {
+    int fd = ::open(file.path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+    if (fd < 0) {
+        if (errno != ENOENT) LOG_WARN("Unable to open file " << file.path << ": " << strerror(errno));
+        return false;
+    }
+
+    struct stat status;
+
+    if (fstat(fd, &status) < 0 || !S_ISREG(status.st_mode)) {
+        LOG_WARN("File " << file.path << " is not a regular file");
+
+        close(fd);
+        return false;
+    }
+
+    if (file.fd >= 0) close(file.fd);
+
+    file.fd = fd;
+    file.device = status.st_dev;
+    file.inode = status.st_ino;
+    file.offset = fromStart ? 0 : status.st_size;
+
+    return true;
+}
+
+bool FileTailer::due(File& file, Clock::time_point now) {
+
+    if (file.reading) return false;
+    if (!file.idle) return true;
+    if (now < file.due) return false;
+
+    check(file);
+
+    file.idle = file.fd < 0;
+    file.due = now + interval_;
+
+    return !file.idle;
+}
+
+void FileTailer::check(File& file) {
+    struct stat status;
+
+    // Missing, ej. rotated and not created again yet: keep the old one
+    if (stat(file.path.c_str(), &status) < 0) return;
+
+    if (file.fd < 0) {
+        if (open(file, true)) LOG_INFO("Following file " << file.path);
+        return;
+    }
+
+    if (status.st_dev != file.device || status.st_ino != file.inode) {
+        struct stat old;
+
+        // Rotated: the old file is read to its end before the new one
+        if (fstat(file.fd, &old) == 0 && old.st_size > file.offset) return;
+
+        if (open(file, true)) LOG_INFO("Following file " << file.path << " after its rotation");
+        return;
+    }
+
+    if (status.st_size < file.offset) {
+        LOG_INFO("File " << file.path << " truncated, reading it from the beginning");
+        file.offset = 0;
+    }
+}
+
+size_t FileTailer::complete(size_t index, ssize_t result, vector<size_t>& ready) {
+    File& file = files_[index];
+
+    if (result > 0) {
+        file.reader->commit(result);
+        file.offset += result;
+        ready.push_back(index);
+
+        return result;
+    }
+
+    if (result == -EAGAIN || result == -EINTR) return 0; // tried again
+
+    if (result < 0) LOG_WARN("Unable to read file " << file.path << ": " << strerror(-result));
+
+    file.idle = true;
+    file.due = Clock::now() + interval_;
+
+    return 0;
+}
+
+size_t FileTailer::readFiles(vector<size_t>& ready) {
+    Clock::time_point now = Clock::now();
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < files_.size(); ++i) {
+        File& file = files_[i];
+
+        if (!due(file, now)) continue;
+
+        size_t size;
+        char* buffer = file.reader->reserve(size);
+
+        if (size == 0) continue;
+
+        ssize_t count = pread(file.fd, buffer, size, file.offset);
+
+        bytes += complete(i, count < 0 ? -errno : count, ready);
+    }
+
+    return bytes;
+}
+
+#ifdef HAVE_LIBURING
+size_t FileTailer::ringFiles(vector<size_t>& ready) {
+    uint64_t posted;
+
+    // Rearm the eventfd before collecting, so no completion goes unnoticed
+    if (read(eventFd_, &posted, sizeof(posted)) < 0 && errno != EAGAIN) {
+        LOG_WARN("Unable to read io_uring eventfd: " << strerror(errno));
+    }
+
+    size_t bytes = reap(ready);
+
+    /* Queue a read per file with room, submitted together */
+
+    Clock::time_point now = Clock::now();
+    size_t queued = 0;
+    size_t n = 0;
+
+    for (; n < files_.size() && reading_ < depth_; ++n) {
+        size_t index = (cursor_ + n) % files_.size();
+        File& file = files_[index];
+
+        if (!due(file, now)) continue;
+
+        size_t size;
+        char* buffer = file.reader->reserve(size);
+
+        if (size == 0) continue;
+
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+
+        if (sqe == NULL) break;
+
+        if (registered_) {
+            io_uring_prep_read_fixed(sqe, file.fd, buffer, size, file.offset, index);
+        }
+        else {
+            io_uring_prep_read(sqe, file.fd, buffer, size, file.offset);
+        }
+
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(index)));
+
+        file.reading = true;
+        ++reading_;
+        ++queued;
+    }
+
+    cursor_ = files_.empty() ? 0 : (cursor_ + n) % files_.size();
+
+    if (queued > 0) {
+        int result = io_uring_submit(&ring_);
+
+        // Left in the submission queue, tried again on the next call
+        if (result < 0) LOG_WARN("Unable to submit file reads: " << strerror(-result));
+    }
+
+    return bytes;
+}
+
+size_t FileTailer::reap(vector<size_t>& ready) {
+    size_t bytes = 0;
+    io_uring_cqe* cqe;
+
+    while (io_uring_peek_cqe(&ring_, &cqe) == 0) {
+        size_t index = reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe));
+        ssize_t result = cqe->res;
+
+        io_uring_cqe_seen(&ring_, cqe);
+
+        files_[index].reading = false;
+        --reading_;
+
+        bytes += complete(index, result, ready);
+    }
+
+    return bytes;
+}
+#endif
@@ -0,0 +1,255 @@
+/**
+ * @file FileTailer.hh
+ * @brief Log files tailer class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_FILE_TAILER_HH_
+#define _LOG2KAFKA_FILE_TAILER_HH_
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "config.hh"
+#include "LineReader.hh"
+
+/**
+ * Follower of many regular log files, ej. the per virtual host logs of a
+ * shared web server, filling a line reader per file.
+ *
+ * Regular files are always readable for poll(), so they can not share the
+ * daemon sources loop. With the io_uring engine (if built with liburing),
+ * a read of each file with room in its buffer is kept in flight, straight
+ * into the line reader buffer (registered with the kernel when possible),
+ * and all of them are submitted with a single system call; their
+ * completions are signalled on an eventfd that the sources loop polls.
+ * With the read engine, each file is read with pread() in turn.
+ *
+ * A file at its end is checked again after an interval: for new data, for
+ * rotation (a new file at its path, read from the beginning once the old
+ * one is exhausted) and for truncation. Missing files are waited for.
+ */
+class FileTailer {
+public:
+
+    /**
+     * Reading engines.
+     */
+    enum Engine {
+        URING, /**< asynchronous reads with io_uring */
+        READ   /**< synchronous reads with pread() */
+    };
+
+    /**
+     * Class constructor.
+     *
+     * @param engine the reading engine, READ if not built with liburing
+     * @param depth maximum reads in flight with io_uring
+     * @param interval milliseconds between checks of a file at its end
+     */
+    FileTailer(Engine engine, size_t depth, int interval);
+    virtual ~FileTailer();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Return the engine in use, READ if io_uring was not available.
+     */
+    Engine engine() const;
+
+    /**
+     * Return the descriptor readable when reads complete, or -1 with the
+     * read engine.
+     */
+    int fd() const;
+
+    /*-- methods --*/
+
+    /**
+     * Follow a file. The reader buffer must not move while followed.
+     *
+     * @param path the file path
+     * @param reader the reader its data goes to
+     * @param fromStart read the data already in the file
+     * @return the file index
+     */
+    size_t add(const std::string& path, LineReader& reader, bool fromStart);
+
+    /**
+     * Start reading, after all the files were added.
+     */
+    void start();
+
+    /**
+     * Return the time until #poll() has work to do.
+     *
+     * @param maximum the time returned if no file needs it sooner
+     * @return the milliseconds to wait, 0 if data can be read now
+     */
+    int timeout(int maximum) const;
+
+    /**
+     * Collect the completed reads and start new ones, without waiting.
+     *
+     * @param[out] ready the indexes of the files with new data
+     * @return the bytes read
+     */
+    size_t poll(std::vector<size_t>& ready);
+
+private:
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * A followed file.
+     */
+    struct File {
+        std::string path;
+        int fd;
+        dev_t device;
+        ino_t inode;
+        off_t offset;
+        LineReader* reader;
+        bool reading;          /**< read in flight */
+        bool idle;             /**< at its end, or missing */
+        Clock::time_point due; /**< next check, if idle */
+    };
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /*-- fields --*/
+
+    /**
+     * The reading engine.
+     */
+    Engine engine_;
+
+    /**
+     * Maximum reads in flight with io_uring.
+     */
+    size_t depth_;
+
+    /**
+     * Time between checks of a file at its end.
+     */
+    Clock::duration interval_;
+
+    /**
+     * Followed files.
+     */
+    std::vector<File> files_;
+
+    /**
+     * Reads in flight.
+     */
+    size_t reading_;
+
+    /**
+     * File the next reads start from, so all get their turn when there are
+     * more files than reads in flight.
+     */
+    size_t cursor_;
+
+#ifdef HAVE_LIBURING
+    /**
+     * The io_uring instance, and whether the line reader buffers are
+     * registered with it.
+     */
+    io_uring ring_;
+    bool registered_;
+#endif
+
+    /**
+     * Completions eventfd, with the io_uring engine.
+     */
+    int eventFd_;
+
+    /*-- methods --*/
+
+    /**
+     * Open a file, at its beginning or at its end.
+     *
+     * @return false if it could not be opened
+     */
+    bool open(File& file, bool fromStart);
+
+    /**
+     * Return whether a file is to be read now, checking it first if it
+     * was idle and its time came.
+     */
+    bool due(File& file, Clock::time_point now);
+
+    /**
+     * Check an idle file for rotation and truncation, opening it if it was
+     * missing.
+     */
+    void check(File& file);
+
+    /**
+     * Account a read result.
+     *
+     * @param index the file index
+     * @param result the bytes read, 0 at the end of the file or -errno
+     * @param[out] ready the indexes of the files with new data
+     * @return the bytes read
+     */
+    size_t complete(size_t index, ssize_t result, std::vector<size_t>& ready);
+
+    /**
+     * Read the files with the read engine.
+     */
+    size_t readFiles(std::vector<size_t>& ready);
+
+#ifdef HAVE_LIBURING
+    /**
+     * Collect the completions and submit new reads with the io_uring
+     * engine.
+     */
+    size_t ringFiles(std::vector<size_t>& ready);
+
+    /**
+     * Collect the completions posted.
+     */
+    size_t reap(std::vector<size_t>& ready);
+#endif
+};
+
+#endif /* _LOG2KAFKA_FILE_TAILER_HH_ */
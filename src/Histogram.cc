@@ -0,0 +1,89 @@
+/**
+ * @file Histogram.cc
+ * @brief Latency histogram class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "Histogram.hh"
+
+using namespace std;
+
+/*-- constructors/destructor --*/
+
+Histogram::Histogram() {
+
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts_[i].store(0, memory_order_relaxed);
+    }
+
+    sum_.store(0, memory_order_relaxed);
+}
+
+Histogram::~Histogram() {
+}
+
+/*-- getters/setters --*/
+
+uint64_t Histogram::count(size_t bucket) const {
+    return counts_[bucket].load(memory_order_relaxed);
+}
+
+uint64_t Histogram::sum() const {
+    return sum_.load(memory_order_relaxed);
+}
+
+/*-- methods --*/
+
+void Histogram::record(uint64_t value) {
+    atomic<uint64_t>& count = counts_[bucket(value)];
+
+    // Single writer: plain load and store, no locked instruction needed
+    count.store(count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    sum_.store(sum_.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+/*-- static methods --*/
+
+size_t Histogram::bucket(uint64_t value) {
+    const uint64_t linear = 1 << SUB_BUCKET_BITS;
+
+    if (value < linear) return value;
+
+    int magnitude = 63 - __builtin_clzll(value);
+    uint64_t subBucket = (value >> (magnitude - SUB_BUCKET_BITS)) & (linear - 1);
+
+    return ((magnitude - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + subBucket;
+}
+
+uint64_t Histogram::lowerBound(size_t bucket) {
+    const uint64_t linear = 1 << SUB_BUCKET_BITS;
+
+    if (bucket < linear) return bucket;
+
+    int magnitude = (bucket >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+    uint64_t subBucket = bucket & (linear - 1);
+
+    return (linear + subBucket) << (magnitude - SUB_BUCKET_BITS);
+}
@@ -0,0 +1,110 @@
+/**
+ * @file Histogram.hh
+ * @brief Latency histogram class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_HISTOGRAM_HH_
+#define _LOG2KAFKA_HISTOGRAM_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Log-linear (HDR style) histogram of non negative values, ej. latencies in
+ * nanoseconds.
+ *
+ * Each power of two range is split in 4 linear sub-buckets, so any value is
+ * counted with a relative error under 25% using a fixed and small array.
+ *
+ * Recording is lock free but assumes a single writer: each thread records
+ * in its own instance (see Metrics), and readers add them up.
+ */
+class Histogram {
+public:
+
+    /**
+     * Linear sub-buckets per power of two, as bits.
+     */
+    static const int SUB_BUCKET_BITS = 2;
+
+    /**
+     * Number of buckets, enough for any 64 bits value.
+     */
+    static const size_t BUCKET_COUNT = 64 << SUB_BUCKET_BITS;
+
+    Histogram();
+    virtual ~Histogram();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Return the count of values recorded in a bucket.
+     */
+    uint64_t count(size_t bucket) const;
+
+    /**
+     * Return the sum of the values recorded.
+     */
+    uint64_t sum() const;
+
+    /*-- methods --*/
+
+    /**
+     * Record a value. Only the owner thread may call it.
+     */
+    void record(uint64_t value);
+
+    /*-- static methods --*/
+
+    /**
+     * Return the bucket of a value.
+     */
+    static size_t bucket(uint64_t value);
+
+    /**
+     * Return the lowest value of a bucket.
+     */
+    static uint64_t lowerBound(size_t bucket);
+
+private:
+
+    /*-- fields --*/
+
+    /**
+     * Counts per bucket.
+     */
+    std::atomic<uint64_t> counts_[BUCKET_COUNT];
+
+    /**
+     * Sum of the values recorded.
+     */
+    std::atomic<uint64_t> sum_;
+};
+
+#endif /* _LOG2KAFKA_HISTOGRAM_HH_ */
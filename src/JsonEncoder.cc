@@ -0,0 +1,307 @@
+/**
+ * @file JsonEncoder.cc
+ * @brief Avro datum to JSON encoder class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "JsonEncoder.hh"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Two digits of every number below 100, to format integers by pairs.
+ */
+const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+inline bool needsEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+/**
+ * Return the first character that needs escaping, or the end.
+ */
+const char* findEscape(const char* p, const char* end) {
+
+#ifdef __SSE2__
+    const __m128i controlLimit = _mm_set1_epi8(0x1F);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+        // Unsigned c <= 0x1F is max(c, 0x1F) == 0x1F
+        __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(chunk, controlLimit), controlLimit);
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+            _mm_cmpeq_epi8(chunk, backslash));
+
+        int mask = _mm_movemask_epi8(_mm_or_si128(control, special));
+
+        if (mask != 0) return p + __builtin_ctz(mask);
+
+        p += 16;
+    }
+#endif
+
+    while (p < end && !needsEscape(*p)) ++p;
+
+    return p;
+}
+
+} // namespace
+
+/*-- constructors/destructor --*/
+
+JsonEncoder::JsonEncoder() {
+}
+
+JsonEncoder::~JsonEncoder() {
+}
+
+/*-- getters/setters --*/
+
+const string& JsonEncoder::buffer() const {
+    return buffer_;
+}
+
+/*-- methods --*/
+
+void JsonEncoder::encode(const avro::GenericDatum& datum) {
+    buffer_.clear(); // keeps the capacity
+    append(datum);
+}
+
+void JsonEncoder::append(const avro::GenericDatum& datum) {
+
+    // Unions are transparent, the datum type is the one of its branch
+    switch (datum.type()) {
+    case avro::AVRO_NULL:
+        buffer_ += "null";
+        break;
+
+    case avro::AVRO_BOOL:
+        buffer_ += datum.value<bool>() ? "true" : "false";
+        break;
+
+    case avro::AVRO_INT:
+        appendInteger(buffer_, datum.value<int32_t>());
+        break;
+
+    case avro::AVRO_LONG:
+        appendInteger(buffer_, datum.value<int64_t>());
+        break;
+
+    case avro::AVRO_FLOAT:
+        appendReal(buffer_, datum.value<float>(), true);
+        break;
+
+    case avro::AVRO_DOUBLE:
+        appendReal(buffer_, datum.value<double>(), false);
+        break;
+
+    case avro::AVRO_STRING: {
+        const string& value = datum.value<string>();
+        appendString(buffer_, value.data(), value.length());
+        break;
+    }
+
+    case avro::AVRO_BYTES: {
+        const vector<uint8_t>& value = datum.value<vector<uint8_t>>();
+        appendString(buffer_, reinterpret_cast<const char*>(value.data()), value.size());
+        break;
+    }
+
+    case avro::AVRO_FIXED: {
+        const vector<uint8_t>& value = datum.value<avro::GenericFixed>().value();
+        appendString(buffer_, reinterpret_cast<const char*>(value.data()), value.size());
+        break;
+    }
+
+    case avro::AVRO_ENUM: {
+        const string& symbol = datum.value<avro::GenericEnum>().symbol();
+        appendString(buffer_, symbol.data(), symbol.length());
+        break;
+    }
+
+    case avro::AVRO_RECORD: {
+        const avro::GenericRecord& record = datum.value<avro::GenericRecord>();
+        const avro::NodePtr& schema = record.schema();
+
+        buffer_ += '{';
+
+        for (size_t i = 0; i < record.fieldCount(); ++i) {
+            if (i > 0) buffer_ += ',';
+
+            const string& name = schema->nameAt(i);
+
+            appendString(buffer_, name.data(), name.length());
+            buffer_ += ':';
+            append(record.fieldAt(i));
+        }
+
+        buffer_ += '}';
+        break;
+    }
+
+    case avro::AVRO_ARRAY: {
+        const avro::GenericArray::Value& items = datum.value<avro::GenericArray>().value();
+
+        buffer_ += '[';
+
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i > 0) buffer_ += ',';
+            append(items[i]);
+        }
+
+        buffer_ += ']';
+        break;
+    }
+
+    case avro::AVRO_MAP: {
+        const avro::GenericMap::Value& entries = datum.value<avro::GenericMap>().value();
+
+        buffer_ += '{';
+
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (i > 0) buffer_ += ',';
+
+            appendString(buffer_, entries[i].first.data(), entries[i].first.length());
+            buffer_ += ':';
+            append(entries[i].second);
+        }
+
+        buffer_ += '}';
+        break;
+    }
+
+    default:
+        buffer_ += "null";
+    }
+}
+
+/*-- static methods --*/
+
+void JsonEncoder::appendString(string& out, const char* data, size_t length) {
+    const char* p = data;
+    const char* end = data + length;
+
+    out += '"';
+
+    for (;;) {
+        const char* special = findEscape(p, end);
+
+        out.append(p, special - p);
+
+        if (special == end) break;
+
+        switch (*special) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            out += "\\u00";
+            out += HEX_DIGITS[(*special >> 4) & 0x0F];
+            out += HEX_DIGITS[*special & 0x0F];
+        }
+
+        p = special + 1;
+    }
+
+    out += '"';
+}
+
+void JsonEncoder::appendInteger(string& out, int64_t value) {
+    char text[24];
+    char* end = text + sizeof(text);
+    char* p = end;
+
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+
+    while (magnitude >= 100) {
+        const char* pair = DIGIT_PAIRS + (magnitude % 100) * 2;
+
+        magnitude /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+
+    if (magnitude >= 10) {
+        const char* pair = DIGIT_PAIRS + magnitude * 2;
+
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    else {
+        *--p = static_cast<char>('0' + magnitude);
+    }
+
+    if (value < 0) *--p = '-';
+
+    out.append(p, end - p);
+}
+
+void JsonEncoder::appendReal(string& out, double value, bool single) {
+
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+
+    // Integral values, the common case of mapped numbers, without printf
+    if (value == std::floor(value) && std::fabs(value) < 1e15) {
+        appendInteger(out, static_cast<int64_t>(value));
+        return;
+    }
+
+    // Shortest of the two usual precisions that reads back the same value
+    char text[32];
+
+    snprintf(text, sizeof(text), "%.*g", single ? 6 : 15, value);
+
+    double parsed = strtod(text, NULL);
+
+    if (single ? static_cast<float>(parsed) != static_cast<float>(value) : parsed != value) {
+        snprintf(text, sizeof(text), "%.*g", single ? 9 : 17, value);
+    }
+
+    out += text;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file JsonEncoder.hh
+ * @brief Avro datum to JSON encoder class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_JSON_ENCODER_HH_
+#define _LOG2KAFKA_JSON_ENCODER_HH_
+
+#include <cstdint>
+#include <string>
+
+#include <avro/Generic.hh>
+
+/**
+ * Writes mapped datums as JSON documents, one object per record with the
+ * schema field names as keys.
+ *
+ * The document is written into a buffer reused from one datum to the next,
+ * so encoding does not allocate once the buffer has grown. Strings are
+ * scanned 16 bytes at a time (SSE2) for characters that need escaping.
+ */
+class JsonEncoder {
+public:
+
+    JsonEncoder();
+    virtual ~JsonEncoder();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Return the last document encoded.
+     */
+    const std::string& buffer() const;
+
+    /*-- methods --*/
+
+    /**
+     * Encode a datum, replacing the buffer content.
+     */
+    void encode(const avro::GenericDatum& datum);
+
+    /*-- static methods --*/
+
+    /**
+     * Append a quoted and escaped JSON string.
+     */
+    static void appendString(std::string& out, const char* data, size_t length);
+
+    /**
+     * Append an integer number.
+     */
+    static void appendInteger(std::string& out, int64_t value);
+
+    /**
+     * Append a real number with the shortest text that reads back the same
+     * value, or null if it is not finite.
+     *
+     * @param out the output
+     * @param value the number
+     * @param single true if the value is a float, to round trip as a float
+     */
+    static void appendReal(std::string& out, double value, bool single);
+
+private:
+
+    /*-- fields --*/
+
+    /**
+     * Document buffer.
+     */
+    std::string buffer_;
+
+    /*-- methods --*/
+
+    /**
+     * Append a datum of any type.
+     */
+    void append(const avro::GenericDatum& datum);
+};
+
+#endif /* _LOG2KAFKA_JSON_ENCODER_HH_ */
@@ -0,0 +1,443 @@
+/**
+ * @file JsonExtractor.cc
+ * @brief JSON entries field extractor class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "JsonExtractor.hh"
+#include "Mapper.hh"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Report an entry that is not valid JSON.
+ */
+void invalid() {
+    throw invalid_argument("Invalid JSON entry");
+}
+
+/**
+ * Return the first quote or backslash, or the end.
+ */
+const char* findQuote(const char* p, const char* end) {
+
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+            _mm_cmpeq_epi8(chunk, backslash)));
+
+        if (mask != 0) return p + __builtin_ctz(mask);
+
+        p += 16;
+    }
+#endif
+
+    while (p < end && *p != '"' && *p != '\\') ++p;
+
+    return p;
+}
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/**
+ * Return the value of 4 hexadecimal digits.
+ */
+uint32_t hexValue(const char* p, const char* end) {
+    uint32_t value = 0;
+
+    if (end - p < 4) invalid();
+
+    for (int i = 0; i < 4; ++i) {
+        char c = p[i];
+
+        value <<= 4;
+
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else invalid();
+    }
+
+    return value;
+}
+
+void appendUtf8(string& out, uint32_t code) {
+
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    }
+    else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+/**
+ * Decode the content of a string with escape sequences.
+ */
+void unescape(const char* p, const char* end, string& out) {
+    out.clear();
+
+    for (;;) {
+        const char* backslash = findQuote(p, end); // no quotes inside
+
+        out.append(p, backslash - p);
+
+        if (backslash == end) break;
+
+        p = backslash + 2;
+
+        switch (backslash[1]) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+
+        case 'u': {
+            uint32_t code = hexValue(p, end);
+
+            p += 4;
+
+            // Characters out of the basic plane come as surrogate pairs
+            if (code >= 0xD800 && code <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                uint32_t low = hexValue(p + 2, end);
+
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+            }
+
+            appendUtf8(out, code);
+            break;
+        }
+
+        default: // quote, backslash and slash
+            out += backslash[1];
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * Cursor over an entry and the fields still to find.
+ */
+struct JsonExtractor::Scan {
+    const char* p;
+    const char* end;
+    size_t remaining;
+
+    void space() {
+        while (p < end && isSpace(*p)) ++p;
+    }
+
+    void expect(char c) {
+        space();
+
+        if (p == end || *p != c) invalid();
+
+        ++p;
+    }
+
+    /**
+     * Skip a string, the cursor being past its opening quote.
+     *
+     * @return true if the content has escape sequences
+     */
+    bool string(const char*& begin, const char*& stop) {
+        bool escaped = false;
+
+        begin = p;
+
+        for (;;) {
+            p = findQuote(p, end);
+
+            if (end - p < 2) {
+                if (p == end || *p != '"') invalid();
+            }
+
+            if (*p == '"') break;
+
+            escaped = true;
+            p += 2;
+        }
+
+        stop = p++;
+
+        return escaped;
+    }
+
+    /**
+     * Skip a number or a literal.
+     */
+    void scalar(const char*& begin, const char*& stop) {
+        begin = p;
+
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && !isSpace(*p)) ++p;
+
+        stop = p;
+
+        if (begin == stop) invalid();
+    }
+
+    /**
+     * Skip a value of any type.
+     */
+    void skip() {
+        const char* begin;
+        const char* stop;
+
+        space();
+
+        if (p == end) invalid();
+
+        if (*p == '"') {
+            ++p;
+            string(begin, stop);
+        }
+        else if (*p == '{' || *p == '[') {
+            // Containers are only balanced, not validated
+            size_t depth = 0;
+
+            do {
+                char c = *p++;
+
+                if (c == '"') string(begin, stop);
+                else if (c == '{' || c == '[') ++depth;
+                else if (c == '}' || c == ']') --depth;
+            } while (depth > 0 && p < end);
+
+            if (depth > 0) invalid();
+        }
+        else {
+            scalar(begin, stop);
+        }
+    }
+
+    /**
+     * Convert a value to the type of a record field and set it. A null value
+     * leaves the field unchanged.
+     */
+    void set(avro::GenericDatum& field) {
+        const char* begin;
+        const char* stop;
+        bool escaped = false;
+
+        space();
+
+        if (p == end) invalid();
+
+        if (*p == '"') {
+            ++p;
+            escaped = string(begin, stop);
+        }
+        else if (*p == '{' || *p == '[') {
+            // Containers are kept as JSON text
+            begin = p;
+            skip();
+            stop = p;
+        }
+        else {
+            scalar(begin, stop);
+
+            if (stop - begin == 4 && memcmp(begin, "null", 4) == 0) return;
+        }
+
+        if (escaped) {
+            std::string value;
+
+            unescape(begin, stop, value);
+            Mapper::convert(field, value.data(), value.data() + value.length());
+        }
+        else {
+            Mapper::convert(field, begin, stop);
+        }
+    }
+};
+
+/*-- constructors/destructor --*/
+
+JsonExtractor::JsonExtractor() :
+    bound_(0) {
+
+    Node root;
+    root.field = -1;
+    nodes_.push_back(root);
+}
+
+JsonExtractor::~JsonExtractor() {
+}
+
+/*-- methods --*/
+
+void JsonExtractor::bind(size_t field, const string& path) {
+    size_t node = 0;
+    size_t begin = 0;
+
+    for (;;) {
+        size_t dot = path.find('.', begin);
+        string key = path.substr(begin, dot == string::npos ? string::npos : dot - begin);
+
+        size_t child = 0;
+
+        for (size_t i = 0; i < nodes_[node].children.size(); ++i) {
+            if (nodes_[node].children[i].first == key) child = nodes_[node].children[i].second;
+        }
+
+        if (child == 0) {
+            Node step;
+            step.field = -1;
+
+            child = nodes_.size();
+            nodes_.push_back(step);
+            nodes_[node].children.push_back(make_pair(key, child));
+        }
+
+        node = child;
+
+        if (dot == string::npos) break;
+
+        begin = dot + 1;
+    }
+
+    if (nodes_[node].field < 0) ++bound_;
+
+    nodes_[node].field = static_cast<int>(field);
+}
+
+void JsonExtractor::extract(avro::GenericDatum& datum, const string& entry) const {
+
+    if (datum.type() != avro::AVRO_RECORD) return;
+
+    Scan scan = { entry.data(), entry.data() + entry.length(), bound_ };
+
+    object(scan, 0, datum.value<avro::GenericRecord>());
+
+    if (scan.remaining > 0) {
+        scan.space();
+
+        if (scan.p != scan.end) invalid();
+    }
+}
+
+void JsonExtractor::object(Scan& scan, size_t node, avro::GenericRecord& record) const {
+    const vector<pair<string, size_t>>& children = nodes_[node].children;
+    string unescaped;
+
+    scan.expect('{');
+    scan.space();
+
+    if (scan.p < scan.end && *scan.p == '}') {
+        ++scan.p;
+        return;
+    }
+
+    for (;;) {
+        const char* key;
+        const char* keyEnd;
+
+        scan.expect('"');
+
+        if (scan.string(key, keyEnd)) {
+            unescape(key, keyEnd, unescaped);
+            key = unescaped.data();
+            keyEnd = key + unescaped.length();
+        }
+
+        scan.expect(':');
+
+        size_t length = keyEnd - key;
+        size_t child = 0;
+
+        for (size_t i = 0; i < children.size(); ++i) {
+            const string& name = children[i].first;
+
+            if (name.length() == length && memcmp(name.data(), key, length) == 0) {
+                child = children[i].second;
+                break;
+            }
+        }
+
+        if (child == 0) {
+            scan.skip();
+        }
+        else if (nodes_[child].field >= 0) {
+            scan.set(record.fieldAt(nodes_[child].field));
+
+            // Stop as soon as everything was found
+            if (--scan.remaining == 0) return;
+        }
+        else {
+            scan.space();
+
+            if (scan.p < scan.end && *scan.p == '{') {
+                object(scan, child, record);
+
+                if (scan.remaining == 0) return;
+            }
+            else {
+                scan.skip();
+            }
+        }
+
+        scan.space();
+
+        if (scan.p == scan.end) invalid();
+
+        char c = *scan.p++;
+
+        if (c == '}') return;
+        if (c != ',') invalid();
+    }
+}
@@ -0,0 +1,110 @@
+/**
+ * @file JsonExtractor.hh
+ * @brief JSON entries field extractor class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_JSON_EXTRACTOR_HH_
+#define _LOG2KAFKA_JSON_EXTRACTOR_HH_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <avro/Generic.hh>
+
+/**
+ * Map JSON object entries to the fields of a record datum.
+ *
+ * Each record field is bound to a path of object keys separated by dots
+ * (ej. <b>request.method</b>). The entry is scanned once, without building
+ * any document: values of keys not on a path are skipped (strings 16 bytes
+ * at a time with SSE2) and the values found are converted straight into the
+ * field types. The scan stops as soon as all the paths are found.
+ */
+class JsonExtractor {
+public:
+
+    JsonExtractor();
+    virtual ~JsonExtractor();
+
+    /*-- methods --*/
+
+    /**
+     * Bind a record field to a path.
+     *
+     * @param field the field position in the record
+     * @param path the object keys separated by dots
+     */
+    void bind(size_t field, const std::string& path);
+
+    /**
+     * Set the record fields bound to the paths found in an entry. Fields
+     * whose path is not found, or is null, keep their default value.
+     *
+     * @param datum the record datum to fill
+     * @param entry the JSON object text
+     * @throw std::invalid_argument if the entry is not a valid JSON object
+     */
+    void extract(avro::GenericDatum& datum, const std::string& entry) const;
+
+private:
+
+    /**
+     * A path step, the root being the entry object.
+     */
+    struct Node {
+        std::vector<std::pair<std::string, size_t>> children; /**< key and node */
+        int field; /**< record field bound to the node, or -1 */
+    };
+
+    /**
+     * A scan of an entry.
+     */
+    struct Scan;
+
+    /*-- fields --*/
+
+    /**
+     * Path steps, starting with the root.
+     */
+    std::vector<Node> nodes_;
+
+    /**
+     * Number of fields bound.
+     */
+    size_t bound_;
+
+    /*-- methods --*/
+
+    /**
+     * Scan an object, the cursor being at its opening brace.
+     */
+    void object(Scan& scan, size_t node, avro::GenericRecord& record) const;
+};
+
+#endif /* _LOG2KAFKA_JSON_EXTRACTOR_HH_ */
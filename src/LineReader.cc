@@ -0,0 +1,152 @@
+/**
+ * @file LineReader.cc
+ * @brief Buffered line reader class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cctype>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "LineReader.hh"
+#include "MemoryBudget.hh"
+
+using namespace std;
+
+/*-- constructors/destructor --*/
+
+LineReader::LineReader(int fd, size_t capacity) :
+    fd_(fd), buffer_(capacity), begin_(0), end_(0) {
+
+    MemoryBudget::charge(MemoryBudget::INPUT, buffer_.size());
+}
+
+LineReader::~LineReader() {
+    MemoryBudget::release(MemoryBudget::INPUT, buffer_.size());
+}
+
+/*-- getters/setters --*/
+
+int LineReader::fd() const {
+    return fd_;
+}
+
+/*-- methods --*/
+
+ssize_t LineReader::fill() {
+    size_t size;
+    char* buffer = reserve(size);
+
+    if (size == 0) return 1; // full, next() will split it
+
+    ssize_t count = receive(buffer, size);
+
+    if (count > 0) commit(count);
+
+    return count;
+}
+
+char* LineReader::reserve(size_t& size) {
+
+    // Make room at the end of the buffer
+    if (begin_ > 0) {
+        memmove(&buffer_[0], &buffer_[begin_], end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+
+    size = buffer_.size() - end_;
+
+    return &buffer_[0] + end_;
+}
+
+void LineReader::commit(size_t count) {
+    end_ += count;
+}
+
+bool LineReader::next(string& line) {
+    const char* begin = &buffer_[0] + begin_;
+    const char* newline = static_cast<const char*>(memchr(begin, '\n', end_ - begin_));
+
+    if (newline == NULL) {
+        // A line as long as the buffer is split
+        if (begin_ == 0 && end_ == buffer_.size()) return rest(line);
+
+        return false;
+    }
+
+    size_t length = newline - begin;
+
+    line.assign(begin, length);
+    begin_ += length + 1;
+
+    return true;
+}
+
+bool LineReader::nextFrame(string& frame) {
+    const char* begin = &buffer_[0] + begin_;
+    size_t available = end_ - begin_;
+
+    if (available == 0 || !isdigit(*begin)) return next(frame);
+
+    /* MSG-LEN SP SYSLOG-MSG */
+
+    size_t length = 0;
+    size_t digits = 0;
+
+    while (digits < available && digits < 10 && isdigit(begin[digits])) {
+        length = length * 10 + (begin[digits++] - '0');
+    }
+
+    if (digits == available) return false; // length not complete yet
+
+    if (begin[digits] != ' ' || length == 0) return next(frame); // not octet counted
+
+    if (available - digits - 1 < length) {
+        // A frame longer than the buffer is split
+        if (begin_ == 0 && end_ == buffer_.size()) return rest(frame);
+
+        return false;
+    }
+
+    frame.assign(begin + digits + 1, length);
+    begin_ += digits + 1 + length;
+
+    return true;
+}
+
+bool LineReader::rest(string& line) {
+
+    if (begin_ == end_) return false;
+
+    line.assign(&buffer_[begin_], end_ - begin_);
+    begin_ = end_ = 0;
+
+    return true;
+}
+
+ssize_t LineReader::receive(char* buffer, size_t size) {
+    return read(fd_, buffer, size);
+}
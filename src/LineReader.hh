@@ -0,0 +1,157 @@
+/**
+ * @file LineReader.hh
+ * @brief Buffered line reader class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifndef _LOG2KAFKA_LINE_READER_HH_
+#define _LOG2KAFKA_LINE_READER_HH_
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+/**
+ * Buffered line reader over a file descriptor.
+ *
+ * Reads as much data as available with a single read() call into a reusable
+ * buffer and then splits it in lines. Usable with non-blocking descriptors:
+ * the reader never blocks more than the descriptor itself.
+ *
+ * Lines longer than the buffer capacity are split in pieces of that size.
+ * The buffer is charged to the input stage of the MemoryBudget.
+ */
+class LineReader {
+public:
+
+    /**
+     * Class constructor.
+     *
+     * @param fd the file descriptor to read, not owned by the reader
+     * @param capacity the buffer size, which is also the maximum line length
+     */
+    explicit LineReader(int fd, size_t capacity);
+    virtual ~LineReader();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Return the file descriptor read.
+     */
+    int fd() const;
+
+    /*-- methods --*/
+
+    /**
+     * Read the data available in the file descriptor.
+     *
+     * @return the bytes read, 0 at end of file or -1 on error (see errno)
+     */
+    ssize_t fill();
+
+    /**
+     * Make room at the end of the buffer, for data read by other means
+     * than #fill(), ej. asynchronously. Only #next(), #nextFrame() and
+     * #rest() may be called until the data is committed.
+     *
+     * @param[out] size the room available
+     * @return where the data goes
+     */
+    char* reserve(size_t& size);
+
+    /**
+     * Add the data written after #reserve() to the buffer.
+     *
+     * @param count the bytes written
+     */
+    void commit(size_t count);
+
+    /**
+     * Extract the next complete line, without the line terminator.
+     *
+     * @param[out] line the line read
+     * @return false if no complete line is buffered
+     */
+    bool next(std::string& line);
+
+    /**
+     * Extract the next complete syslog frame (RFC 6587): octet counted
+     * (<b>&lt;length&gt; &lt;frame&gt;</b>) if it starts with a digit,
+     * otherwise new line terminated as with #next().
+     *
+     * @param[out] frame the frame read
+     * @return false if no complete frame is buffered
+     */
+    bool nextFrame(std::string& frame);
+
+    /**
+     * Extract the incomplete line left in the buffer, if any. Used at end
+     * of file.
+     *
+     * @param[out] line the line read
+     * @return false if the buffer is empty
+     */
+    bool rest(std::string& line);
+
+protected:
+
+    /*-- methods --*/
+
+    /**
+     * Read data into the buffer, by default with read() from the file
+     * descriptor.
+     *
+     * @return the bytes read, 0 at end of file or -1 on error (see errno)
+     */
+    virtual ssize_t receive(char* buffer, size_t size);
+
+private:
+
+    /*-- fields --*/
+
+    /**
+     * The file descriptor read.
+     */
+    int fd_;
+
+    /**
+     * Read buffer.
+     */
+    std::vector<char> buffer_;
+
+    /**
+     * Start of the unconsumed data in the buffer.
+     */
+    size_t begin_;
+
+    /**
+     * End of the data in the buffer.
+     */
+    size_t end_;
+};
+
+#endif /* _LOG2KAFKA_LINE_READER_HH_ */
@@ -0,0 +1,344 @@
+/**
+ * @file Log.cc
+ * @brief Asynchronous console log class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "Log.hh"
+
+using namespace std;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+/**
+ * A ring slot. The sequence tells its state to producers and consumer
+ * (bounded multiple producers queue, after D. Vyukov).
+ */
+struct Slot {
+    atomic<size_t> sequence;
+    Log::Level level;
+    uint16_t length;
+    char text[Log::RECORD_SIZE];
+};
+
+const char* const LEVEL_NAMES[] = { "TRACE: ", "DEBUG: ", "INFO: ", "WARN: ", "ERROR: ", "FATAL: " };
+
+Slot ring[Log::RING_SIZE];
+
+atomic<size_t> tail(0);  // next slot to fill
+size_t head = 0;          // next slot to drain, consumer only
+
+atomic<uint64_t> dropped(0);
+
+/**
+ * Call sites seen, a lock-free stack of the sites' own nodes.
+ */
+atomic<Log::Site*> sites(NULL);
+
+/**
+ * Suppressed records summary period, which is also the longest sleep of
+ * the background thread, in ms.
+ */
+const int SUMMARY_INTERVAL = 1000;
+
+once_flag started;
+thread drainer;
+atomic<bool> stopped(false);
+
+/**
+ * Background thread wake up event, and whether it sleeps.
+ */
+int wakeFd = -1;
+atomic<bool> sleeping(false);
+
+/**
+ * Stream reused by the records of a thread, and whether it is in use.
+ */
+thread_local ostringstream localStream;
+thread_local bool formatting = false;
+
+int64_t currentSecond() {
+    return chrono::duration_cast<chrono::seconds>(Clock::now().time_since_epoch()).count();
+}
+
+void start() {
+
+    for (size_t i = 0; i < Log::RING_SIZE; ++i) ring[i].sequence.store(i, memory_order_relaxed);
+
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    atexit(Log::flush);
+}
+
+void wakeUp() {
+    uint64_t one = 1;
+
+    if (wakeFd >= 0 && ::write(wakeFd, &one, sizeof(one)) < 0) {
+        // Already signaled
+    }
+}
+
+/**
+ * Return true if the next slot to drain is filled.
+ */
+bool pending() {
+    return ring[head & (Log::RING_SIZE - 1)].sequence.load(memory_order_acquire) == head + 1;
+}
+
+} // namespace
+
+const size_t Log::RECORD_SIZE;
+
+/*-- site --*/
+
+Log::Site::Site(Level level, const char* file, int line) :
+    level_(level), file_(file), line_(line), second_(0), admitted_(0), suppressed_(0),
+    next_(sites.load()) {
+
+    while (!sites.compare_exchange_weak(next_, this)) {
+    }
+}
+
+bool Log::Site::admit() {
+    int64_t now = currentSecond();
+    int64_t second = second_.load(memory_order_relaxed);
+
+    // First record of a new second resets the window, approximately
+    if (now != second && second_.compare_exchange_strong(second, now)) {
+        admitted_.store(0, memory_order_relaxed);
+    }
+
+    if (admitted_.fetch_add(1, memory_order_relaxed) < RATE_LIMIT) return true;
+
+    suppressed_.fetch_add(1, memory_order_relaxed);
+
+    return false;
+}
+
+/*-- record --*/
+
+Log::Record::Record(Site& site) :
+    site_(site), nested_(formatting ? new ostringstream() : NULL),
+    stream_(nested_ ? *nested_ : localStream) {
+
+    if (!nested_) {
+        formatting = true;
+        stream_.str("");
+    }
+}
+
+Log::Record::~Record() {
+    uint32_t suppressed = site_.suppressed_.exchange(0, memory_order_relaxed);
+
+    if (suppressed > 0) stream_ << " (" << suppressed << " similar messages suppressed)";
+
+    push(site_.level_, stream_.str());
+
+    if (!nested_) formatting = false;
+}
+
+ostream& Log::Record::stream() {
+    return stream_;
+}
+
+/*-- static methods --*/
+
+void Log::flush() {
+    stopped = true;
+    wakeUp();
+
+    if (drainer.joinable()) drainer.join();
+}
+
+string Log::printable(const void* data, size_t length) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    string text;
+    char escaped[8];
+
+    for (size_t i = 0; i < length && text.length() < RECORD_SIZE; ++i) {
+        if (bytes[i] >= 0x20 && bytes[i] < 0x7F) {
+            text += bytes[i];
+        }
+        else {
+            snprintf(escaped, sizeof(escaped), "\\x%02X", bytes[i]);
+            text += escaped;
+        }
+    }
+
+    return text;
+}
+
+void Log::push(Level level, const string& text) {
+    call_once(started, [] {
+        start();
+        drainer = thread(Log::drain);
+    });
+
+    // Past flush() at exit, nobody drains the ring
+    if (stopped.load()) {
+        string record = LEVEL_NAMES[level] + text + "\n";
+
+        if (::write(level >= ERROR_LEVEL ? STDERR_FILENO : STDOUT_FILENO, record.data(),
+            record.length()) < 0) {
+        }
+
+        return;
+    }
+
+    size_t position = tail.load(memory_order_relaxed);
+    Slot* slot;
+
+    for (;;) {
+        slot = &ring[position & (RING_SIZE - 1)];
+
+        size_t sequence = slot->sequence.load(memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        if (difference == 0) {
+            if (tail.compare_exchange_weak(position, position + 1, memory_order_relaxed)) break;
+        }
+        else if (difference < 0) {
+            dropped.fetch_add(1, memory_order_relaxed); // full
+            return;
+        }
+        else {
+            position = tail.load(memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->length = min(text.length(), RECORD_SIZE);
+    memcpy(slot->text, text.data(), slot->length);
+
+    slot->sequence.store(position + 1, memory_order_release);
+
+    // Both sides exchange the flag, so either the thread sees the record
+    // before sleeping or the record sees the thread asleep
+    if (sleeping.exchange(false)) wakeUp();
+}
+
+void Log::drain() {
+    string out;
+    string err;
+    int64_t summarized = currentSecond();
+    char buffer[64];
+
+    for (;;) {
+        bool stopping = stopped.load();
+
+        /* Queued records, up to a batch per stream */
+
+        while (out.length() < 64 * 1024 && err.length() < 64 * 1024 && pending()) {
+            Slot& slot = ring[head & (RING_SIZE - 1)];
+
+            string& stream = slot.level >= ERROR_LEVEL ? err : out;
+
+            stream += LEVEL_NAMES[slot.level];
+            stream.append(slot.text, slot.length);
+            stream += '\n';
+
+            slot.sequence.store(head + RING_SIZE, memory_order_release);
+            ++head;
+        }
+
+        /* Once a second, the suppressed records of quiet sites, and the
+         * dropped ones */
+
+        int64_t now = currentSecond();
+
+        if (now != summarized || stopping) {
+            summarized = now;
+
+            for (Site* site = sites.load(); site != NULL; site = site->next_) {
+                if (site->second_.load(memory_order_relaxed) == now && !stopping) continue;
+
+                uint32_t suppressed = site->suppressed_.exchange(0, memory_order_relaxed);
+
+                if (suppressed == 0) continue;
+
+                string& stream = site->level_ >= ERROR_LEVEL ? err : out;
+
+                snprintf(buffer, sizeof(buffer), "%u similar messages suppressed (", suppressed);
+                stream += LEVEL_NAMES[site->level_];
+                stream += buffer;
+                stream += site->file_;
+                snprintf(buffer, sizeof(buffer), ":%d)\n", site->line_);
+                stream += buffer;
+            }
+
+            uint64_t lost = dropped.exchange(0, memory_order_relaxed);
+
+            if (lost > 0) {
+                snprintf(buffer, sizeof(buffer), "%llu log records dropped, ring full\n",
+                    static_cast<unsigned long long>(lost));
+                err += LEVEL_NAMES[WARN_LEVEL];
+                err += buffer;
+            }
+        }
+
+        /* Write, or wait for more */
+
+        if (out.empty() && err.empty()) {
+            if (stopping) break;
+
+            sleeping.exchange(true);
+
+            if (!pending() && !stopped.load()) {
+                pollfd event = { wakeFd, POLLIN, 0 };
+                uint64_t count;
+
+                if (poll(&event, 1, SUMMARY_INTERVAL) > 0 && ::read(wakeFd, &count, sizeof(count)) < 0) {
+                    // Reset by another wake up
+                }
+            }
+
+            sleeping.store(false);
+            continue;
+        }
+
+        if (!out.empty() && ::write(STDOUT_FILENO, out.data(), out.length()) < 0) {
+            // Nowhere to report it
+        }
+
+        if (!err.empty() && ::write(STDERR_FILENO, err.data(), err.length()) < 0) {
+        }
+
+        out.clear();
+        err.clear();
+    }
+}
@@ -0,0 +1,161 @@
+/**
+ * @file Log.hh
+ * @brief Asynchronous console log class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_LOG_HH_
+#define _LOG2KAFKA_LOG_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+
+/**
+ * Console log backend of the LOG_* macros when log4cxx is not used.
+ *
+ * Records are formatted on the calling thread, only once admitted, and
+ * handed to a lock-free ring drained by a background thread, which does
+ * the writes. A full ring drops records instead of waiting, so logging
+ * never slows down the ingestion. The thread sleeps while the ring is
+ * empty, and is woken by the first record.
+ *
+ * Each call site admits up to #RATE_LIMIT records per second; the rest
+ * are counted and reported as "N similar messages suppressed".
+ */
+class Log {
+public:
+
+    /**
+     * Record levels.
+     */
+    enum Level {
+        TRACE_LEVEL,
+        DEBUG_LEVEL,
+        INFO_LEVEL,
+        WARN_LEVEL,
+        ERROR_LEVEL, /**< this level and above go to the standard error */
+        FATAL_LEVEL
+    };
+
+    /**
+     * Records admitted per call site and second.
+     */
+    static const uint32_t RATE_LIMIT = 20;
+
+    /**
+     * Ring slots, a power of two.
+     */
+    static const size_t RING_SIZE = 1024;
+
+    /**
+     * Maximum record text length, longer ones are truncated.
+     */
+    static const size_t RECORD_SIZE = 496;
+
+    /**
+     * A call site of the log macros, with its rate limit state.
+     */
+    class Site {
+    public:
+        Site(Level level, const char* file, int line);
+
+        /**
+         * Return true if a record can be emitted now, or count it as
+         * suppressed.
+         */
+        bool admit();
+
+    private:
+        friend class Log;
+
+        Level level_;
+        const char* file_;
+        int line_;
+        std::atomic<int64_t> second_;
+        std::atomic<uint32_t> admitted_;
+        std::atomic<uint32_t> suppressed_;
+        Site* next_;
+    };
+
+    /**
+     * A record being formatted, queued when destroyed.
+     *
+     * Records are formatted in a stream reused by the thread, or in one of
+     * their own if logged while formatting another.
+     */
+    class Record {
+    public:
+        explicit Record(Site& site);
+        ~Record();
+
+        std::ostream& stream();
+
+    private:
+        Site& site_;
+        std::unique_ptr<std::ostringstream> nested_;
+        std::ostringstream& stream_;
+    };
+
+    /*-- static methods --*/
+
+    /**
+     * Write the queued records and stop the background thread. Registered
+     * to run at exit.
+     */
+    static void flush();
+
+    /**
+     * Return a printable copy of binary data, escaping the non printable
+     * bytes, at most #RECORD_SIZE long.
+     */
+    static std::string printable(const void* data, size_t length);
+
+private:
+
+    /*-- static methods --*/
+
+    /**
+     * Queue a record text, or drop it if the ring is full.
+     */
+    static void push(Level level, const std::string& text);
+
+    /**
+     * Background thread body.
+     */
+    static void drain();
+};
+
+#define _LOG2KAFKA_LOG_(level, m) do { \
+        static Log::Site _logSite(level, __FILE__, __LINE__); \
+        if (_logSite.admit()) { Log::Record(_logSite).stream() << m; } \
+    } while (0)
+
+#endif /* _LOG2KAFKA_LOG_HH_ */
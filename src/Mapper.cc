@@ -26,6 +26,10 @@
  * limitations under the License.
  */
 
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
 #include "Mapper.hh"
 
 using namespace std;
@@ -48,6 +52,16 @@ Mapper::~Mapper() {
 /*-- getters/setters --*/
 
 void Mapper::pattern(string pattern) {
+
+    // Compiled here, so a bad pattern fails the configuration and the first
+    // entry does not pay for it
+    try {
+        regex_ = pattern.empty() ? sregex() : sregex::compile(pattern);
+    }
+    catch (const regex_error& e) {
+        throw invalid_argument("Invalid pattern " + pattern + ": " + e.what());
+    }
+
     pattern_ = pattern;
 }
 
@@ -72,11 +86,6 @@ const string& Mapper::compactJson() {
 /*-- methods --*/
 
 void Mapper::map(avro::GenericDatum& datum, const string& entry) {
-
-    if (regex_.regex_id() == 0) {
-        regex_ = sregex::compile(pattern_);
-    }
-
     smatch what;
 
     if (regex_match(entry, what, regex_)) {
@@ -84,54 +93,15 @@ void Mapper::map(avro::GenericDatum& datum, const string& entry) {
         LOG_DEBUG("Valid entry detected: " << what[0].str());
 
         if (datum.type() == avro::AVRO_RECORD) {
-            istringstream ss;
-
             avro::GenericRecord& record = datum.value<avro::GenericRecord>();
             LOG_DEBUG("Field count: " << record.fieldCount());
 
-            for (size_t i = 0; i < record.fieldCount(); ++i) {
-                avro::GenericDatum& field = record.fieldAt(i);
-                ss.str(what[i + 1].str());
-
-                switch (field.type()) {
-                case avro::Type::AVRO_BOOL:
-                    bool boolValue;
-                    ss >> boolValue;
-                    record.setFieldAt(i, avro::GenericDatum(boolValue));
-                    break;
-
-                case avro::Type::AVRO_INT:
-                    int32_t intValue;
-                    ss >> intValue;
-                    record.setFieldAt(i, avro::GenericDatum(intValue));
-                    break;
-
-                case avro::Type::AVRO_LONG:
-                    int64_t longValue;
-                    ss >> longValue;
-                    record.setFieldAt(i, avro::GenericDatum(longValue));
-                    break;
-
-                case avro::Type::AVRO_FLOAT:
-                    float floatValue;
-                    ss >> floatValue;
-                    record.setFieldAt(i, avro::GenericDatum(floatValue));
-                    break;
-
-                case avro::Type::AVRO_DOUBLE:
-                    double doubleValue;
-                    ss >> doubleValue;
-                    record.setFieldAt(i, avro::GenericDatum(doubleValue));
-                    break;
-
-                case avro::Type::AVRO_STRING:
-                    default:
-                    record.setFieldAt(i, avro::GenericDatum(ss.str()));
-                }
-
-                LOG_DEBUG("Field " << i << " = " << ss.str());
-
-                ss.clear();
+            // Fields without a corresponding group are left for assign()
+            size_t mappedCount = min(record.fieldCount(), what.size() - 1);
+
+            for (size_t i = 0; i < mappedCount; ++i) {
+                setField(record, i, what[i + 1].str());
+                LOG_DEBUG("Field " << i << " = " << what[i + 1].str());
             }
         }
     }
@@ -139,3 +109,121 @@ void Mapper::map(avro::GenericDatum& datum, const string& entry) {
         throw MapperMatchException();
     }
 }
+
+bool Mapper::fieldIndex(const string& name, size_t& index) const {
+    const avro::NodePtr& node = root();
+
+    if (node->type() != avro::AVRO_RECORD) return false;
+
+    return node->nameIndex(name, index);
+}
+
+void Mapper::assign(avro::GenericDatum& datum, size_t index, const string& value) const {
+
+    if (datum.type() == avro::AVRO_RECORD) {
+        setField(datum.value<avro::GenericRecord>(), index, value);
+    }
+}
+
+void Mapper::setField(avro::GenericRecord& record, size_t index, const string& value) const {
+    istringstream ss(value);
+    avro::GenericDatum& field = record.fieldAt(index);
+
+    switch (field.type()) {
+    case avro::Type::AVRO_BOOL:
+        bool boolValue;
+        ss >> boolValue;
+        record.setFieldAt(index, avro::GenericDatum(boolValue));
+        break;
+
+    case avro::Type::AVRO_INT:
+        int32_t intValue;
+        ss >> intValue;
+        record.setFieldAt(index, avro::GenericDatum(intValue));
+        break;
+
+    case avro::Type::AVRO_LONG:
+        int64_t longValue;
+        ss >> longValue;
+        record.setFieldAt(index, avro::GenericDatum(longValue));
+        break;
+
+    case avro::Type::AVRO_FLOAT:
+        float floatValue;
+        ss >> floatValue;
+        record.setFieldAt(index, avro::GenericDatum(floatValue));
+        break;
+
+    case avro::Type::AVRO_DOUBLE:
+        double doubleValue;
+        ss >> doubleValue;
+        record.setFieldAt(index, avro::GenericDatum(doubleValue));
+        break;
+
+    case avro::Type::AVRO_STRING:
+        default:
+        record.setFieldAt(index, avro::GenericDatum(value));
+    }
+}
+
+/*-- static methods --*/
+
+void Mapper::convert(avro::GenericDatum& field, const char* begin, const char* end) {
+    size_t length = end - begin;
+
+    if (field.type() == avro::AVRO_STRING) {
+        field.value<string>().assign(begin, length);
+        return;
+    }
+
+    if (length == 0) return;
+
+    if (field.type() == avro::Type::AVRO_INT || field.type() == avro::Type::AVRO_LONG) {
+        const char* p = begin;
+        bool negative = *p == '-';
+
+        if (negative || *p == '+') ++p;
+
+        uint64_t value = 0;
+
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+            value = value * 10 + (*p - '0');
+        }
+
+        int64_t number = negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+
+        if (field.type() == avro::Type::AVRO_INT) {
+            field.value<int32_t>() = static_cast<int32_t>(number);
+        }
+        else {
+            field.value<int64_t>() = number;
+        }
+
+        return;
+    }
+
+    // Reals are parsed from a terminated copy, the text may be followed by
+    // anything
+    char text[32];
+
+    length = min(length, sizeof(text) - 1);
+    memcpy(text, begin, length);
+    text[length] = '\0';
+
+    switch (field.type()) {
+    case avro::Type::AVRO_BOOL:
+        field.value<bool>() = text[0] == 't' || text[0] == 'T' || text[0] == '1';
+        break;
+
+    case avro::Type::AVRO_FLOAT:
+        field.value<float>() = strtof(text, NULL);
+        break;
+
+    case avro::Type::AVRO_DOUBLE:
+        field.value<double>() = strtod(text, NULL);
+        break;
+
+    default:
+        field = avro::GenericDatum(string(begin, end));
+    }
+}
@@ -59,7 +59,10 @@ public:
     const std::string& compactJson();
 
     /**
-     * Set the regular expression pattern to use for fields mapping.
+     * Set the regular expression pattern to use for fields mapping, and
+     * compile it.
+     *
+     * @throw std::invalid_argument if the pattern does not compile
      */
     void pattern(std::string pattern);
 
@@ -73,9 +76,45 @@ public:
     /**
      * Map an entry in a generic AVRO datum instance using the pattern and
      * schema definition of the mapper.
+     *
+     * The pattern groups are assigned to the record fields in sequential
+     * order. Record fields beyond the number of groups keep their default
+     * value and can be set afterwards with #assign().
      */
     void map(avro::GenericDatum& datum, const std::string& entry);
 
+    /**
+     * Return the index of the named record field.
+     *
+     * @param name the field name
+     * @param[out] index the field position in the record
+     * @return false if the schema root is not a record or has no such field
+     */
+    bool fieldIndex(const std::string& name, size_t& index) const;
+
+    /**
+     * Set a record field of an already mapped datum, converting the text
+     * value to the field type.
+     *
+     * @param datum the mapped record datum
+     * @param index the field position in the record
+     * @param value the text value to assign
+     */
+    void assign(avro::GenericDatum& datum, size_t index, const std::string& value) const;
+
+    /*-- static methods --*/
+
+    /**
+     * Convert a text value to the type of a field and set it, without
+     * streams or allocations for numbers. An empty text leaves a number
+     * or boolean field unchanged.
+     *
+     * @param field the record field datum
+     * @param begin the text start
+     * @param end the text end
+     */
+    static void convert(avro::GenericDatum& field, const char* begin, const char* end);
+
 private:
 
     /*-- static fields --*/
@@ -105,6 +144,14 @@ private:
      * Compiled regular expression pattern.
      */
     boost::xpressive::sregex regex_;
+
+    /*-- methods --*/
+
+    /**
+     * Convert a text value to the type of the record field at the given
+     * position and set it.
+     */
+    void setField(avro::GenericRecord& record, size_t index, const std::string& value) const;
 };
 
 #endif /* _LOG2KAFKA_MAPPER_HH_ */
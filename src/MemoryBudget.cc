@@ -0,0 +1,119 @@
+/**
+ * @file MemoryBudget.cc
+ * @brief Process wide memory budget class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "MemoryBudget.hh"
+
+using namespace std;
+
+namespace {
+
+const char* const STAGE_NAMES[MemoryBudget::STAGE_COUNT] = {
+    "input", "queue", "producer", "spool"
+};
+
+/**
+ * The budget, 0 for no limit.
+ */
+atomic<size_t> budget(0);
+
+/**
+ * Bytes held, in total and per stage.
+ */
+atomic<size_t> total(0);
+atomic<size_t> stages[MemoryBudget::STAGE_COUNT];
+
+/**
+ * Threads waiting for a release, notified only if any.
+ */
+atomic<int> waiting(0);
+mutex waitMutex;
+condition_variable released;
+
+} // namespace
+
+/*-- static methods --*/
+
+void MemoryBudget::limit(size_t bytes) {
+    budget = bytes;
+}
+
+size_t MemoryBudget::limit() {
+    return budget;
+}
+
+size_t MemoryBudget::used(Stage stage) {
+    return stages[stage].load(memory_order_relaxed);
+}
+
+bool MemoryBudget::acquire(Stage stage, size_t bytes) {
+    size_t maximum = budget.load(memory_order_relaxed);
+    size_t current = total.load(memory_order_relaxed);
+
+    do {
+        if (maximum > 0 && current + bytes > maximum
+            && stages[stage].load(memory_order_relaxed) > 0) {
+
+            return false;
+        }
+    } while (!total.compare_exchange_weak(current, current + bytes, memory_order_relaxed));
+
+    stages[stage].fetch_add(bytes, memory_order_relaxed);
+
+    return true;
+}
+
+void MemoryBudget::charge(Stage stage, size_t bytes) {
+    total.fetch_add(bytes, memory_order_relaxed);
+    stages[stage].fetch_add(bytes, memory_order_relaxed);
+}
+
+void MemoryBudget::release(Stage stage, size_t bytes) {
+    total.fetch_sub(bytes, memory_order_relaxed);
+    stages[stage].fetch_sub(bytes, memory_order_relaxed);
+
+    if (waiting.load(memory_order_relaxed) > 0) released.notify_all();
+}
+
+void MemoryBudget::wait(int timeout) {
+    unique_lock<mutex> lock(waitMutex);
+
+    // A release between the refusal and here is only noticed at the
+    // timeout, so it is kept short
+    ++waiting;
+    released.wait_for(lock, chrono::milliseconds(timeout));
+    --waiting;
+}
+
+const char* MemoryBudget::name(Stage stage) {
+    return STAGE_NAMES[stage];
+}
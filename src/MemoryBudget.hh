@@ -0,0 +1,109 @@
+/**
+ * @file MemoryBudget.hh
+ * @brief Process wide memory budget class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_MEMORY_BUDGET_HH_
+#define _LOG2KAFKA_MEMORY_BUDGET_HH_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Process wide accounting of the memory held by entries and messages at
+ * each stage of the pipeline, against a single byte budget.
+ *
+ * Stages holding data they can not give up (ej. read buffers) charge it
+ * unconditionally; the others ask for admission first and, when refused,
+ * apply their backpressure policy: wait for a release or drop the data. A
+ * stage holding nothing is always admitted, so one oversized entry, or a
+ * stage starved by the others, can not stall the pipeline.
+ */
+class MemoryBudget {
+public:
+
+    /**
+     * Accounted stages.
+     */
+    enum Stage {
+        INPUT,    /**< read buffers and decompressed input */
+        QUEUE,    /**< entries queued for the daemon workers */
+        PRODUCER, /**< messages queued in the kafka client */
+        SPOOL,    /**< spooled messages read back for replay */
+        STAGE_COUNT
+    };
+
+    /*-- static methods --*/
+
+    /**
+     * Set the budget, in bytes, or 0 for no limit (still accounted).
+     */
+    static void limit(size_t bytes);
+
+    /**
+     * Return the budget, in bytes, or 0 if there is no limit.
+     */
+    static size_t limit();
+
+    /**
+     * Return the bytes held by a stage.
+     */
+    static size_t used(Stage stage);
+
+    /**
+     * Account bytes held by a stage, if they fit in the budget or the stage
+     * holds nothing yet.
+     *
+     * @return false if not admitted, nothing is accounted then
+     */
+    static bool acquire(Stage stage, size_t bytes);
+
+    /**
+     * Account bytes held by a stage, over the budget if need be.
+     */
+    static void charge(Stage stage, size_t bytes);
+
+    /**
+     * Stop accounting bytes released by a stage.
+     */
+    static void release(Stage stage, size_t bytes);
+
+    /**
+     * Wait for some bytes to be released.
+     *
+     * @param timeout maximum time to wait, in milliseconds
+     */
+    static void wait(int timeout);
+
+    /**
+     * Return the name of a stage, ej. for the metrics.
+     */
+    static const char* name(Stage stage);
+};
+
+#endif /* _LOG2KAFKA_MEMORY_BUDGET_HH_ */
@@ -0,0 +1,444 @@
+/**
+ * @file Metrics.cc
+ * @brief Instrumentation counters and latencies class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "MemoryBudget.hh"
+#include "Metrics.hh"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Cache line size.
+ */
+const size_t CACHE_LINE = 64;
+
+/**
+ * The metrics of a thread, on cache lines of its own so that the updates
+ * of a thread never invalidate the shard of another.
+ */
+struct alignas(CACHE_LINE) Shard {
+    atomic<uint64_t> counters[Metrics::COUNTER_COUNT];
+    Histogram histograms[Metrics::STAGE_COUNT];
+
+    Shard() {
+        for (size_t i = 0; i < Metrics::COUNTER_COUNT; ++i) {
+            counters[i].store(0, memory_order_relaxed);
+        }
+    }
+
+    // Plain new only guarantees the fundamental alignment before C++17
+    static void* operator new(size_t size) {
+        void* memory;
+
+        if (posix_memalign(&memory, CACHE_LINE, size) != 0) throw bad_alloc();
+
+        return memory;
+    }
+
+    static void operator delete(void* memory) {
+        free(memory);
+    }
+};
+
+/**
+ * Counter names and help texts, in Counter order.
+ */
+const char* const COUNTER_NAMES[Metrics::COUNTER_COUNT][2] = {
+    { "log2kafka_read_bytes_total", "Input bytes read" },
+    { "log2kafka_entries_received_total", "Entries handed to a channel" },
+    { "log2kafka_entries_throttled_total", "Entries dropped by the rate limit" },
+    { "log2kafka_entries_sampled_total", "Entries dropped by sampling" },
+    { "log2kafka_entries_dropped_total", "Entries dropped by a full daemon queue" },
+    { "log2kafka_entries_over_budget_total", "Entries dropped by the memory budget" },
+    { "log2kafka_parse_failures_total", "Entries that failed to map or serialize" },
+    { "log2kafka_messages_produced_total", "Messages enqueued in the kafka client" },
+    { "log2kafka_produced_bytes_total", "Payload bytes enqueued in the kafka client" },
+    { "log2kafka_produce_failures_total", "Messages refused by the kafka client" },
+    { "log2kafka_messages_delivered_total", "Messages acknowledged by the brokers" },
+    { "log2kafka_delivery_failures_total", "Messages that failed delivery" }
+};
+
+/**
+ * Stage label values, in Stage order.
+ */
+const char* const STAGE_NAMES[Metrics::STAGE_COUNT] = {
+    "read", "map", "serialize", "produce", "delivery"
+};
+
+/**
+ * Shards of all the threads that recorded something. Never released, the
+ * counts of finished threads are still reported.
+ */
+mutex registryMutex;
+vector<unique_ptr<Shard>> registry;
+
+/**
+ * The last librdkafka statistics of each kafka client.
+ */
+mutex statisticsMutex;
+vector<pair<const void*, string>> lastStatistics;
+
+/**
+ * Top level statistics fields that are points in time, reported as the
+ * latest across clients instead of added up.
+ */
+const char* const TIME_FIELDS[] = { "ts", "time", "age" };
+
+thread_local Shard* localShard = NULL;
+
+/**
+ * Return true if a statistics field is a point in time.
+ */
+bool timeField(const string& name) {
+
+    for (size_t i = 0; i < sizeof(TIME_FIELDS) / sizeof(TIME_FIELDS[0]); ++i) {
+        if (name == TIME_FIELDS[i]) return true;
+    }
+
+    return false;
+}
+
+/**
+ * Return true if a name is valid as part of a metric name.
+ */
+bool validName(const string& name) {
+
+    for (size_t i = 0; i < name.length(); ++i) {
+        if (!isalnum(name[i]) && name[i] != '_') return false;
+    }
+
+    return true;
+}
+
+/**
+ * Add up the histogram of a stage across threads.
+ */
+void addUp(Metrics::Stage stage, vector<uint64_t>& counts) {
+    lock_guard<mutex> lock(registryMutex);
+
+    counts.assign(Histogram::BUCKET_COUNT, 0);
+
+    for (size_t s = 0; s < registry.size(); ++s) {
+        for (size_t i = 0; i < Histogram::BUCKET_COUNT; ++i) {
+            counts[i] += registry[s]->histograms[stage].count(i);
+        }
+    }
+}
+
+Shard& shard() {
+
+    if (localShard == NULL) {
+        lock_guard<mutex> lock(registryMutex);
+
+        registry.push_back(unique_ptr<Shard>(new Shard()));
+        localShard = registry.back().get();
+    }
+
+    return *localShard;
+}
+
+} // namespace
+
+/*-- static methods --*/
+
+void Metrics::count(Counter counter, uint64_t value) {
+    atomic<uint64_t>& total = shard().counters[counter];
+
+    // Single writer: plain load and store, no locked instruction needed
+    total.store(total.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+void Metrics::record(Stage stage, Clock::duration duration) {
+    int64_t nanoseconds = chrono::duration_cast<chrono::nanoseconds>(duration).count();
+
+    shard().histograms[stage].record(nanoseconds > 0 ? nanoseconds : 0);
+}
+
+void Metrics::statistics(const void* source, const char* json, size_t length) {
+    lock_guard<mutex> lock(statisticsMutex);
+
+    for (size_t i = 0; i < lastStatistics.size(); ++i) {
+        if (lastStatistics[i].first == source) {
+            lastStatistics[i].second.assign(json, length);
+            return;
+        }
+    }
+
+    lastStatistics.push_back(make_pair(source, string(json, length)));
+}
+
+string Metrics::statistics() {
+    lock_guard<mutex> lock(statisticsMutex);
+
+    if (lastStatistics.size() == 1) return lastStatistics[0].second;
+    if (lastStatistics.empty()) return "";
+
+    string documents("[");
+
+    for (size_t i = 0; i < lastStatistics.size(); ++i) {
+        if (i > 0) documents += ",";
+        documents += lastStatistics[i].second;
+    }
+
+    return documents + "]";
+}
+
+uint64_t Metrics::total(Counter counter) {
+    lock_guard<mutex> lock(registryMutex);
+
+    uint64_t total = 0;
+
+    for (size_t s = 0; s < registry.size(); ++s) {
+        total += registry[s]->counters[counter].load(memory_order_relaxed);
+    }
+
+    return total;
+}
+
+uint64_t Metrics::quantile(Stage stage, double quantile) {
+    vector<uint64_t> counts;
+    uint64_t count = 0;
+
+    addUp(stage, counts);
+
+    for (size_t i = 0; i < counts.size(); ++i) count += counts[i];
+
+    if (count == 0) return 0;
+
+    // Rank of the value, then the bucket holding it
+    uint64_t rank = static_cast<uint64_t>(quantile * (count - 1)) + 1;
+    uint64_t cumulative = 0;
+
+    for (size_t i = 0; i < counts.size(); ++i) {
+        cumulative += counts[i];
+
+        if (cumulative >= rank) {
+            return i + 1 < counts.size() ? Histogram::lowerBound(i + 1) - 1 : UINT64_MAX;
+        }
+    }
+
+    return UINT64_MAX;
+}
+
+void Metrics::write(ostream& os) {
+    uint64_t counters[COUNTER_COUNT] = { 0 };
+    vector<uint64_t> buckets(STAGE_COUNT * Histogram::BUCKET_COUNT);
+    uint64_t sums[STAGE_COUNT] = { 0 };
+
+    /* Add up the shards */
+
+    {
+        lock_guard<mutex> lock(registryMutex);
+
+        for (size_t s = 0; s < registry.size(); ++s) {
+            const Shard& shard = *registry[s];
+
+            for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+                counters[i] += shard.counters[i].load(memory_order_relaxed);
+            }
+
+            for (size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+                for (size_t i = 0; i < Histogram::BUCKET_COUNT; ++i) {
+                    buckets[stage * Histogram::BUCKET_COUNT + i] += shard.histograms[stage].count(i);
+                }
+
+                sums[stage] += shard.histograms[stage].sum();
+            }
+        }
+    }
+
+    /* Counters */
+
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        os << "# HELP " << COUNTER_NAMES[i][0] << " " << COUNTER_NAMES[i][1] << "\n"
+           << "# TYPE " << COUNTER_NAMES[i][0] << " counter\n"
+           << COUNTER_NAMES[i][0] << " " << counters[i] << "\n";
+    }
+
+    /* Latencies, as cumulative buckets at every power of two from 1 us
+     * (1024 ns) to 16 s */
+
+    const char* name = "log2kafka_stage_duration_seconds";
+
+    os << "# HELP " << name << " Processing stage latency\n"
+       << "# TYPE " << name << " histogram\n";
+
+    for (size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+        const uint64_t* counts = &buckets[stage * Histogram::BUCKET_COUNT];
+        uint64_t cumulative = 0;
+        size_t bucket = 0;
+
+        for (int magnitude = 10; magnitude <= 34; ++magnitude) {
+            size_t limit = Histogram::bucket(uint64_t(1) << magnitude);
+
+            for (; bucket < limit; ++bucket) cumulative += counts[bucket];
+
+            os << name << "_bucket{stage=\"" << STAGE_NAMES[stage] << "\",le=\""
+               << (uint64_t(1) << magnitude) / 1e9 << "\"} " << cumulative << "\n";
+        }
+
+        for (; bucket < Histogram::BUCKET_COUNT; ++bucket) cumulative += counts[bucket];
+
+        os << name << "_bucket{stage=\"" << STAGE_NAMES[stage] << "\",le=\"+Inf\"} "
+           << cumulative << "\n"
+           << name << "_sum{stage=\"" << STAGE_NAMES[stage] << "\"} " << sums[stage] / 1e9 << "\n"
+           << name << "_count{stage=\"" << STAGE_NAMES[stage] << "\"} " << cumulative << "\n";
+    }
+
+    /* Memory held per stage, and the budget */
+
+    name = "log2kafka_memory_bytes";
+
+    os << "# HELP " << name << " Memory held by entries and messages\n"
+       << "# TYPE " << name << " gauge\n";
+
+    for (size_t stage = 0; stage < MemoryBudget::STAGE_COUNT; ++stage) {
+        MemoryBudget::Stage budgetStage = static_cast<MemoryBudget::Stage>(stage);
+
+        os << name << "{stage=\"" << MemoryBudget::name(budgetStage) << "\"} "
+           << MemoryBudget::used(budgetStage) << "\n";
+    }
+
+    os << "# HELP log2kafka_memory_budget_bytes Memory budget, 0 for no limit\n"
+       << "# TYPE log2kafka_memory_budget_bytes gauge\n"
+       << "log2kafka_memory_budget_bytes " << MemoryBudget::limit() << "\n";
+
+    writeStatistics(os);
+}
+
+void Metrics::writeStatistics(ostream& os) {
+    vector<string> documents;
+
+    {
+        lock_guard<mutex> lock(statisticsMutex);
+
+        for (size_t i = 0; i < lastStatistics.size(); ++i) {
+            documents.push_back(lastStatistics[i].second);
+        }
+    }
+
+    /* Scan the top level "name": number pairs, ej. "msg_cnt": 12, adding
+     * them up across the kafka clients */
+
+    vector<pair<string, double>> fields;
+    vector<bool> real;
+
+    for (size_t d = 0; d < documents.size(); ++d) {
+        const string& json = documents[d];
+        int depth = 0;
+        bool quoted = false;
+        size_t keyBegin = 0;
+        string key;
+
+        for (size_t i = 0; i < json.length(); ++i) {
+            char c = json[i];
+
+            if (quoted) {
+                if (c == '\\') {
+                    ++i;
+                }
+                else if (c == '"') {
+                    quoted = false;
+                    key = json.substr(keyBegin, i - keyBegin);
+                }
+
+                continue;
+            }
+
+            switch (c) {
+            case '"':
+                quoted = true;
+                keyBegin = i + 1;
+                break;
+            case '{':
+            case '[':
+                ++depth;
+                key.clear();
+                break;
+            case '}':
+            case ']':
+                --depth;
+                key.clear();
+                break;
+            case ':':
+                if (depth == 1 && !key.empty() && validName(key)) {
+                    size_t begin = json.find_first_not_of(' ', i + 1);
+                    size_t end = begin;
+
+                    while (end < json.length() && (isdigit(json[end]) || json[end] == '-'
+                        || json[end] == '.')) {
+                        ++end;
+                    }
+
+                    if (begin != string::npos && end > begin) {
+                        string number = json.substr(begin, end - begin);
+                        double value = strtod(number.c_str(), NULL);
+                        size_t f = 0;
+
+                        while (f < fields.size() && fields[f].first != key) ++f;
+
+                        if (f == fields.size()) {
+                            fields.push_back(make_pair(key, 0.0));
+                            real.push_back(false);
+                        }
+
+                        fields[f].second = timeField(key) ? max(fields[f].second, value)
+                            : fields[f].second + value;
+                        real[f] = real[f] || number.find('.') != string::npos;
+                    }
+                }
+
+                key.clear();
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    for (size_t f = 0; f < fields.size(); ++f) {
+        os << "# TYPE log2kafka_rdkafka_" << fields[f].first << " gauge\n"
+           << "log2kafka_rdkafka_" << fields[f].first << " ";
+
+        if (real[f]) {
+            os << fields[f].second << "\n";
+        }
+        else {
+            os << static_cast<int64_t>(fields[f].second) << "\n";
+        }
+    }
+}
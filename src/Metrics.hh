@@ -0,0 +1,158 @@
+/**
+ * @file Metrics.hh
+ * @brief Instrumentation counters and latencies class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_METRICS_HH_
+#define _LOG2KAFKA_METRICS_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "Histogram.hh"
+
+/**
+ * Process wide instrumentation: event counters and per stage latency
+ * histograms, plus the last librdkafka statistics.
+ *
+ * Each thread updates its own shard, without locks or shared cache lines,
+ * and the shards are added up when the metrics are written. Reads are
+ * therefore only approximately consistent across counters, which is fine
+ * for monitoring.
+ */
+class Metrics {
+public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Event counters.
+     */
+    enum Counter {
+        BYTES_READ,         /**< input bytes read by the daemon */
+        ENTRIES_RECEIVED,   /**< entries handed to a channel */
+        ENTRIES_THROTTLED,  /**< entries dropped by the rate limit */
+        ENTRIES_SAMPLED,    /**< entries dropped by sampling */
+        ENTRIES_DROPPED,    /**< entries dropped by a full daemon queue */
+        ENTRIES_OVER_BUDGET, /**< entries dropped by the memory budget */
+        PARSE_FAILURES,     /**< entries that failed to map or serialize */
+        MESSAGES_PRODUCED,  /**< messages enqueued in the kafka client */
+        BYTES_PRODUCED,     /**< payload bytes enqueued */
+        PRODUCE_FAILURES,   /**< messages the kafka client refused */
+        MESSAGES_DELIVERED, /**< messages acknowledged by the brokers */
+        DELIVERY_FAILURES,  /**< messages that failed delivery */
+        COUNTER_COUNT
+    };
+
+    /**
+     * Timed processing stages.
+     */
+    enum Stage {
+        READ,      /**< input read system call */
+        MAP,       /**< entry mapping to a record */
+        SERIALIZE, /**< record serialization */
+        PRODUCE,   /**< enqueue in the kafka client */
+        DELIVERY,  /**< enqueue to delivery report */
+        STAGE_COUNT
+    };
+
+    /**
+     * Times a stage from construction to destruction.
+     */
+    class Timer {
+    public:
+        explicit Timer(Stage stage) : stage_(stage), start_(Clock::now()) {
+        }
+
+        ~Timer() {
+            Metrics::record(stage_, Clock::now() - start_);
+        }
+
+    private:
+        Stage stage_;
+        Clock::time_point start_;
+    };
+
+    /*-- static methods --*/
+
+    /**
+     * Add to a counter of the calling thread.
+     */
+    static void count(Counter counter, uint64_t value = 1);
+
+    /**
+     * Record a stage duration in the calling thread.
+     */
+    static void record(Stage stage, Clock::duration duration);
+
+    /**
+     * Keep the last librdkafka statistics JSON document of a kafka client.
+     *
+     * @param source the kafka client handle the document describes
+     */
+    static void statistics(const void* source, const char* json, size_t length);
+
+    /**
+     * Return the last librdkafka statistics JSON document, an array of the
+     * documents of every client if there are many, or an empty string.
+     */
+    static std::string statistics();
+
+    /**
+     * Return the value of a counter, added up across threads.
+     */
+    static uint64_t total(Counter counter);
+
+    /**
+     * Return an upper bound of a stage latency quantile, in nanoseconds,
+     * or 0 if nothing was recorded.
+     *
+     * @param stage the stage
+     * @param quantile the quantile, between 0 and 1, ej. 0.99
+     */
+    static uint64_t quantile(Stage stage, double quantile);
+
+    /**
+     * Write all the metrics in Prometheus text exposition format.
+     */
+    static void write(std::ostream& os);
+
+private:
+
+    /*-- static methods --*/
+
+    /**
+     * Write the numeric top level fields of the librdkafka statistics,
+     * added up across the kafka clients.
+     */
+    static void writeStatistics(std::ostream& os);
+};
+
+#endif /* _LOG2KAFKA_METRICS_HH_ */
@@ -0,0 +1,199 @@
+/**
+ * @file MetricsServer.cc
+ * @brief Metrics exposition server class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Metrics.hh"
+#include "MetricsServer.hh"
+#include "Util.hh"
+
+namespace po = boost::program_options;
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr MetricsServer::logger(Logger::getLogger("MetricsServer"));
+#endif
+
+volatile sig_atomic_t MetricsServer::dumpRequested_ = 0;
+
+/*-- constructors/destructor --*/
+
+MetricsServer::MetricsServer() :
+    listenFd_(-1), stopped_(false) {
+}
+
+MetricsServer::~MetricsServer() {
+    stopped_ = true;
+
+    if (thread_.joinable()) thread_.join();
+
+    if (listenFd_ >= 0) close(listenFd_);
+    if (!socketPath_.empty()) unlink(socketPath_.c_str());
+}
+
+/*-- static methods --*/
+
+void MetricsServer::dump() {
+    dumpRequested_ = 1;
+}
+
+/*-- methods --*/
+
+void MetricsServer::configure(const po::variables_map& vm) {
+
+    if (vm.count("metrics.listen")) {
+        const string& endpoint = vm["metrics.listen"].as<string>();
+
+        if (endpoint.find('/') != string::npos) { // Unix domain socket path
+            sockaddr_un address;
+
+            if (endpoint.length() >= sizeof(address.sun_path)) {
+                throw invalid_argument("Socket path too long: " + endpoint);
+            }
+
+            memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            strncpy(address.sun_path, endpoint.c_str(), sizeof(address.sun_path) - 1);
+
+            listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+            unlink(endpoint.c_str());
+
+            if (listenFd_ < 0
+                || bind(listenFd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0
+                || listen(listenFd_, SOMAXCONN) < 0) {
+
+                throw system_error(errno, system_category(), "Unable to listen on " + endpoint);
+            }
+
+            socketPath_ = endpoint;
+        }
+        else {
+            listenFd_ = Util::listenInet(endpoint, SOCK_STREAM);
+        }
+
+        LOG_INFO("Metrics available at " << endpoint);
+    }
+
+    thread_ = thread(&MetricsServer::serve, this);
+}
+
+void MetricsServer::serve() {
+    pollfd listener;
+    listener.fd = listenFd_;
+    listener.events = POLLIN;
+
+    while (!stopped_) {
+        listener.revents = 0;
+
+        // A negative descriptor is ignored, poll() then just waits
+        int ready = poll(&listener, 1, Constants::DAEMON_POLL_INTERVAL);
+
+        if (dumpRequested_) {
+            dumpRequested_ = 0;
+
+            ostringstream buffer;
+            Metrics::write(buffer);
+            cerr << buffer.str() << flush;
+        }
+
+        if (ready <= 0 || listener.revents == 0) continue;
+
+        int fd = accept4(listenFd_, NULL, NULL, SOCK_CLOEXEC);
+
+        if (fd >= 0) respond(fd);
+    }
+}
+
+void MetricsServer::respond(int fd) {
+
+    /* Read the request line, if any, giving slow clients a moment */
+
+    char request[1024];
+    ssize_t length = 0;
+    pollfd client;
+    client.fd = fd;
+    client.events = POLLIN;
+    client.revents = 0;
+
+    if (poll(&client, 1, Constants::DAEMON_POLL_INTERVAL) > 0) {
+        length = recv(fd, request, sizeof(request) - 1, 0);
+    }
+
+    request[length > 0 ? length : 0] = '\0';
+
+    bool statistics = strncmp(request, "GET /stats", 10) == 0;
+
+    /* Answer */
+
+    ostringstream body;
+    string contentType;
+
+    if (statistics) {
+        body << Metrics::statistics();
+        contentType = "application/json";
+    }
+    else {
+        Metrics::write(body);
+        contentType = "text/plain; version=0.0.4";
+    }
+
+    string content = body.str();
+    ostringstream response;
+
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: " << contentType << "\r\n"
+             << "Content-Length: " << content.length() << "\r\n"
+             << "\r\n"
+             << content;
+
+    string data = response.str();
+
+    for (size_t written = 0; written < data.length();) {
+        ssize_t n = send(fd, data.data() + written, data.length() - written, MSG_NOSIGNAL);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        written += n;
+    }
+
+    close(fd);
+}
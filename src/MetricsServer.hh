@@ -0,0 +1,117 @@
+/**
+ * @file MetricsServer.hh
+ * @brief Metrics exposition server class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_METRICS_SERVER_HH_
+#define _LOG2KAFKA_METRICS_SERVER_HH_
+
+#include <atomic>
+#include <csignal>
+#include <string>
+#include <thread>
+
+#include "config.hh"
+
+/**
+ * Background thread exposing the Metrics.
+ *
+ * Answers HTTP requests on a local Unix domain socket or TCP port with the
+ * metrics in Prometheus text format, or with the last librdkafka statistics
+ * JSON for the <b>/stats</b> path. It also dumps the metrics to the
+ * standard error when #dump() is requested, ej. on SIGUSR1.
+ */
+class MetricsServer {
+public:
+
+    MetricsServer();
+    virtual ~MetricsServer();
+
+    /*-- static methods --*/
+
+    /**
+     * Request a metrics dump to the standard error. Safe to call from a
+     * signal handler.
+     */
+    static void dump();
+
+    /*-- methods --*/
+
+    /**
+     * Open the listening socket, if requested, and start the thread.
+     */
+    void configure(const boost::program_options::variables_map& vm);
+
+private:
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /**
+     * Dump request flag.
+     */
+    static volatile sig_atomic_t dumpRequested_;
+
+    /*-- fields --*/
+
+    /**
+     * Listening socket, or -1.
+     */
+    int listenFd_;
+
+    /**
+     * Unix domain socket path, if listening on one.
+     */
+    std::string socketPath_;
+
+    /**
+     * Server thread and its stop flag.
+     */
+    std::thread thread_;
+    std::atomic<bool> stopped_;
+
+    /*-- methods --*/
+
+    /**
+     * Server thread body.
+     */
+    void serve();
+
+    /**
+     * Answer a connection and close it.
+     */
+    void respond(int fd);
+};
+
+#endif /* _LOG2KAFKA_METRICS_SERVER_HH_ */
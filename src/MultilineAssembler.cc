@@ -0,0 +1,84 @@
+/**
+ * @file MultilineAssembler.cc
+ * @brief Multiline record assembler class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "MultilineAssembler.hh"
+
+using namespace std;
+
+/*-- constructors/destructor --*/
+
+MultilineAssembler::MultilineAssembler(const MultilineRule& rule) :
+    rule_(rule), lines_(0) {
+}
+
+MultilineAssembler::~MultilineAssembler() {
+}
+
+/*-- methods --*/
+
+bool MultilineAssembler::add(string& line, string& record) {
+    bool completed = false;
+
+    if (lines_ > 0) {
+        if (lines_ < rule_.maxLines()
+            && buffer_.length() + 1 + line.length() <= rule_.maxBytes()
+            && rule_.continues(line)) {
+
+            buffer_ += '\n';
+            buffer_ += line;
+            ++lines_;
+            deadline_ = Clock::now() + rule_.timeout();
+
+            return false;
+        }
+
+        record.swap(buffer_);
+        completed = true;
+    }
+
+    buffer_.swap(line);
+    lines_ = 1;
+    deadline_ = Clock::now() + rule_.timeout();
+
+    return completed;
+}
+
+bool MultilineAssembler::flush(string& record) {
+
+    if (lines_ == 0) return false;
+
+    record.swap(buffer_);
+    buffer_.clear();
+    lines_ = 0;
+
+    return true;
+}
+
+bool MultilineAssembler::expired(Clock::time_point now) const {
+    return lines_ > 0 && now >= deadline_;
+}
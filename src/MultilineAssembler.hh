@@ -0,0 +1,111 @@
+/**
+ * @file MultilineAssembler.hh
+ * @brief Multiline record assembler class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_MULTILINE_ASSEMBLER_HH_
+#define _LOG2KAFKA_MULTILINE_ASSEMBLER_HH_
+
+#include <chrono>
+#include <string>
+
+#include "MultilineRule.hh"
+
+/**
+ * Joins the lines of a source into logical records, following a
+ * MultilineRule.
+ *
+ * A record is complete when a line not continuing it arrives, when it
+ * reaches the size caps, or when no line arrives for the rule timeout.
+ * Lines are joined with new lines. The record buffer is swapped with the
+ * caller one, so no memory is allocated once both have grown.
+ */
+class MultilineAssembler {
+public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Class constructor.
+     *
+     * @param rule the rule to follow, which must outlive the assembler
+     */
+    explicit MultilineAssembler(const MultilineRule& rule);
+    virtual ~MultilineAssembler();
+
+    /*-- methods --*/
+
+    /**
+     * Add a line.
+     *
+     * @param[in] line the line, its content is consumed
+     * @param[out] record the completed record, if any
+     * @return true if a record was completed
+     */
+    bool add(std::string& line, std::string& record);
+
+    /**
+     * Complete the current record, if any.
+     *
+     * @param[out] record the completed record
+     * @return false if there was no record
+     */
+    bool flush(std::string& record);
+
+    /**
+     * Return true if the current record has waited longer than the rule
+     * timeout.
+     */
+    bool expired(Clock::time_point now) const;
+
+private:
+
+    /*-- fields --*/
+
+    /**
+     * The rule followed.
+     */
+    const MultilineRule& rule_;
+
+    /**
+     * The current record.
+     */
+    std::string buffer_;
+
+    /**
+     * Lines in the current record, 0 if there is none.
+     */
+    size_t lines_;
+
+    /**
+     * When the current record times out.
+     */
+    Clock::time_point deadline_;
+};
+
+#endif /* _LOG2KAFKA_MULTILINE_ASSEMBLER_HH_ */
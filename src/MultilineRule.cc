@@ -0,0 +1,88 @@
+/**
+ * @file MultilineRule.cc
+ * @brief Multiline record rule class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "MultilineRule.hh"
+
+using namespace std;
+using namespace boost::xpressive;
+
+/*-- constructors/destructor --*/
+
+MultilineRule::MultilineRule() :
+    start_(true),
+    maxLines_(Constants::DEFAULT_MULTILINE_MAX_LINES),
+    maxBytes_(Constants::DEFAULT_MULTILINE_MAX_BYTES),
+    timeout_(Constants::DEFAULT_MULTILINE_TIMEOUT) {
+}
+
+MultilineRule::~MultilineRule() {
+}
+
+/*-- getters/setters --*/
+
+void MultilineRule::start(const string& pattern) {
+    pattern_ = sregex::compile(pattern);
+    start_ = true;
+}
+
+void MultilineRule::continuation(const string& pattern) {
+    pattern_ = sregex::compile(pattern);
+    start_ = false;
+}
+
+void MultilineRule::maxLines(size_t maxLines) {
+    maxLines_ = maxLines;
+}
+
+size_t MultilineRule::maxLines() const {
+    return maxLines_;
+}
+
+void MultilineRule::maxBytes(size_t maxBytes) {
+    maxBytes_ = maxBytes;
+}
+
+size_t MultilineRule::maxBytes() const {
+    return maxBytes_;
+}
+
+void MultilineRule::timeout(int milliseconds) {
+    timeout_ = chrono::milliseconds(milliseconds);
+}
+
+chrono::milliseconds MultilineRule::timeout() const {
+    return timeout_;
+}
+
+/*-- methods --*/
+
+bool MultilineRule::continues(const string& line) const {
+    bool matches = regex_search(line, pattern_, regex_constants::match_continuous);
+
+    return start_ ? !matches : matches;
+}
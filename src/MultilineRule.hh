@@ -0,0 +1,136 @@
+/**
+ * @file MultilineRule.hh
+ * @brief Multiline record rule class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_MULTILINE_RULE_HH_
+#define _LOG2KAFKA_MULTILINE_RULE_HH_
+
+#include <chrono>
+#include <string>
+
+#include <boost/xpressive/xpressive.hpp>
+
+#include "config.hh"
+
+/**
+ * Rule deciding which lines belong to the same logical record, ej. the
+ * lines of a Java stack trace.
+ *
+ * Either a start pattern is given, and every line not matching it continues
+ * the current record, or a continuation pattern is given, and every line
+ * matching it continues the current record. Patterns are matched at the
+ * beginning of the line.
+ */
+class MultilineRule {
+public:
+
+    MultilineRule();
+    virtual ~MultilineRule();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Set the pattern matching the first line of a record.
+     */
+    void start(const std::string& pattern);
+
+    /**
+     * Set the pattern matching the continuation lines of a record. Ignored
+     * if a start pattern is set.
+     */
+    void continuation(const std::string& pattern);
+
+    /**
+     * Set the maximum lines of a record.
+     */
+    void maxLines(size_t maxLines);
+
+    /**
+     * Return the maximum lines of a record.
+     */
+    size_t maxLines() const;
+
+    /**
+     * Set the maximum size of a record, in bytes.
+     */
+    void maxBytes(size_t maxBytes);
+
+    /**
+     * Return the maximum size of a record, in bytes.
+     */
+    size_t maxBytes() const;
+
+    /**
+     * Set the time a record waits for more lines, in milliseconds.
+     */
+    void timeout(int milliseconds);
+
+    /**
+     * Return the time a record waits for more lines.
+     */
+    std::chrono::milliseconds timeout() const;
+
+    /*-- methods --*/
+
+    /**
+     * Return true if the line continues the current record.
+     */
+    bool continues(const std::string& line) const;
+
+private:
+
+    /*-- fields --*/
+
+    /**
+     * First line pattern, or continuation line pattern.
+     */
+    boost::xpressive::sregex pattern_;
+
+    /**
+     * Whether #pattern_ matches the first line of a record.
+     */
+    bool start_;
+
+    /**
+     * Maximum lines of a record.
+     */
+    size_t maxLines_;
+
+    /**
+     * Maximum size of a record, in bytes.
+     */
+    size_t maxBytes_;
+
+    /**
+     * Time a record waits for more lines.
+     */
+    std::chrono::milliseconds timeout_;
+};
+
+#endif /* _LOG2KAFKA_MULTILINE_RULE_HH_ */
@@ -0,0 +1,392 @@
+/**
+ * @file NetworkMap.cc
+ * @brief Internal networks map class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <sys/stat.h>
+
+#include "NetworkMap.hh"
+
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr NetworkMap::logger(Logger::getLogger("NetworkMap"));
+#endif
+
+namespace {
+
+/**
+ * Address bits, IPv4 addresses are mapped to IPv6.
+ */
+const size_t ADDRESS_BITS = 128;
+const size_t IPV4_OFFSET = 96;
+
+/**
+ * Scope of the networks without one.
+ */
+const char* const DEFAULT_SCOPE = "internal";
+
+/**
+ * Maps in use, by path.
+ */
+mutex registryMutex;
+map<string, weak_ptr<NetworkMap>> registry;
+
+/**
+ * Last table generation given, 0 is never used.
+ */
+atomic<uint64_t> lastGeneration(0);
+
+inline int bitAt(const uint8_t* address, size_t index) {
+    return (address[index >> 3] >> (7 - (index & 7))) & 1;
+}
+
+/**
+ * Length of the common prefix of two addresses, up to a maximum.
+ */
+size_t commonPrefix(const uint8_t* a, const uint8_t* b, size_t maximum) {
+    size_t length = 0;
+
+    while (length < maximum) {
+        size_t byte = length >> 3;
+        uint8_t difference = a[byte] ^ b[byte];
+
+        if (difference != 0) {
+            length = (byte << 3) + __builtin_clz(difference) - 24;
+            break;
+        }
+
+        length += 8;
+    }
+
+    return min(length, maximum);
+}
+
+/**
+ * Clear the bits of an address after a prefix.
+ */
+void mask(uint8_t* address, size_t length) {
+
+    for (size_t byte = length >> 3; byte < 16; ++byte) {
+        size_t kept = byte == length >> 3 ? length & 7 : 0;
+
+        address[byte] &= kept == 0 ? 0 : static_cast<uint8_t>(0xff << (8 - kept));
+    }
+}
+
+} // namespace
+
+/*-- Table --*/
+
+NetworkMap::Table::Table(uint64_t generation) :
+    generation_(generation) {
+
+    uint8_t any[16] = { 0 };
+
+    add(any, 0, -1);
+}
+
+uint64_t NetworkMap::Table::generation() const {
+    return generation_;
+}
+
+size_t NetworkMap::Table::size() const {
+    return networks_.size();
+}
+
+void NetworkMap::Table::insert(const uint8_t* address, size_t length, const Network& network) {
+    uint8_t key[16];
+
+    memcpy(key, address, sizeof(key));
+    mask(key, length);
+
+    int32_t current = 0;
+
+    for (;;) {
+        if (nodes_[current].length == length) break;
+
+        int bit = bitAt(key, nodes_[current].length);
+        int32_t child = nodes_[current].children[bit];
+
+        // Nodes are added before linking them, adding may move the others
+        if (child < 0) {
+            int32_t leaf = add(key, length, -1);
+
+            nodes_[current].children[bit] = leaf;
+            current = leaf;
+            break;
+        }
+
+        size_t childLength = nodes_[child].length;
+        size_t common = commonPrefix(key, nodes_[child].address, min(length, childLength));
+
+        if (common == childLength) {
+            current = child;
+            continue;
+        }
+
+        // The network goes between the node and its child, the child prefix
+        // being longer or diverging
+        int32_t parent = add(key, common, -1);
+
+        nodes_[parent].children[bitAt(nodes_[child].address, common)] = child;
+        nodes_[current].children[bit] = parent;
+
+        if (common < length) {
+            int32_t leaf = add(key, length, -1);
+
+            nodes_[parent].children[bitAt(key, common)] = leaf;
+            current = leaf;
+        }
+        else {
+            current = parent;
+        }
+
+        break;
+    }
+
+    if (nodes_[current].network < 0) {
+        nodes_[current].network = networks_.size();
+        networks_.push_back(network);
+    }
+    else {
+        networks_[nodes_[current].network] = network;
+    }
+}
+
+const NetworkMap::Network* NetworkMap::Table::lookup(const uint8_t* address) const {
+    const Network* found = nodes_[0].network >= 0 ? &networks_[nodes_[0].network] : NULL;
+    int32_t current = 0;
+
+    while (nodes_[current].length < ADDRESS_BITS) {
+        int32_t child = nodes_[current].children[bitAt(address, nodes_[current].length)];
+
+        if (child < 0) break;
+
+        const Node& node = nodes_[child];
+
+        if (commonPrefix(address, node.address, node.length) < node.length) break;
+
+        if (node.network >= 0) found = &networks_[node.network];
+
+        current = child;
+    }
+
+    return found;
+}
+
+int32_t NetworkMap::Table::add(const uint8_t* address, size_t length, int32_t network) {
+    Node node;
+
+    memcpy(node.address, address, sizeof(node.address));
+    mask(node.address, length);
+    node.length = length;
+    node.children[0] = node.children[1] = -1;
+    node.network = network;
+
+    nodes_.push_back(node);
+
+    return nodes_.size() - 1;
+}
+
+/*-- constructors/destructor --*/
+
+NetworkMap::NetworkMap(const string& path) :
+    path_(path), device_(0), inode_(0), size_(0), modified_(0),
+    table_(new Table(++lastGeneration)) {
+
+    generation_.store(table_->generation());
+}
+
+NetworkMap::~NetworkMap() {
+}
+
+/*-- static methods --*/
+
+shared_ptr<NetworkMap> NetworkMap::open(const string& path) {
+    lock_guard<mutex> lock(registryMutex);
+    shared_ptr<NetworkMap> networks = registry[path].lock();
+
+    if (!networks) {
+        networks = make_shared<NetworkMap>(path);
+        registry[path] = networks;
+    }
+
+    networks->refresh();
+
+    return networks;
+}
+
+void NetworkMap::refreshAll() {
+    vector<shared_ptr<NetworkMap>> maps;
+
+    {
+        lock_guard<mutex> lock(registryMutex);
+
+        for (auto it = registry.begin(); it != registry.end();) {
+            shared_ptr<NetworkMap> networks = it->second.lock();
+
+            if (networks) {
+                maps.push_back(networks);
+                ++it;
+            }
+            else {
+                it = registry.erase(it);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < maps.size(); ++i) maps[i]->refresh();
+}
+
+bool NetworkMap::parse(const char* text, uint8_t* address) {
+    in_addr ipv4;
+
+    if (inet_pton(AF_INET, text, &ipv4) == 1) {
+        memset(address, 0, 10);
+        address[10] = address[11] = 0xff;
+        memcpy(address + 12, &ipv4, 4);
+        return true;
+    }
+
+    return inet_pton(AF_INET6, text, address) == 1;
+}
+
+/*-- getters/setters --*/
+
+uint64_t NetworkMap::generation() const {
+    return generation_.load(memory_order_acquire);
+}
+
+shared_ptr<const NetworkMap::Table> NetworkMap::table() const {
+    return atomic_load(&table_);
+}
+
+/*-- methods --*/
+
+bool NetworkMap::refresh() {
+    lock_guard<mutex> lock(mutex_);
+    struct stat status;
+
+    // Failures are reported once, until the file changes
+    if (stat(path_.c_str(), &status) != 0) {
+        if (modified_ >= 0) LOG_ERROR("Unable to open networks file: " << path_);
+
+        modified_ = -1;
+        return false;
+    }
+
+    int64_t modified = status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec;
+
+    if (status.st_dev == device_ && status.st_ino == inode_ && status.st_size == size_
+        && modified == modified_) {
+        return false;
+    }
+
+    device_ = status.st_dev;
+    inode_ = status.st_ino;
+    size_ = status.st_size;
+    modified_ = modified;
+
+    shared_ptr<const Table> table(load());
+
+    if (!table) {
+        LOG_ERROR("Unable to read networks file: " << path_ << ". Keeping the current one");
+        return false;
+    }
+
+    // Published at once, the users take it before their next lookup
+    atomic_store(&table_, table);
+    generation_.store(table->generation(), memory_order_release);
+
+    LOG_INFO("Loaded " << table->size() << " networks from " << path_);
+    return true;
+}
+
+NetworkMap::Table* NetworkMap::load() const {
+    ifstream file(path_.c_str());
+
+    if (!file.is_open()) return NULL;
+
+    unique_ptr<Table> table(new Table(++lastGeneration));
+    string line;
+    int number = 0;
+
+    while (getline(file, line)) {
+        ++number;
+
+        istringstream fields(line);
+        string cidr;
+        Network network;
+
+        if (!(fields >> cidr) || cidr[0] == '#') continue;
+
+        fields >> network.datacenter >> network.vlan >> network.scope;
+
+        if (network.scope.empty()) network.scope = DEFAULT_SCOPE;
+
+        size_t slash = cidr.find('/');
+        string text = cidr.substr(0, slash);
+        uint8_t address[16];
+
+        if (!parse(text.c_str(), address)) {
+            LOG_WARN("Invalid network " << cidr << " at " << path_ << ":" << number << ", skipped");
+            continue;
+        }
+
+        size_t offset = text.find(':') == string::npos ? IPV4_OFFSET : 0;
+        size_t length = ADDRESS_BITS;
+
+        if (slash != string::npos) {
+            const char* prefix = cidr.c_str() + slash + 1;
+            char* end;
+            long bits = strtol(prefix, &end, 10);
+
+            if (end == prefix || *end != '\0' || bits < 0
+                || static_cast<size_t>(bits) > ADDRESS_BITS - offset) {
+
+                LOG_WARN("Invalid prefix " << cidr << " at " << path_ << ":" << number << ", skipped");
+                continue;
+            }
+
+            length = offset + bits;
+        }
+
+        table->insert(address, length, network);
+    }
+
+    return table.release();
+}
@@ -0,0 +1,229 @@
+/**
+ * @file NetworkMap.hh
+ * @brief Internal networks map class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_NETWORK_MAP_HH_
+#define _LOG2KAFKA_NETWORK_MAP_HH_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "config.hh"
+
+/**
+ * Map of the internal networks, read from a local file with a network per
+ * line:
+ *
+ * <b>&lt;address&gt;/&lt;prefix&gt; &lt;datacenter&gt; &lt;vlan&gt;
+ * [&lt;scope&gt;]</b>
+ *
+ * IPv4 and IPv6 networks can be mixed, the scope is <b>internal</b> if
+ * omitted, and lines starting with <b>#</b> are comments.
+ *
+ * The networks are kept in a path compressed binary trie (Patricia), and
+ * an address is looked up by its longest matching prefix.
+ *
+ * Maps are shared by path. When the file changes, #refresh() loads it into
+ * a new table, published at once: the users keep the table they hold
+ * until they see the new generation and take it.
+ */
+class NetworkMap {
+public:
+
+    /**
+     * Attributes of a network.
+     */
+    struct Network {
+        std::string datacenter;
+        std::string vlan;
+        std::string scope;
+    };
+
+    /**
+     * A loaded networks file.
+     */
+    class Table {
+    public:
+
+        /**
+         * Class constructor, of an empty table.
+         */
+        explicit Table(uint64_t generation);
+
+        /**
+         * Return the table generation, unique across all the maps.
+         */
+        uint64_t generation() const;
+
+        /**
+         * Return the number of networks.
+         */
+        size_t size() const;
+
+        /**
+         * Add a network, replacing the attributes of the same prefix.
+         *
+         * @param address the network address (IPv4 mapped to IPv6)
+         * @param length the prefix length, up to 128
+         */
+        void insert(const uint8_t* address, size_t length, const Network& network);
+
+        /**
+         * Return the network of an address (IPv4 mapped to IPv6) with the
+         * longest prefix, or NULL if no network contains it.
+         */
+        const Network* lookup(const uint8_t* address) const;
+
+    private:
+
+        /**
+         * A trie node: a prefix, and the network if it is one.
+         */
+        struct Node {
+            uint8_t address[16];
+            size_t length;
+            int32_t children[2];
+            int32_t network;
+        };
+
+        uint64_t generation_;
+        std::vector<Node> nodes_;
+        std::vector<Network> networks_;
+
+        /**
+         * Add a node and return its index.
+         */
+        int32_t add(const uint8_t* address, size_t length, int32_t network);
+    };
+
+    /**
+     * Class constructor.
+     *
+     * @param path the networks file path
+     */
+    explicit NetworkMap(const std::string& path);
+    virtual ~NetworkMap();
+
+    /*-- static methods --*/
+
+    /**
+     * Return the map of a networks file, shared by all its users, loading
+     * it if new or changed.
+     */
+    static std::shared_ptr<NetworkMap> open(const std::string& path);
+
+    /**
+     * Reload the networks files changed since they were loaded.
+     */
+    static void refreshAll();
+
+    /**
+     * Parse an IPv4 or IPv6 address, IPv4 mapped to IPv6.
+     *
+     * @return false if the text is not an address
+     */
+    static bool parse(const char* text, uint8_t* address);
+
+    /*-- getters/setters --*/
+
+    /**
+     * Return the generation of the current table, cheap enough to check
+     * for every entry.
+     */
+    uint64_t generation() const;
+
+    /**
+     * Return the current table.
+     */
+    std::shared_ptr<const Table> table() const;
+
+    /*-- methods --*/
+
+    /**
+     * Load the file again if it changed (or was replaced) since it was
+     * loaded. A file that can not be read keeps the current table.
+     *
+     * @return true if a new table was published
+     */
+    bool refresh();
+
+private:
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /*-- fields --*/
+
+    /**
+     * Networks file path.
+     */
+    std::string path_;
+
+    /**
+     * Identity and modification time of the loaded file.
+     */
+    dev_t device_;
+    ino_t inode_;
+    off_t size_;
+    int64_t modified_;
+
+    /**
+     * Current table, and its generation.
+     */
+    std::shared_ptr<const Table> table_;
+    std::atomic<uint64_t> generation_;
+
+    /**
+     * Serializes the refreshes.
+     */
+    std::mutex mutex_;
+
+    /*-- methods --*/
+
+    /**
+     * Read the networks file into a new table.
+     *
+     * @return NULL if the file can not be read
+     */
+    Table* load() const;
+};
+
+#endif /* _LOG2KAFKA_NETWORK_MAP_HH_ */
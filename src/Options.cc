@@ -0,0 +1,350 @@
+/**
+ * @file Options.cc
+ * @brief Command line and configuration file options class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#include "Options.hh"
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr Options::logger(Logger::getLogger("Options"));
+#endif
+
+namespace {
+
+/**
+ * Options descriptions, built on first use.
+ */
+struct Descriptions {
+    po::options_description commandLine;
+    po::options_description configFile;
+
+    Descriptions() {
+        po::options_description generic("Generic options");
+        po::options_description avroOptions("Avro options");
+        po::options_description flowOptions("Flow control options");
+        po::options_description failureOptions("Failure handling options");
+        po::options_description multilineOptions("Multiline record options");
+        po::options_description daemonOptions("Daemon options");
+        po::options_description metricsOptions("Metrics options");
+        po::options_description sinkOptions("Sink options");
+        po::options_description placementOptions("CPU placement options");
+        po::options_description kafkaOptions("Kafka options");
+
+        /* General options */
+
+        generic.add_options()
+        ("version", "display version number")
+        ("help,?", "produce help message")
+        ("config,f", po::value<std::string>(), "client configuration file path")
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+        ("log-config,l", po::value<std::string>(), "log4cxx configuration file path")
+#else
+        ("verbose", "increase verbosity")
+#endif
+        ("message,m", po::value<std::string>(),
+            "message to send - if not indicated then standard input is used")
+        ("input,i", po::value<std::vector<std::string>>()->multitoken()->composing(),
+            "files to read instead of the standard input, in order - gzip and zstd files are"
+            " decompressed")
+        ("input.threads", po::value<int>()->default_value(Constants::DEFAULT_INPUT_THREADS),
+            "threads decompressing the input files");
+
+        /* Avro options */
+
+        avroOptions.add_options()
+        ("schema,s", po::value<std::string>(),
+            "Avro definitition file to use for serialization - if omitted the raw entry will be sent");
+
+        /* Flow control options */
+
+        flowOptions.add_options()
+        ("throttle.rate", po::value<int>(), "maximum lines per second sent to the topic")
+        ("throttle.burst", po::value<int>(), "lines allowed over the rate in a burst - default: one second worth")
+        ("sampling.threshold", po::value<int>(),
+            "input lines per second above which only 1 in N lines is sent")
+        ("sampling.rate", po::value<int>()->default_value(Constants::DEFAULT_SAMPLING_RATE),
+            "the N of the 1-in-N sampling")
+        ("sampling.field", po::value<std::string>()->default_value(Constants::DEFAULT_SAMPLING_FIELD),
+            "record field that receives the sample rate (if defined in the schema)")
+        ("sampling.keep-field",
+            po::value<std::string>()->default_value(Constants::DEFAULT_SAMPLING_KEEP_FIELD),
+            "record field checked to exempt entries from sampling")
+        ("sampling.keep-min", po::value<int>()->default_value(Constants::DEFAULT_SAMPLING_KEEP_MINIMUM),
+            "minimum keep field value exempted from sampling")
+        ("memory.budget", po::value<int>()->default_value(Constants::DEFAULT_MEMORY_BUDGET),
+            "megabytes of entries and messages held in the input buffers, daemon queues,"
+            " kafka client queue and spool replay - 0 for no limit. When reached,"
+            " daemon.backpressure applies")
+            ;
+
+        /* Failure handling options */
+
+        failureOptions.add_options()
+        ("dead-letter.topic", po::value<std::string>(),
+            "topic for entries that fail to map/serialize, keyed by the failure reason"
+            " - if omitted they are sent raw to the target topic")
+        ("failures.summary-interval",
+            po::value<int>()->default_value(Constants::DEFAULT_FAILURE_SUMMARY_INTERVAL),
+            "seconds between failure counter summaries in the log")
+        ("startup.timeout", po::value<int>()->default_value(Constants::DEFAULT_STARTUP_TIMEOUT),
+            "milliseconds waiting at start for the brokers and the topics metadata before"
+            " reading input - 0 reads at once")
+        ("shutdown.timeout", po::value<int>()->default_value(Constants::DEFAULT_SHUTDOWN_TIMEOUT),
+            "milliseconds waiting for the queued messages to be delivered at exit")
+        ("shutdown.spool", po::value<std::string>(),
+            "file where the messages not delivered are kept, and produced again on the next"
+            " start - if omitted they are lost")
+            ;
+
+        /* Multiline record options */
+
+        multilineOptions.add_options()
+        ("multiline.start", po::value<std::string>(),
+            "pattern matching the first line of a record, other lines are joined to it"
+            " - overridden by a 'multiline.start' or 'multiline.continuation' schema directive")
+        ("multiline.continuation", po::value<std::string>(),
+            "pattern matching the lines joined to the previous one (ej. '\\s|Caused by')")
+        ("multiline.max-lines",
+            po::value<int>()->default_value(Constants::DEFAULT_MULTILINE_MAX_LINES),
+            "maximum lines joined in a record")
+        ("multiline.max-bytes",
+            po::value<int>()->default_value(Constants::DEFAULT_MULTILINE_MAX_BYTES),
+            "maximum size of a record")
+        ("multiline.timeout", po::value<int>()->default_value(Constants::DEFAULT_MULTILINE_TIMEOUT),
+            "milliseconds a record waits for more lines")
+            ;
+
+        /* Daemon options */
+
+        daemonOptions.add_options()
+        ("daemon,d", "serve the sources below until stopped, sharing a single producer")
+        ("daemon.source", po::value<std::vector<std::string>>()->composing(),
+            "FIFO source (created if needed): <path>=<topic>[:<partition>][,<schema>]")
+        ("daemon.listen", po::value<std::string>(),
+            "Unix domain socket to accept sources on. Each connection declares its"
+            " source in a first line: #log2kafka <topic>[:<partition>][,<schema>]")
+        ("daemon.syslog-udp", po::value<std::vector<std::string>>()->composing(),
+            "syslog UDP port: [<address>:]<port>=<topic>[:<partition>][,<schema>]")
+        ("daemon.syslog-tcp", po::value<std::vector<std::string>>()->composing(),
+            "syslog TCP port: [<address>:]<port>=<topic>[:<partition>][,<schema>]")
+        ("daemon.file", po::value<std::vector<std::string>>()->composing(),
+            "log files tailed, followed across rotations: <path or glob>=<topic>[:<partition>][,<schema>]")
+        ("daemon.file-from-start", "read the daemon files from their beginning instead of their end")
+        ("daemon.file-interval", po::value<int>()->default_value(Constants::DEFAULT_FILE_INTERVAL),
+            "milliseconds between checks of a daemon file at its end")
+        ("daemon.file-engine", po::value<std::string>()->default_value(Constants::DEFAULT_FILE_ENGINE),
+            "daemon files reading engine: uring|read")
+        ("daemon.file-io-depth", po::value<int>()->default_value(Constants::DEFAULT_FILE_IO_DEPTH),
+            "maximum daemon file reads in flight with the uring engine")
+        ("daemon.workers", po::value<int>()->default_value(Constants::DEFAULT_DAEMON_WORKERS),
+            "worker threads serializing and producing entries")
+        ("daemon.queue-size", po::value<int>()->default_value(Constants::DEFAULT_DAEMON_QUEUE_SIZE),
+            "maximum entries queued per worker")
+        ("daemon.backpressure", po::value<std::string>()->default_value("block"),
+            "behavior when a worker queue is full or the memory budget is reached: block|drop")
+        ("daemon.buffer-size", po::value<int>()->default_value(Constants::DEFAULT_READ_BUFFER_SIZE),
+            "read buffer size per source, also the maximum entry length")
+        ("connect", po::value<std::string>(),
+            "thin client mode: forward the standard input to the daemon listening on this socket")
+            ;
+
+        /* Metrics options */
+
+        metricsOptions.add_options()
+        ("metrics.listen", po::value<std::string>(),
+            "expose the metrics in Prometheus format over HTTP on a Unix socket path or"
+            " [<address>:]<port>")
+            ;
+
+        /* CPU placement options */
+
+        placementOptions.add_options()
+        ("cpus.reader", po::value<std::string>(),
+            "CPUs of the thread reading the input, ej. 0-3,8")
+        ("cpus.worker", po::value<std::vector<std::string>>()->composing(),
+            "CPUs of a daemon worker thread - repeat for the next workers, reused in turn")
+        ("cpus.poller", po::value<std::string>(), "CPUs of the daemon delivery reports thread")
+        ("cpus.kafka", po::value<std::string>(), "CPUs of the kafka client threads")
+            ;
+
+        /* Sink options */
+
+        sinkOptions.add_options()
+        ("sink", po::value<std::string>()->default_value(Constants::DEFAULT_SINK),
+            "where the messages go: kafka|file")
+        ("sink.directory", po::value<std::string>()->default_value(Constants::DEFAULT_SINK_DIRECTORY),
+            "file sink directory, with one set of rolling files per topic")
+        ("sink.roll-size", po::value<int>()->default_value(Constants::DEFAULT_SINK_ROLL_SIZE),
+            "megabytes from which a file is closed and a new one started")
+        ("sink.roll-interval", po::value<int>()->default_value(Constants::DEFAULT_SINK_ROLL_INTERVAL),
+            "seconds from which a file is closed and a new one started")
+        ("sink.block-records", po::value<int>()->default_value(Constants::DEFAULT_SINK_BLOCK_RECORDS),
+            "records per Avro container block")
+        ("sink.codec", po::value<std::string>()->default_value(Constants::DEFAULT_SINK_CODEC),
+            "Avro container block codec: deflate|null")
+            ;
+
+        /* Kafka options */
+
+        kafkaOptions.add_options()
+        ("kafka.client.id,c", po::value<std::string>()->default_value(Constants::DEFAULT_CLIENT_ID),
+            "producer client name/id")
+        ("kafka.metadata.broker.list,b", po::value<std::string>(),
+            "A comma separated list of brokers:\n <host>[:<port>][,...]")
+        ("kafka.topic,t", po::value<std::string>(), "target topic: <topic_name>[:<partition>]")
+        ("producer.shards", po::value<int>()->default_value(Constants::DEFAULT_PRODUCER_SHARDS),
+            "kafka client handles, each with its own queue, thread and broker connections."
+            " Topics are spread across them, so a single topic (ej. the standard input) uses one")
+        ("kafka_topic.request.required.acks", po::value<int>())
+        ("kafka_topic.request.timeout.ms", po::value<int>())
+        ("kafka_topic.message.timeout.ms", po::value<int>())
+        ("kafka.key,k", po::value<string>(), "kafka message key to use")
+        ("kafka.codec,z", po::value<std::string>(), "Compression codec to use: gzip|snappy")
+        ("kafka.message.max.bytes", po::value<int>())
+        ("kafka.metadata.request.timeout.ms", po::value<int>())
+        ("kafka.topic.metadata.refresh.interval.ms", po::value<int>())
+        ("kafka.topic.metadata.refresh.fast.cnt", po::value<int>())
+        ("kafka.topic.metadata.refresh.fast.interval.ms", po::value<int>())
+        ("kafka.socket.timeout.ms", po::value<int>())
+        ("kafka.socket.send.buffer.bytes", po::value<int>())
+        ("kafka.socket.receive.buffer.bytes", po::value<int>())
+        ("kafka.broker.address.ttl", po::value<int>())
+        ("kafka.statistics.interval.ms", po::value<int>())
+        ("kafka.queued.min.messages", po::value<int>())
+        ("kafka.fetch.wait.max.ms", po::value<int>())
+        ("kafka.fetch.min.bytes", po::value<int>())
+        ("kafka.fetch.error.backoff.ms", po::value<int>())
+        ("kafka.queue.buffering.max.messages", po::value<int>())
+        ("kafka.queue.buffering.max.ms", po::value<int>())
+        ("kafka.message.send.max.retries", po::value<int>())
+        ("kafka.retry.backoff.ms", po::value<int>())
+        ("kafka.batch.num.messages", po::value<int>())
+        ("kafka.request.required.acks", po::value<int>())
+        ("kafka.request.timeout.ms", po::value<int>())
+        ("kafka.message.timeout.ms", po::value<int>())
+        ("kafka.debug", po::value<std::string>(),
+            "A comma-separated list of debug contexts to enable: all,generic,broker,topic,metadata,producer,queue,msg")
+            ;
+
+        commandLine.add(generic).add(avroOptions).add(flowOptions).add(failureOptions)
+            .add(multilineOptions).add(daemonOptions).add(placementOptions).add(metricsOptions)
+            .add(sinkOptions).add(kafkaOptions);
+
+        configFile.add(flowOptions).add(failureOptions).add(multilineOptions).add(daemonOptions)
+            .add(placementOptions).add(metricsOptions).add(sinkOptions).add(kafkaOptions);
+    }
+};
+
+const Descriptions& descriptions() {
+    static const Descriptions instance;
+    return instance;
+}
+
+} // namespace
+
+/*-- static methods --*/
+
+const po::options_description& Options::commandLine() {
+    return descriptions().commandLine;
+}
+
+const po::options_description& Options::configFile() {
+    return descriptions().configFile;
+}
+
+void Options::parseCommandLine(int argc, const char* const* argv, po::variables_map& vm) {
+    po::store(po::parse_command_line(argc, argv, commandLine()), vm);
+}
+
+void Options::parseConfigFile(po::variables_map& vm) {
+
+    if (!vm.count("config")) return;
+
+    fs::path configFilePath(vm["config"].as<string>());
+    fs::path configPath(Constants::DEFAULT_CONFIG_PATH);
+
+    if (!configFilePath.is_complete()) {
+        configFilePath = configPath / configFilePath;
+    }
+
+    if (fs::exists(configFilePath)) {
+        ifstream configFile(configFilePath.string());
+
+        LOG_DEBUG("Reading additional options from: " << configFilePath);
+        po::store(po::parse_config_file(configFile, Options::configFile()), vm);
+    }
+    else {
+        LOG_WARN("The indicated configuration file '" << configFilePath << "' does not exist");
+    }
+}
+
+void Options::validate(const po::variables_map& vm) {
+
+    // The thin client only needs the topic, the daemon the brokers, unless
+    // writing to files
+
+    const string& sink = vm["sink"].as<string>();
+
+    if (sink != "kafka" && sink != "file") {
+        throw invalid_argument("'sink' must be kafka or file.");
+    }
+
+    if (!vm.count("kafka.metadata.broker.list") && !vm.count("connect") && sink == "kafka") {
+        throw invalid_argument("'kafka.metadata.broker.list (-b)' argument was not set.");
+    }
+
+    if (!vm.count("kafka.topic") && !vm.count("daemon")) {
+        throw invalid_argument("'kafka.topic (-t)' argument was not set.");
+    }
+
+    if (vm.count("daemon") && vm.count("connect")) {
+        throw invalid_argument("'daemon' and 'connect' arguments are mutually exclusive.");
+    }
+
+    if (vm.count("input") && (vm.count("daemon") || vm.count("connect") || vm.count("message"))) {
+        throw invalid_argument("'input' can not be used with 'daemon', 'connect' or 'message'.");
+    }
+
+    if (vm["memory.budget"].as<int>() < 0) {
+        throw invalid_argument("'memory.budget' can not be negative.");
+    }
+
+    const string& engine = vm["daemon.file-engine"].as<string>();
+
+    if (engine != "uring" && engine != "read") {
+        throw invalid_argument("'daemon.file-engine' must be uring or read.");
+    }
+}
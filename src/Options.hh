@@ -0,0 +1,92 @@
+/**
+ * @file Options.hh
+ * @brief Command line and configuration file options class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_OPTIONS_HH_
+#define _LOG2KAFKA_OPTIONS_HH_
+
+#include "config.hh"
+
+/**
+ * The program options, shared by the command line tool and the embedded
+ * library (see l2k.h), so both accept the same arguments and configuration
+ * files.
+ */
+class Options {
+public:
+
+    /*-- static methods --*/
+
+    /**
+     * Return the options accepted in the command line.
+     */
+    static const boost::program_options::options_description& commandLine();
+
+    /**
+     * Return the options accepted in a configuration file.
+     */
+    static const boost::program_options::options_description& configFile();
+
+    /**
+     * Store the command line arguments.
+     *
+     * @param argc the arguments count
+     * @param argv the arguments, not including the program name when
+     *             embedded
+     * @param vm the map receiving the options
+     */
+    static void parseCommandLine(int argc, const char* const* argv,
+        boost::program_options::variables_map& vm);
+
+    /**
+     * Store the options of the configuration file given with
+     * <b>--config</b>, if any. Command line values take precedence.
+     */
+    static void parseConfigFile(boost::program_options::variables_map& vm);
+
+    /**
+     * Check the options are consistent.
+     *
+     * @throw invalid_argument if a required option is missing
+     */
+    static void validate(const boost::program_options::variables_map& vm);
+
+private:
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+};
+
+#endif /* _LOG2KAFKA_OPTIONS_HH_ */
@@ -0,0 +1,90 @@
+/**
+ * @file ParseFailures.cc
+ * @brief Parse failure accounting class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ParseFailures.hh"
+
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr ParseFailures::logger(Logger::getLogger("ParseFailures"));
+#endif
+
+/*-- constructors/destructor --*/
+
+ParseFailures::ParseFailures() :
+    total_(0),
+    summaryInterval_(chrono::seconds(Constants::DEFAULT_FAILURE_SUMMARY_INTERVAL)),
+    summarized_(Clock::now()) {
+}
+
+ParseFailures::~ParseFailures() {
+    summarize();
+}
+
+/*-- getters/setters --*/
+
+void ParseFailures::summaryInterval(int seconds) {
+    summaryInterval_ = chrono::seconds(seconds);
+}
+
+int64_t ParseFailures::total() const {
+    return total_;
+}
+
+/*-- methods --*/
+
+void ParseFailures::count(const string& pattern, const char* reason) {
+    Key key(pattern, reason);
+
+    ++total_;
+
+    if (totals_[key]++ == 0) {
+        LOG_ERROR("Entry does not fit the schema: " << reason
+            << ". Further failures will be summarized");
+    }
+
+    ++pending_[key];
+
+    Clock::time_point now = Clock::now();
+
+    if (now - summarized_ >= summaryInterval_) {
+        summarize();
+    }
+}
+
+void ParseFailures::summarize() {
+    summarized_ = Clock::now();
+
+    for (map<Key, int64_t>::const_iterator it = pending_.begin(); it != pending_.end(); ++it) {
+        LOG_WARN(it->second << " entries failed (" << totals_[it->first] << " in total): "
+            << it->first.second << "\n\tpattern: " << it->first.first);
+    }
+
+    pending_.clear();
+}
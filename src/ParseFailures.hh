@@ -0,0 +1,124 @@
+/**
+ * @file ParseFailures.hh
+ * @brief Parse failure accounting class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifndef _LOG2KAFKA_PARSE_FAILURES_HH_
+#define _LOG2KAFKA_PARSE_FAILURES_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "config.hh"
+
+/**
+ * Parse failure accounting.
+ *
+ * Counts the entries that could not be mapped or serialized, per mapper
+ * pattern and failure reason. Instead of logging every failure, the first
+ * occurrence of each reason is logged and the counters are summarized at
+ * most once per interval, so a format drift does not flood the log.
+ */
+class ParseFailures {
+public:
+
+    ParseFailures();
+    virtual ~ParseFailures();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Set the minimum time between two summaries, in seconds.
+     */
+    void summaryInterval(int seconds);
+
+    /**
+     * Return the total failures counted.
+     */
+    int64_t total() const;
+
+    /*-- methods --*/
+
+    /**
+     * Count a failure.
+     *
+     * @param pattern the mapper pattern the entry was checked against
+     * @param reason the failure description
+     */
+    void count(const std::string& pattern, const char* reason);
+
+    /**
+     * Log the failures counted since the last summary, if any.
+     */
+    void summarize();
+
+private:
+
+    typedef std::chrono::steady_clock Clock;
+    typedef std::pair<std::string, std::string> Key;
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /*-- fields --*/
+
+    /**
+     * Failures since the last summary, per pattern and reason.
+     */
+    std::map<Key, int64_t> pending_;
+
+    /**
+     * Failures since start, per pattern and reason.
+     */
+    std::map<Key, int64_t> totals_;
+
+    /**
+     * Total failures since start.
+     */
+    int64_t total_;
+
+    /**
+     * Minimum time between two summaries.
+     */
+    Clock::duration summaryInterval_;
+
+    /**
+     * Time of the last summary.
+     */
+    Clock::time_point summarized_;
+};
+
+#endif /* _LOG2KAFKA_PARSE_FAILURES_HH_ */
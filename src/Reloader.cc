@@ -0,0 +1,94 @@
+/**
+ * @file Reloader.cc
+ * @brief Configuration hot reload thread class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <chrono>
+
+#include "NetworkMap.hh"
+#include "Reloader.hh"
+
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr Reloader::logger(Logger::getLogger("Reloader"));
+#endif
+
+volatile sig_atomic_t Reloader::requested_ = 0;
+
+/*-- constructors/destructor --*/
+
+Reloader::Reloader(Sink& sink) :
+    sink_(sink), stopped_(false) {
+}
+
+Reloader::~Reloader() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopped_ = true;
+    }
+
+    wakeUp_.notify_all();
+
+    if (thread_.joinable()) thread_.join();
+}
+
+/*-- static methods --*/
+
+void Reloader::request() {
+    requested_ = 1;
+}
+
+/*-- methods --*/
+
+void Reloader::start() {
+    thread_ = thread(&Reloader::watch, this);
+}
+
+void Reloader::watch() {
+    unique_lock<mutex> lock(mutex_);
+
+    while (!stopped_) {
+        // A signal handler can not notify, the flag is checked periodically
+        wakeUp_.wait_for(lock, chrono::milliseconds(Constants::DAEMON_POLL_INTERVAL));
+
+        if (stopped_) continue;
+
+        NetworkMap::refreshAll();
+
+        if (!requested_) continue;
+
+        requested_ = 0;
+
+        LOG_INFO("Reloading the schema configuration files");
+
+        int failed = sink_.reload();
+
+        if (failed > 0) LOG_ERROR(failed << " schema configuration files not reloaded");
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * @file Reloader.hh
+ * @brief Configuration hot reload thread class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_RELOADER_HH_
+#define _LOG2KAFKA_RELOADER_HH_
+
+#include <condition_variable>
+#include <csignal>
+#include <mutex>
+#include <thread>
+
+#include "Sink.hh"
+
+/**
+ * Background thread reloading the schema configuration files of the sink
+ * channels when requested, ej. on SIGHUP.
+ *
+ * The new serializers are built and validated in this thread, away from
+ * the entries, and taken by the sending threads between two entries. The
+ * producer, its connections and its queue are not touched.
+ *
+ * The networks files of the enriched channels are also checked on every
+ * wake up, and reloaded as soon as they change.
+ */
+class Reloader {
+public:
+
+    /**
+     * Class constructor.
+     *
+     * @param sink the sink whose channels are reloaded
+     */
+    explicit Reloader(Sink& sink);
+    virtual ~Reloader();
+
+    /*-- static methods --*/
+
+    /**
+     * Request a reload. Safe to call from a signal handler.
+     */
+    static void request();
+
+    /*-- methods --*/
+
+    /**
+     * Start the thread.
+     */
+    void start();
+
+private:
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /**
+     * Reload request flag.
+     */
+    static volatile sig_atomic_t requested_;
+
+    /*-- fields --*/
+
+    /**
+     * The sink whose channels are reloaded.
+     */
+    Sink& sink_;
+
+    /**
+     * Reload thread, its stop flag and the condition that wakes it up to
+     * stop.
+     */
+    std::thread thread_;
+    bool stopped_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+
+    /*-- methods --*/
+
+    /**
+     * Reload thread body.
+     */
+    void watch();
+};
+
+#endif /* _LOG2KAFKA_RELOADER_HH_ */
@@ -25,6 +25,9 @@
  * limitations under the License.
  */
 
+#include <cstring>
+#include <thread>
+
 #include "Serializer.hh"
 
 using namespace std;
@@ -43,17 +46,20 @@ const static Magic magic = { { 'O', 'b', 'j', '\x01' } };
 const static string AVRO_SCHEMA_KEY("avro.schema");
 const static string AVRO_CODEC_KEY("avro.codec");
 const static string AVRO_NULL_CODEC("null");
+const static string DEFAULT_ENRICH_FIELD("host");
 
 /*-- constructors/destructor --*/
 
-Serializer::Serializer() {
+Serializer::Serializer() :
+    output_(AVRO), direct_(false), loaded_(false) {
 }
 
 Serializer::~Serializer() {
 }
 
 Serializer::Serializer(std::string configFilePath) :
-    configFilePath_(boost::trim_copy(configFilePath)) {
+    configFilePath_(boost::trim_copy(configFilePath)), output_(AVRO), direct_(false),
+    loaded_(false) {
 
     LOG_DEBUG("Schema established to = " << configFilePath);
     configure();
@@ -70,6 +76,35 @@ const string& Serializer::configFilePath() const {
     return this->configFilePath_;
 }
 
+Mapper& Serializer::mapper() {
+    return mapper_;
+}
+
+bool Serializer::directive(const string& name, string& value) const {
+    std::map<string, string>::const_iterator it = directives_.find(name);
+
+    if (it == directives_.end()) return false;
+
+    value = it->second;
+    return true;
+}
+
+void Serializer::output(Output output) {
+    output_ = output;
+}
+
+Serializer::Output Serializer::output() const {
+    return output_;
+}
+
+bool Serializer::ready() const {
+    return extractor_ || splitter_ || format_ || mapper_.pattern() != "";
+}
+
+bool Serializer::loaded() const {
+    return loaded_;
+}
+
 /*-- methods --*/
 
 void Serializer::configure() {
@@ -91,7 +126,7 @@ void Serializer::configure() {
     ifstream schemaFile(fullSchemaPath);
 
     if (schemaFile.is_open()) {
-        loadMapper(schemaFile);
+        loaded_ = loadMapper(schemaFile);
         schemaFile.close();
     }
     else {
@@ -103,52 +138,128 @@ void Serializer::serialize(const string& entry, auto_ptr<avro::OutputStream>& da
 
     avro::GenericDatum datum(mapper_);
 
-    if (mapper_.pattern() != "") {
+    map(entry, datum);
+    serialize(datum, data);
+}
+
+void Serializer::map(const string& entry, avro::GenericDatum& datum) {
+
+    if (extractor_) {
+        extractor_->extract(datum, entry);
+    }
+    else if (splitter_) {
+        splitter_->split(datum, entry);
+    }
+    else if (format_) {
+        // Entries out of the format are left to the pattern, if any
+        if (!format_->map(datum, entry)) {
+            if (mapper_.pattern() == "") throw MapperMatchException();
 
+            mapper_.map(datum, entry);
+        }
+    }
+    else if (mapper_.pattern() != "") {
         mapper_.map(datum, entry);
-        sync_ = makeSync();
+    }
+    else {
+        throw InvalidMapperException();
+    }
 
-        avro::EncoderPtr baseEncoder = avro::binaryEncoder();
-        baseEncoder->init(*data);
+    if (enricher_) enricher_->enrich(datum);
+}
 
-        writeHeader(baseEncoder);
-        writeDataBlock(baseEncoder, datum, data->byteCount());
+void Serializer::serialize(const avro::GenericDatum& datum, auto_ptr<avro::OutputStream>& data) {
 
-        LOG_DEBUG("Data buffer size: " << data->byteCount());
+    if (output_ == JSON) {
+        json_.encode(datum);
+        writeBuffer(json_.buffer(), *data);
+        return;
+    }
 
-        if (Constants::IS_TRACE_ENABLED) {
+    if (output_ == DATUM) {
+        avro::EncoderPtr encoder = avro::binaryEncoder();
 
-            /* Persist to file */
+        encoder->init(*data);
+        avro::encode(*encoder, datum);
+        encoder->flush();
+        return;
+    }
 
-            const char* tempFileName = buildTempFileName();
+    sync_ = makeSync();
 
-            LOG_TRACE("Generating persistent file: " << tempFileName);
+    avro::EncoderPtr baseEncoder = avro::binaryEncoder();
+    baseEncoder->init(*data);
 
-            auto_ptr<avro::InputStream> inraw = avro::memoryInputStream(*data);
-            auto_ptr<avro::OutputStream> fileStream = avro::fileOutputStream(tempFileName);
+    writeHeader(baseEncoder);
+    writeDataBlock(baseEncoder, datum, data->byteCount());
 
-            copy(*inraw, *fileStream);
+    LOG_DEBUG("Data buffer size: " << data->byteCount());
 
-            fileStream->flush();
-            fileStream.release();
-        }
+    if (Constants::IS_TRACE_ENABLED) {
+
+        /* Persist to file */
+
+        const char* tempFileName = buildTempFileName();
+
+        LOG_TRACE("Generating persistent file: " << tempFileName);
+
+        auto_ptr<avro::InputStream> inraw = avro::memoryInputStream(*data);
+        auto_ptr<avro::OutputStream> fileStream = avro::fileOutputStream(tempFileName);
+
+        copy(*inraw, *fileStream);
+
+        fileStream->flush();
+        fileStream.release();
     }
-    else {
-        throw InvalidMapperException();
+}
+
+bool Serializer::encode(const string& entry, auto_ptr<avro::OutputStream>& data) {
+
+    if (!direct_ || output_ == JSON || extractor_ || splitter_) return false;
+
+    buffer_.clear();
+
+    if (!format_->encode(entry, buffer_)) return false;
+
+    const uint8_t* record = reinterpret_cast<const uint8_t*>(buffer_.data());
+
+    avro::EncoderPtr encoder = avro::binaryEncoder();
+    encoder->init(*data);
+
+    if (output_ == DATUM) {
+        encoder->encodeFixed(record, buffer_.length());
+        encoder->flush();
+        return true;
     }
+
+    /* Same header and data block as writeHeader() and writeDataBlock() */
+
+    sync_ = makeSync();
+
+    encoder->encodeFixed(&header_[0], header_.size());
+    avro::encode(*encoder, sync_);
+    encoder->flush();
+
+    encoder->encodeLong(1);
+    encoder->encodeLong(data->byteCount());
+    encoder->encodeFixed(record, buffer_.length());
+    avro::encode(*encoder, sync_);
+    encoder->flush();
+
+    return true;
 }
 
-void Serializer::loadMapper(istream &is) {
+bool Serializer::loadMapper(istream &is) {
 
     if (!is.good()) {
         LOG_WARN("Invalid schema file. Changing to raw serialization");
-        return;
+        return false;
     }
 
     try {
         /* Extract header, no json related data */
 
-        sregex rex = sregex::compile("\\s*pattern\\s*:\\s*(.*)\\s*");
+        sregex rex = sregex::compile("\\s*([\\w.\\-]+)\\s*:\\s*(.*)\\s*");
         smatch what;
 
         string header;
@@ -164,11 +275,73 @@ void Serializer::loadMapper(istream &is) {
                 break;
             }
             else {
-                // Extract the regular expression pattern for mapping (if present)
+                // Extract the directives, ej. the regular expression pattern
+                // for mapping (if present)
 
                 if (regex_match(header, what, rex)) {
-                    mapper_.pattern(what[1]);
-                    LOG_DEBUG("Mapper pattern to use: " << mapper_.pattern());
+                    directives_[what[1]] = what[2];
+                    LOG_DEBUG("Directive " << what[1] << ": " << what[2]);
+
+                    if (what[1] == "pattern") {
+                        mapper_.pattern(what[2]);
+                        LOG_DEBUG("Mapper pattern to use: " << mapper_.pattern());
+                    }
+                    else if (what[1] == "input") {
+                        string input = boost::trim_copy(what[2].str());
+
+                        if (input == "json") {
+                            extractor_.reset(new JsonExtractor());
+                        }
+                        else {
+                            LOG_WARN("Unknown input " << input << ", using the pattern");
+                        }
+                    }
+                    else if (what[1] == "format") {
+                        string format = boost::trim_copy(what[2].str());
+
+                        format_.reset(BuiltinFormat::create(format));
+
+                        if (!format_) {
+                            LOG_WARN("Unknown format " << format << ", using the pattern");
+                        }
+                    }
+                    else if (what[1] == "split") {
+                        string delimiter = boost::trim_copy(what[2].str());
+
+                        if (delimiter == "logfmt") {
+                            splitter_.reset(new FieldSplitter(' ', true));
+                            splitter_->quote('"');
+                            splitter_->escape('\\');
+                        }
+                        else if (delimiter == "tab" || delimiter == "\\t") {
+                            splitter_.reset(new FieldSplitter('\t', false));
+                        }
+                        else if (delimiter == "space") {
+                            splitter_.reset(new FieldSplitter(' ', false));
+                        }
+                        else if (delimiter == "pipe") {
+                            splitter_.reset(new FieldSplitter('|', false));
+                        }
+                        else if (delimiter == "comma") {
+                            splitter_.reset(new FieldSplitter(',', false));
+                        }
+                        else if (delimiter.length() == 1) {
+                            splitter_.reset(new FieldSplitter(delimiter[0], false));
+                        }
+                        else {
+                            LOG_WARN("Unknown split delimiter " << delimiter << ", using the pattern");
+                        }
+                    }
+                    else if (what[1] == "output") {
+                        string output = boost::trim_copy(what[2].str());
+
+                        if (output == "json") {
+                            output_ = JSON;
+                        }
+                        else if (output != "avro") {
+                            LOG_WARN("Unknown output " << output << ", using avro");
+                        }
+                    }
                 }
             }
         }
@@ -177,10 +350,139 @@ void Serializer::loadMapper(istream &is) {
         avro::compileJsonSchema(is, mapper_);
         setMetadata(AVRO_SCHEMA_KEY, mapper_.compactJson());
 
+        if (extractor_) bindPaths();
+        if (splitter_) bindColumns();
+        if (directives_.count("enrich.networks")) bindEnricher();
+        if (format_) encodeHeader();
+
         if (Constants::IS_DEBUG_ENABLED) debugSchemaNode(mapper_);
     }
     catch (const avro::Exception &e) {
         LOG_WARN("Unexpected AVRO error. Changing to raw mode.\nDetail: " << e.what());
+        return false;
+    }
+
+    return true;
+}
+
+void Serializer::encodeHeader() {
+    // Enriched records are built as datums
+    direct_ = format_->encodes(mapper_.root()) && !enricher_;
+
+    LOG_DEBUG("Built-in format " << format_->name()
+        << (direct_ ? ", encoded without datum" : ", mapped to the schema"));
+
+    if (!direct_) return;
+
+    auto_ptr<avro::OutputStream> out = avro::memoryOutputStream();
+    avro::EncoderPtr encoder = avro::binaryEncoder();
+
+    encoder->init(*out);
+    avro::encode(*encoder, magic);
+    avro::encode(*encoder, metadata_);
+    encoder->flush();
+
+    auto_ptr<avro::InputStream> in = avro::memoryInputStream(*out);
+    const uint8_t* chunk;
+    size_t length;
+
+    header_.clear();
+
+    while (in->next(&chunk, &length)) {
+        header_.insert(header_.end(), chunk, chunk + length);
+    }
+}
+
+void Serializer::bindEnricher() {
+    string path;
+    string field;
+
+    directive("enrich.networks", path);
+    boost::trim(path);
+
+    if (!path.empty() && path[0] != '/') path.insert(0, Constants::DEFAULT_CONFIG_PATH);
+
+    if (directive("enrich.field", field)) {
+        boost::trim(field);
+    }
+    else {
+        field = DEFAULT_ENRICH_FIELD;
+    }
+
+    unique_ptr<Enricher> enricher(new Enricher(NetworkMap::open(path)));
+
+    if (!enricher->bind(mapper_, field)) {
+        LOG_WARN("Unknown enrich field " << field << ", records not enriched");
+        return;
+    }
+
+    enricher_ = move(enricher);
+    LOG_DEBUG("Records enriched by field " << field << " with the networks of " << path);
+}
+
+void Serializer::bindPaths() {
+    const avro::NodePtr& root = mapper_.root();
+
+    if (root->type() != avro::AVRO_RECORD) return;
+
+    for (size_t i = 0; i < root->names(); ++i) {
+        const string& name = root->nameAt(i);
+        string path;
+
+        if (directive("path." + name, path)) {
+            boost::trim(path);
+        }
+        else {
+            path = name;
+        }
+
+        extractor_->bind(i, path);
+        LOG_DEBUG("Field " << name << " bound to JSON path " << path);
+    }
+}
+
+void Serializer::bindColumns() {
+    const avro::NodePtr& root = mapper_.root();
+    string value;
+
+    if (root->type() != avro::AVRO_RECORD) return;
+
+    if (directive("split.quote", value)) {
+        boost::trim(value);
+        splitter_->quote(value.empty() ? '\0' : value[0]);
+    }
+
+    if (directive("split.escape", value)) {
+        boost::trim(value);
+        splitter_->escape(value.empty() ? '\0' : value[0]);
+    }
+
+    if (splitter_->pairs()) {
+        for (size_t i = 0; i < root->names(); ++i) {
+            splitter_->bind(root->nameAt(i), i);
+        }
+    }
+    else if (directive("split.keys", value)) {
+        vector<string> keys;
+        boost::split(keys, value, boost::is_any_of(","));
+
+        for (size_t column = 0; column < keys.size(); ++column) {
+            string key = boost::trim_copy(keys[column]);
+            size_t index;
+
+            if (mapper_.fieldIndex(key, index)) {
+                splitter_->bind(column, index);
+                LOG_DEBUG("Column " << column << " bound to field " << key);
+            }
+            else if (key != "-") {
+                LOG_WARN("Unknown split key " << key << ", column " << column << " skipped");
+            }
+        }
+    }
+    else {
+        for (size_t i = 0; i < root->names(); ++i) {
+            splitter_->bind(i, i);
+        }
     }
 }
 
@@ -221,11 +523,25 @@ void Serializer::setMetadata(const string& key, const string& value) {
 }
 
 void Serializer::writeHeader(avro::EncoderPtr& e) {
+    writeHeader(e, sync_, AVRO_NULL_CODEC);
+}
+
+void Serializer::writeHeader(avro::EncoderPtr& e, const DataBlockSync& sync, const string& codec) {
     LOG_DEBUG("Write header");
 
     avro::encode(*e, magic);
-    avro::encode(*e, metadata_);
-    avro::encode(*e, sync_);
+
+    if (codec == AVRO_NULL_CODEC) {
+        avro::encode(*e, metadata_);
+    }
+    else {
+        Metadata metadata(metadata_);
+
+        metadata[AVRO_CODEC_KEY].assign(codec.begin(), codec.end());
+        avro::encode(*e, metadata);
+    }
+
+    avro::encode(*e, sync);
 
     e->flush();
 }
@@ -253,7 +569,35 @@ void Serializer::writeDataBlock(avro::EncoderPtr& e, const avro::GenericDatum& d
     e->flush();
 }
 
-boost::mt19937 random_generator(static_cast<uint32_t>(time(0)));
+void Serializer::writeBuffer(const string& buffer, avro::OutputStream& out) {
+    const char* p = buffer.data();
+    size_t remaining = buffer.length();
+
+    while (remaining > 0) {
+        uint8_t* chunk;
+        size_t length;
+
+        if (!out.next(&chunk, &length)) break;
+
+        size_t count = min(length, remaining);
+
+        memcpy(chunk, p, count);
+        p += count;
+        remaining -= count;
+
+        // Give back the part of the chunk not used
+        if (count < length) out.backup(length - count);
+    }
+
+    out.flush();
+}
+
+/**
+ * Sync markers generator, one per thread as the daemon workers serialize
+ * concurrently. The thread id tells apart threads seeded the same second.
+ */
+thread_local boost::mt19937 random_generator(static_cast<uint32_t>(time(0))
+    ^ static_cast<uint32_t>(hash<thread::id>()(this_thread::get_id())));
 
 DataBlockSync Serializer::makeSync() {
     DataBlockSync sync;
@@ -53,6 +53,11 @@
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/xpressive/xpressive.hpp>
 
+#include "BuiltinFormat.hh"
+#include "Enricher.hh"
+#include "FieldSplitter.hh"
+#include "JsonEncoder.hh"
+#include "JsonExtractor.hh"
 #include "Mapper.hh"
 
 typedef boost::array<uint8_t, 4> Magic;
@@ -65,6 +70,15 @@ typedef std::map<std::string, std::vector<uint8_t>> Metadata;
 class Serializer {
 public:
 
+    /**
+     * Message encodings, selected by the <b>output</b> directive.
+     */
+    enum Output {
+        AVRO, /**< Avro object container with a single record (default) */
+        JSON, /**< JSON object, one per message */
+        DATUM /**< Avro binary record alone, for sinks writing the container */
+    };
+
     Serializer();
     virtual ~Serializer();
 
@@ -91,6 +105,44 @@ public:
      */
     const std::string& configFilePath() const;
 
+    /**
+     * Return the schema mapper used for serialization.
+     */
+    Mapper& mapper();
+
+    /**
+     * Return a directive of the configuration file header, a
+     * <b>&lt;name&gt; : &lt;value&gt;</b> line before the schema (ej.
+     * <b>pattern</b>).
+     *
+     * @param[in] name the directive name
+     * @param[out] value the directive value, if present
+     * @return false if the directive is not present
+     */
+    bool directive(const std::string& name, std::string& value) const;
+
+    /**
+     * Set the message encoding.
+     */
+    void output(Output output);
+
+    /**
+     * Return the message encoding.
+     */
+    Output output() const;
+
+    /**
+     * Return whether entries can be mapped: a pattern, a built-in format, a
+     * split or a JSON input is configured.
+     */
+    bool ready() const;
+
+    /**
+     * Return whether the configuration file was read and its schema
+     * compiled. Otherwise the entries are sent raw.
+     */
+    bool loaded() const;
+
     /*-- methods --*/
 
     /**
@@ -108,6 +160,53 @@ public:
      */
     void serialize(const std::string& entry, std::auto_ptr<avro::OutputStream>& data);
 
+    /**
+     * Map a input text to a generic datum of the instance schema, without
+     * serializing it. The text is matched with the pattern, parsed by the
+     * <b>format</b> directive built-in parser (falling back to the pattern),
+     * split by the <b>split</b> directive delimiter or, if the <b>input</b>
+     * directive is <b>json</b>, parsed as a JSON object. The record is then
+     * enriched with the <b>enrich.networks</b> attributes, if any.
+     *
+     * @param[in] entry The input text to map
+     * @param[out] datum The datum to fill, built from #mapper()
+     */
+    void map(const std::string& entry, avro::GenericDatum& datum);
+
+    /**
+     * Serialize an already mapped datum.
+     *
+     * @param[in] datum The datum to serialize
+     * @param[out] data The output data buffer
+     */
+    void serialize(const avro::GenericDatum& datum, std::auto_ptr<avro::OutputStream>& data);
+
+    /**
+     * Map and serialize a input text in a single pass, without a datum, if
+     * a built-in format is configured, the schema is its record and the
+     * encoding is Avro. The output is the same as #map() and #serialize().
+     *
+     * @param[in] entry The input text to serialize
+     * @param[out] data The output data buffer
+     * @return false if the text must be mapped to a datum and serialized
+     */
+    bool encode(const std::string& entry, std::auto_ptr<avro::OutputStream>& data);
+
+    /**
+     * Write an Avro object container header: magic, metadata with the
+     * schema and codec, and sync marker.
+     *
+     * @param e the encoder to write to
+     * @param sync the container sync marker
+     * @param codec the blocks codec (<b>null</b> or <b>deflate</b>)
+     */
+    void writeHeader(avro::EncoderPtr& e, const DataBlockSync& sync, const std::string& codec);
+
+    /**
+     *  Calculate and return a Avro data block sync marker.
+     */
+    DataBlockSync makeSync();
+
 private:
 
     /*-- static fields --*/
@@ -137,6 +236,62 @@ private:
      */
     Mapper mapper_;
 
+    /**
+     * Configuration file header directives.
+     */
+    std::map<std::string, std::string> directives_;
+
+    /**
+     * Message encoding.
+     */
+    Output output_;
+
+    /**
+     * JSON encoder, reused between messages.
+     */
+    JsonEncoder json_;
+
+    /**
+     * JSON entries extractor, if the input is JSON instead of pattern
+     * matched text.
+     */
+    std::unique_ptr<JsonExtractor> extractor_;
+
+    /**
+     * Delimited entries splitter, if the entries are split instead of
+     * pattern matched.
+     */
+    std::unique_ptr<FieldSplitter> splitter_;
+
+    /**
+     * Built-in format parser, if the <b>format</b> directive names one.
+     */
+    std::unique_ptr<BuiltinFormat> format_;
+
+    /**
+     * Whether the schema is the built-in format record, so entries can be
+     * encoded without a datum.
+     */
+    bool direct_;
+
+    /**
+     * Whether the configuration file was read and its schema compiled.
+     */
+    bool loaded_;
+
+    /**
+     * Encoded magic and metadata, the fixed part of the message header,
+     * and the entries encoded without a datum.
+     */
+    std::vector<uint8_t> header_;
+    std::string buffer_;
+
+    /**
+     * Network attributes enrichment, if the <b>enrich.networks</b>
+     * directive names a networks file.
+     */
+    std::unique_ptr<Enricher> enricher_;
+
     /**
      * Avro data block sync marker.
      */
@@ -154,8 +309,36 @@ private:
      * stream.
      *
      * @param is the input stream to read.
+     * @return false if the schema is not valid, the entries are then sent
+     *         raw
+     */
+    bool loadMapper(std::istream &is);
+
+    /**
+     * Bind every record field to its <b>path.&lt;field&gt;</b> directive,
+     * or to the top level key of the same name.
+     */
+    void bindPaths();
+
+    /**
+     * Set the splitter quote and escape characters and bind the record
+     * fields to the <b>split.keys</b> columns, or to the columns in order,
+     * or to the keys of the same name in pairs mode.
+     */
+    void bindColumns();
+
+    /**
+     * Check whether the built-in format entries can be encoded without a
+     * datum and, if so, encode the fixed part of their message header.
+     */
+    void encodeHeader();
+
+    /**
+     * Open the <b>enrich.networks</b> file and bind the
+     * <b>enrich.field</b> address field (<b>host</b> by default) and the
+     * enriched fields.
      */
-    void loadMapper(std::istream &is);
+    void bindEnricher();
 
     /**
      * Write the Avro serialized message header.
@@ -167,6 +350,11 @@ private:
      */
     void writeDataBlock(avro::EncoderPtr& e, const avro::GenericDatum& datum, int64_t byteCount);
 
+    /**
+     * Copy an already encoded message to the output data buffer.
+     */
+    void writeBuffer(const std::string& buffer, avro::OutputStream& out);
+
     /**
      * Set an Avro metadata key-value pair.
      *
@@ -175,11 +363,6 @@ private:
      */
     void setMetadata(const std::string& key, const std::string& value);
 
-    /**
-     *  Calculate and return a Avro data block sync marker.
-     */
-    DataBlockSync makeSync();
-
     /**
      * Build a temporal file name for persistent the serialized message.
      * Used in trace mode for debugging purposes.
@@ -0,0 +1,50 @@
+/**
+ * @file Sink.cc
+ * @brief Message sink interface.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdexcept>
+
+#include "Sink.hh"
+
+using namespace std;
+
+/*-- constructors/destructor --*/
+
+Sink::~Sink() {
+}
+
+/*-- methods --*/
+
+void Sink::sendMessage(const string& message) {
+    Channel* channel = defaultChannel();
+
+    if (channel == NULL) {
+        throw invalid_argument("No target topic defined");
+    }
+
+    sendMessage(*channel, message);
+}
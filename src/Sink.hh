@@ -0,0 +1,134 @@
+/**
+ * @file Sink.hh
+ * @brief Message sink interface header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_SINK_HH_
+#define _LOG2KAFKA_SINK_HH_
+
+#include <string>
+
+#include "Channel.hh"
+
+/**
+ * Destination of the encoded entries.
+ *
+ * Entries are sent through channels, one per target topic and schema,
+ * which map and serialize them. The sink decides where the messages go:
+ * kafka (ClientFacade) or local files (FileSink).
+ */
+class Sink {
+public:
+
+    virtual ~Sink();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Return the channel for a topic and schema, creating it on first use.
+     *
+     * Not thread safe: channels must be requested from a single thread, but
+     * the returned channel can then be used from another one.
+     *
+     * @param topic the topic in <b>&lt;topic_name&gt;[:&lt;partition&gt;]</b>
+     *              format
+     * @param schema the schema configuration file path, or empty for raw mode
+     * @param format the format of the entries received
+     */
+    virtual Channel* channel(const std::string& topic, const std::string& schema,
+        Channel::Format format = Channel::LINE) = 0;
+
+    /**
+     * Return the channel of the topic given in the options, or NULL.
+     */
+    virtual Channel* defaultChannel() const = 0;
+
+    /*-- methods --*/
+
+    /**
+     * Prepare the sink. If a topic is given in the options, it becomes the
+     * default channel.
+     */
+    virtual void configure(const boost::program_options::variables_map& vm) = 0;
+
+    /**
+     * Get ready for the first messages of the channels created so far, up
+     * to the startup timeout, so they are not delayed by the connection
+     * setup. Schemas are already compiled when their channel is created.
+     *
+     * @return false if the sink is not ready after the timeout
+     */
+    virtual bool warmUp() = 0;
+
+    /**
+     * Wait for the pending messages to be written.
+     *
+     * @param timeout maximum time to wait, in milliseconds
+     * @return the messages still pending
+     */
+    virtual int flush(int timeout) = 0;
+
+    /**
+     * Serve the sink background work (ej. delivery reports).
+     *
+     * @param timeout maximum time to wait for events, in milliseconds
+     */
+    virtual void poll(int timeout) = 0;
+
+    /**
+     * Load the schema configuration of every channel again (see
+     * Channel::reload()). Safe to call from any thread.
+     *
+     * @return the channels whose configuration was not valid
+     */
+    virtual int reload() = 0;
+
+    /**
+     * Stop writing, flushing the pending messages.
+     *
+     * @return the messages lost
+     */
+    virtual int shutdown() = 0;
+
+    /**
+     * Send a message through the default channel.
+     *
+     * @param message the message to be sent
+     */
+    void sendMessage(const std::string& message);
+
+    /**
+     * Send a message through the given channel.
+     *
+     * @param channel the channel to use
+     * @param message the message to be sent
+     */
+    virtual void sendMessage(Channel& channel, const std::string& message) = 0;
+};
+
+#endif /* _LOG2KAFKA_SINK_HH_ */
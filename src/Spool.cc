@@ -0,0 +1,96 @@
+/**
+ * @file Spool.cc
+ * @brief Undelivered messages spool file class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "Spool.hh"
+
+using namespace std;
+
+/*-- constructors/destructor --*/
+
+Spool::Spool(const string& path) : path_(path), written_(0) {
+}
+
+Spool::~Spool() {
+}
+
+/*-- getters/setters --*/
+
+const string& Spool::path() const {
+    return path_;
+}
+
+uint64_t Spool::written() const {
+    lock_guard<mutex> lock(mutex_);
+    return written_;
+}
+
+/*-- methods --*/
+
+void Spool::write(const string& topic, int32_t partition, const void* key, size_t keyLength,
+    const void* payload, size_t length) {
+
+    lock_guard<mutex> lock(mutex_);
+
+    if (!file_.is_open()) {
+        file_.open(path_.c_str(), ios::out | ios::app | ios::binary);
+
+        if (!file_) {
+            throw runtime_error("Unable to open spool file " + path_ + ": " + strerror(errno));
+        }
+    }
+
+    file_ << topic << ' ' << partition << ' ' << keyLength << ' ' << length << '\n';
+    file_.write(static_cast<const char*>(key), keyLength);
+    file_.write(static_cast<const char*>(payload), length);
+    file_ << '\n';
+    file_.flush();
+
+    ++written_;
+}
+
+/*-- static methods --*/
+
+bool Spool::read(istream& is, SpoolRecord& record) {
+    size_t keyLength;
+    size_t length;
+
+    if (!(is >> record.topic >> record.partition >> keyLength >> length)) return false;
+    if (is.get() != '\n') return false;
+
+    record.key.resize(keyLength);
+    record.payload.resize(length);
+
+    if (keyLength > 0) is.read(&record.key[0], keyLength);
+    if (length > 0) is.read(&record.payload[0], length);
+
+    return is.get() == '\n';
+}
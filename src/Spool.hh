@@ -0,0 +1,123 @@
+/**
+ * @file Spool.hh
+ * @brief Undelivered messages spool file class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_SPOOL_HH_
+#define _LOG2KAFKA_SPOOL_HH_
+
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <string>
+
+/**
+ * A spooled message.
+ */
+struct SpoolRecord {
+    std::string topic;
+    int32_t partition;
+    std::string key;
+    std::string payload;
+};
+
+/**
+ * Local file keeping the messages that could not be delivered, to produce
+ * them again on the next start.
+ *
+ * Each record is a text header line followed by the raw key and payload:
+ *
+ * <b>&lt;topic&gt; &lt;partition&gt; &lt;key length&gt; &lt;payload length&gt;\\n&lt;key&gt;&lt;payload&gt;\\n</b>
+ */
+class Spool {
+public:
+
+    /**
+     * Class constructor. The file is created on the first write.
+     *
+     * @param path the spool file path
+     */
+    explicit Spool(const std::string& path);
+    virtual ~Spool();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Return the spool file path.
+     */
+    const std::string& path() const;
+
+    /**
+     * Return the messages written so far.
+     */
+    uint64_t written() const;
+
+    /*-- methods --*/
+
+    /**
+     * Append a message, flushed to the file before returning. Thread safe.
+     */
+    void write(const std::string& topic, int32_t partition, const void* key, size_t keyLength,
+        const void* payload, size_t length);
+
+    /*-- static methods --*/
+
+    /**
+     * Read the next record of a spool file.
+     *
+     * @return false at the end of the file, or on a truncated record
+     */
+    static bool read(std::istream& is, SpoolRecord& record);
+
+private:
+
+    /*-- fields --*/
+
+    /**
+     * Spool file path.
+     */
+    std::string path_;
+
+    /**
+     * Spool file, opened on the first write.
+     */
+    std::ofstream file_;
+
+    /**
+     * Messages written.
+     */
+    uint64_t written_;
+
+    /**
+     * Writes lock, messages fail in the kafka client threads.
+     */
+    mutable std::mutex mutex_;
+};
+
+#endif /* _LOG2KAFKA_SPOOL_HH_ */
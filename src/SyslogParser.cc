@@ -0,0 +1,204 @@
+/**
+ * @file SyslogParser.cc
+ * @brief Syslog envelope parser class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cctype>
+#include <cstring>
+
+#include "SyslogParser.hh"
+
+using namespace std;
+
+/*-- static fields --*/
+
+const char* const SyslogMessage::FIELD_NAMES[SyslogMessage::FIELD_COUNT] = {
+    "facility",
+    "severity",
+    "timestamp",
+    "hostname",
+    "appName",
+    "procId",
+    "msgId",
+    "structuredData"
+};
+
+/**
+ * Return the end of the token starting at begin (next space or end).
+ */
+static const char* tokenEnd(const char* begin, const char* end) {
+    const char* space = static_cast<const char*>(memchr(begin, ' ', end - begin));
+    return space != NULL ? space : end;
+}
+
+/**
+ * Assign an RFC 5424 header token, leaving NILVALUE fields empty.
+ */
+static void assignToken(string& field, const char* begin, const char* end) {
+
+    if (end - begin == 1 && *begin == '-') {
+        field.clear();
+    }
+    else {
+        field.assign(begin, end);
+    }
+}
+
+/*-- static methods --*/
+
+bool SyslogParser::parse(const string& frame, SyslogMessage& message) {
+    const char* p = frame.data();
+    const char* end = p + frame.length();
+
+    // Trailing new lines and NULs some senders append to datagrams
+    while (end > p && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == '\0')) --end;
+
+    /* PRI: <0..191> */
+
+    if (p == end || *p != '<') return false;
+
+    int priority = 0;
+    const char* digits = ++p;
+
+    while (p < end && isdigit(*p) && p - digits < 3) {
+        priority = priority * 10 + (*p++ - '0');
+    }
+
+    if (p == digits || p == end || *p != '>' || priority > 191) return false;
+
+    ++p;
+
+    message.fields[SyslogMessage::FACILITY] = to_string(priority / 8);
+    message.fields[SyslogMessage::SEVERITY] = to_string(priority % 8);
+
+    /* RFC 5424 frames go on with a version number */
+
+    if (p < end && isdigit(*p) && p + 1 < end && p[1] == ' ') {
+        return parse5424(p + 2, end, message);
+    }
+
+    parse3164(p, end, message);
+    return true;
+}
+
+bool SyslogParser::parse5424(const char* p, const char* end, SyslogMessage& message) {
+
+    /* TIMESTAMP HOSTNAME APP-NAME PROCID MSGID */
+
+    for (int field = SyslogMessage::TIMESTAMP; field <= SyslogMessage::MSG_ID; ++field) {
+        if (p >= end) return false;
+
+        const char* last = tokenEnd(p, end);
+        assignToken(message.fields[field], p, last);
+        p = last < end ? last + 1 : end;
+    }
+
+    /* STRUCTURED-DATA: "-" or one or more [...] elements */
+
+    string& data = message.fields[SyslogMessage::STRUCTURED_DATA];
+
+    if (p >= end) {
+        data.clear();
+    }
+    else if (*p == '-') {
+        data.clear();
+        ++p;
+    }
+    else {
+        const char* begin = p;
+
+        while (p < end && *p == '[') {
+            // Skip to the closing bracket, honoring \] escapes
+            for (++p; p < end && *p != ']'; ++p) {
+                if (*p == '\\' && p + 1 < end) ++p;
+            }
+
+            if (p < end) ++p;
+        }
+
+        data.assign(begin, p);
+    }
+
+    /* MSG, possibly with a UTF-8 BOM */
+
+    if (p < end && *p == ' ') ++p;
+
+    if (end - p >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0) p += 3;
+
+    message.body.assign(p, end > p ? end : p);
+
+    return true;
+}
+
+void SyslogParser::parse3164(const char* p, const char* end, SyslogMessage& message) {
+
+    for (int field = SyslogMessage::TIMESTAMP; field < SyslogMessage::FIELD_COUNT; ++field) {
+        message.fields[field].clear();
+    }
+
+    /* TIMESTAMP: Mmm dd hh:mm:ss, then HOSTNAME. Both are optional in
+     * practice, lots of senders skip them. */
+
+    if (end - p > 16 && p[3] == ' ' && p[6] == ' ' && p[9] == ':' && p[12] == ':' && p[15] == ' ') {
+        message.fields[SyslogMessage::TIMESTAMP].assign(p, 15);
+        p += 16;
+
+        const char* last = tokenEnd(p, end);
+
+        // A token ending in ':' is already the tag
+        if (last < end && last[-1] != ':') {
+            message.fields[SyslogMessage::HOSTNAME].assign(p, last);
+            p = last + 1;
+        }
+    }
+
+    /* TAG[PID]: */
+
+    const char* tag = p;
+
+    while (p < end && (isalnum(*p) || *p == '-' || *p == '_' || *p == '.' || *p == '/')) ++p;
+
+    if (p > tag && p < end && (*p == '[' || *p == ':')) {
+        message.fields[SyslogMessage::APP_NAME].assign(tag, p);
+
+        if (*p == '[') {
+            const char* pid = ++p;
+            while (p < end && *p != ']') ++p;
+
+            message.fields[SyslogMessage::PROC_ID].assign(pid, p);
+
+            if (p < end) ++p;
+        }
+
+        if (p < end && *p == ':') ++p;
+        if (p < end && *p == ' ') ++p;
+    }
+    else {
+        p = tag; // no tag, all of it is the message
+    }
+
+    message.body.assign(p, end);
+}
@@ -0,0 +1,116 @@
+/**
+ * @file SyslogParser.hh
+ * @brief Syslog envelope parser class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#ifndef _LOG2KAFKA_SYSLOG_PARSER_HH_
+#define _LOG2KAFKA_SYSLOG_PARSER_HH_
+
+#include <cstddef>
+#include <string>
+
+/**
+ * A syslog message split into its envelope fields and body.
+ *
+ * Absent fields (ej. the NILVALUE "-" of RFC 5424) are left empty.
+ */
+struct SyslogMessage {
+
+    /**
+     * Envelope fields.
+     */
+    enum Field {
+        FACILITY,
+        SEVERITY,
+        TIMESTAMP,
+        HOSTNAME,
+        APP_NAME,
+        PROC_ID,
+        MSG_ID,
+        STRUCTURED_DATA,
+        FIELD_COUNT
+    };
+
+    /**
+     * Record field names receiving the envelope fields, when defined in the
+     * schema.
+     */
+    static const char* const FIELD_NAMES[FIELD_COUNT];
+
+    /**
+     * Envelope field values.
+     */
+    std::string fields[FIELD_COUNT];
+
+    /**
+     * The message body (MSG part).
+     */
+    std::string body;
+};
+
+/**
+ * Syslog envelope parser.
+ *
+ * Accepts both the RFC 5424 format:
+ *
+ * <b>&lt;PRI&gt;1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID STRUCTURED-DATA MSG</b>
+ *
+ * and the older BSD (RFC 3164) format:
+ *
+ * <b>&lt;PRI&gt;Mmm dd hh:mm:ss HOSTNAME TAG[PID]: MSG</b>
+ */
+class SyslogParser {
+public:
+
+    /*-- static methods --*/
+
+    /**
+     * Parse a syslog frame.
+     *
+     * @param[in] frame the frame, without transport framing
+     * @param[out] message the parsed message
+     * @return false if the frame has no valid priority header
+     */
+    static bool parse(const std::string& frame, SyslogMessage& message);
+
+private:
+
+    /*-- static methods --*/
+
+    /**
+     * Parse the remainder of an RFC 5424 frame, after the version.
+     */
+    static bool parse5424(const char* begin, const char* end, SyslogMessage& message);
+
+    /**
+     * Parse the remainder of an RFC 3164 frame, after the priority.
+     */
+    static void parse3164(const char* begin, const char* end, SyslogMessage& message);
+};
+
+#endif /* _LOG2KAFKA_SYSLOG_PARSER_HH_ */
@@ -0,0 +1,197 @@
+/**
+ * @file Throttle.cc
+ * @brief Per topic flow control class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Throttle.hh"
+
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+LoggerPtr Throttle::logger(Logger::getLogger("Throttle"));
+#endif
+
+/*-- constructors/destructor --*/
+
+Throttle::Throttle() :
+    rate_(0), burst_(0), tokens_(0), refilled_(Clock::now()),
+    samplingThreshold_(0), samplingRate_(Constants::DEFAULT_SAMPLING_RATE), sampling_(false),
+    windowStart_(refilled_), windowCount_(0), sampleSequence_(0),
+    samplingField_(Constants::DEFAULT_SAMPLING_FIELD),
+    keepField_(Constants::DEFAULT_SAMPLING_KEEP_FIELD),
+    keepMinimum_(Constants::DEFAULT_SAMPLING_KEEP_MINIMUM),
+    samplingFieldIndex_(0), keepFieldIndex_(0), hasSamplingField_(false), hasKeepField_(false),
+    limited_(0), discarded_(0) {
+}
+
+Throttle::~Throttle() {
+    if (limited_ > 0 || discarded_ > 0) {
+        LOG_INFO("Lines dropped by rate limit: " << limited_
+            << ", discarded by sampling: " << discarded_);
+    }
+}
+
+/*-- getters/setters --*/
+
+void Throttle::rate(int rate) {
+    rate_ = max(rate, 0);
+    if (burst_ == 0) burst(rate_);
+}
+
+void Throttle::burst(int burst) {
+    burst_ = max(burst, 1);
+    tokens_ = burst_;
+}
+
+void Throttle::samplingThreshold(int threshold) {
+    samplingThreshold_ = max(threshold, 0);
+}
+
+void Throttle::samplingRate(int samplingRate) {
+    samplingRate_ = max(samplingRate, 1);
+}
+
+void Throttle::samplingField(const string& fieldName) {
+    samplingField_ = fieldName;
+}
+
+void Throttle::keepField(const string& fieldName, int minimum) {
+    keepField_ = fieldName;
+    keepMinimum_ = minimum;
+}
+
+int Throttle::currentSampleRate() const {
+    return sampling_ ? samplingRate_ : 1;
+}
+
+/*-- methods --*/
+
+void Throttle::bind(const Mapper& mapper) {
+    hasSamplingField_ = mapper.fieldIndex(samplingField_, samplingFieldIndex_);
+    hasKeepField_ = mapper.fieldIndex(keepField_, keepFieldIndex_);
+
+    if (samplingThreshold_ > 0 && !hasKeepField_) {
+        LOG_WARN("Sampling keep field '" << keepField_ << "' not found in schema."
+            << " No line will be exempted from sampling");
+    }
+}
+
+bool Throttle::acquire() {
+    Clock::time_point now = Clock::now();
+
+    updateWindow(now);
+
+    if (rate_ == 0) return true;
+
+    double elapsed = chrono::duration<double>(now - refilled_).count();
+    refilled_ = now;
+    tokens_ = min(tokens_ + elapsed * rate_, static_cast<double>(burst_));
+
+    if (tokens_ < 1) return false;
+
+    tokens_ -= 1;
+    return true;
+}
+
+bool Throttle::sample() {
+
+    if (!sampling_) return true;
+
+    if (++sampleSequence_ >= samplingRate_) {
+        sampleSequence_ = 0;
+        return true;
+    }
+
+    return false;
+}
+
+bool Throttle::keep(const avro::GenericDatum& datum) const {
+
+    if (!hasKeepField_ || datum.type() != avro::AVRO_RECORD) return false;
+
+    const avro::GenericDatum& field =
+        datum.value<avro::GenericRecord>().fieldAt(keepFieldIndex_);
+
+    switch (field.type()) {
+    case avro::AVRO_INT:
+        return field.value<int32_t>() >= keepMinimum_;
+
+    case avro::AVRO_LONG:
+        return field.value<int64_t>() >= keepMinimum_;
+
+    case avro::AVRO_STRING:
+        return atoi(field.value<string>().c_str()) >= keepMinimum_;
+
+    default:
+        return false;
+    }
+}
+
+void Throttle::record(const Mapper& mapper, avro::GenericDatum& datum) const {
+
+    if (hasSamplingField_) {
+        mapper.assign(datum, samplingFieldIndex_, to_string(currentSampleRate()));
+    }
+}
+
+bool Throttle::records() const {
+    return hasSamplingField_;
+}
+
+void Throttle::limit() {
+    ++limited_;
+}
+
+void Throttle::discard() {
+    ++discarded_;
+}
+
+void Throttle::updateWindow(const Clock::time_point& now) {
+    ++windowCount_;
+
+    if (samplingThreshold_ == 0 || now - windowStart_ < chrono::seconds(1)) return;
+
+    double seconds = chrono::duration<double>(now - windowStart_).count();
+    bool exceeded = (windowCount_ / seconds) > samplingThreshold_;
+
+    if (exceeded != sampling_) {
+        if (exceeded) {
+            LOG_WARN("Input rate " << static_cast<int64_t>(windowCount_ / seconds)
+                << " lines/s over threshold. Sampling 1 in " << samplingRate_);
+        }
+        else {
+            LOG_WARN("Input rate back under threshold. Sampling disabled ("
+                << discarded_ << " lines discarded so far)");
+        }
+
+        sampling_ = exceeded;
+        sampleSequence_ = 0;
+    }
+
+    windowStart_ = now;
+    windowCount_ = 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * @file Throttle.hh
+ * @brief Per topic flow control class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifndef _LOG2KAFKA_THROTTLE_HH_
+#define _LOG2KAFKA_THROTTLE_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#include "Mapper.hh"
+
+/**
+ * Per topic flow control: token bucket rate limiting plus adaptive 1-in-N
+ * sampling.
+ *
+ * The token bucket is a hard cap on the lines accepted per second. The
+ * sampler measures the input rate over one second windows and, while the
+ * last window exceeded the configured threshold, lets only one of every N
+ * lines through. Lines whose keep field (by default the HTTP status) is
+ * equal or above the configured minimum are never sampled out. The rate
+ * limit applies to every line, before it is mapped.
+ */
+class Throttle {
+public:
+
+    Throttle();
+    virtual ~Throttle();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Set the token bucket rate in lines per second (0 disables it).
+     */
+    void rate(int rate);
+
+    /**
+     * Set the token bucket capacity (defaults to one second of #rate()).
+     */
+    void burst(int burst);
+
+    /**
+     * Set the input rate, in lines per second, above which sampling is
+     * enabled (0 disables sampling).
+     */
+    void samplingThreshold(int threshold);
+
+    /**
+     * Set the N of the 1-in-N sampling.
+     */
+    void samplingRate(int samplingRate);
+
+    /**
+     * Set the name of the record field that receives the sample rate.
+     */
+    void samplingField(const std::string& fieldName);
+
+    /**
+     * Set the name of the record field checked to keep a sampled line, and
+     * the minimum numeric value that keeps it.
+     */
+    void keepField(const std::string& fieldName, int minimum);
+
+    /**
+     * Return the sample rate that applies to the current line: 1 when
+     * sampling is not active.
+     */
+    int currentSampleRate() const;
+
+    /*-- methods --*/
+
+    /**
+     * Resolve the configured field names against the mapper schema.
+     */
+    void bind(const Mapper& mapper);
+
+    /**
+     * Account for a new input line and take a token from the bucket.
+     *
+     * @return false if the line exceeds the rate limit and must be dropped
+     */
+    bool acquire();
+
+    /**
+     * Decide whether the current line is passed by the sampler.
+     *
+     * Must be called once per line acquired.
+     */
+    bool sample();
+
+    /**
+     * Check if a mapped datum must be kept regardless of sampling.
+     */
+    bool keep(const avro::GenericDatum& datum) const;
+
+    /**
+     * Record the sample rate in the mapped datum, if the schema defines the
+     * sampling field.
+     */
+    void record(const Mapper& mapper, avro::GenericDatum& datum) const;
+
+    /**
+     * Return true if #record() sets a field, so the lines need a datum.
+     */
+    bool records() const;
+
+    /**
+     * Account for a line dropped by the rate limit.
+     */
+    void limit();
+
+    /**
+     * Account for a line discarded by the sampler.
+     */
+    void discard();
+
+private:
+
+    typedef std::chrono::steady_clock Clock;
+
+    /*-- static fields --*/
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+    /**
+     * Class logger.
+     */
+    static log4cxx::LoggerPtr logger;
+#endif
+
+    /*-- fields --*/
+
+    /**
+     * Token bucket refill rate in lines per second.
+     */
+    int rate_;
+
+    /**
+     * Token bucket capacity.
+     */
+    int burst_;
+
+    /**
+     * Tokens currently available.
+     */
+    double tokens_;
+
+    /**
+     * Last token bucket refill time.
+     */
+    Clock::time_point refilled_;
+
+    /**
+     * Input rate that enables sampling.
+     */
+    int samplingThreshold_;
+
+    /**
+     * The N of 1-in-N sampling.
+     */
+    int samplingRate_;
+
+    /**
+     * Whether the last measuring window exceeded the threshold.
+     */
+    bool sampling_;
+
+    /**
+     * Start of the current measuring window.
+     */
+    Clock::time_point windowStart_;
+
+    /**
+     * Lines received during the current measuring window.
+     */
+    int64_t windowCount_;
+
+    /**
+     * Position of the current line in the 1-in-N sequence.
+     */
+    int sampleSequence_;
+
+    /**
+     * Record field names and their resolved positions.
+     */
+    std::string samplingField_;
+    std::string keepField_;
+    int keepMinimum_;
+    size_t samplingFieldIndex_;
+    size_t keepFieldIndex_;
+    bool hasSamplingField_;
+    bool hasKeepField_;
+
+    /**
+     * Lines dropped by the token bucket and discarded by the sampler.
+     */
+    int64_t limited_;
+    int64_t discarded_;
+
+    /*-- methods --*/
+
+    /**
+     * Close the measuring window if a second has elapsed and update the
+     * sampling state.
+     */
+    void updateWindow(const Clock::time_point& now);
+};
+
+#endif /* _LOG2KAFKA_THROTTLE_HH_ */
@@ -25,6 +25,19 @@
  * limitations under the License.
  */
 
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <boost/lexical_cast.hpp>
+
 #include "Util.hh"
 
 using namespace std;
@@ -55,7 +68,8 @@ path Util::getTempDirectoryPath() {
 
     return p;
 
-#   else  // Windows    std::vector<path::value_type> buf(GetTempPathW(0, NULL));
+#   else  // Windows
+    std::vector<path::value_type> buf(GetTempPathW(0, NULL));
 
     if (buf.empty() || GetTempPathW(buf.size(), &buf[0]) == 0) {
         if(!buf.empty()) ::SetLastError(ENOTDIR);
@@ -77,3 +91,103 @@ path Util::getTempDirectoryPath() {
     return p;
 #   endif
 }
+
+int Util::listenInet(const string& endpoint, int type) {
+
+    /* Split [<address>:]<port>, the address possibly a bracketed IPv6 one */
+
+    string host;
+    string port = endpoint;
+    size_t colon = endpoint.rfind(':');
+    size_t bracket = endpoint.rfind(']');
+
+    if (colon != string::npos && (bracket == string::npos || bracket < colon)) {
+        host = endpoint.substr(0, colon);
+        port = endpoint.substr(colon + 1);
+    }
+
+    if (host.length() > 1 && host[0] == '[' && host[host.length() - 1] == ']') {
+        host = host.substr(1, host.length() - 2);
+    }
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = type;
+    hints.ai_flags = AI_PASSIVE;
+
+    addrinfo* addresses;
+    int error = getaddrinfo(host.empty() ? NULL : host.c_str(), port.c_str(), &hints, &addresses);
+
+    if (error != 0) {
+        throw invalid_argument("Invalid address '" + endpoint + "': " + gai_strerror(error));
+    }
+
+    int fd = socket(addresses->ai_family, addresses->ai_socktype | SOCK_NONBLOCK, 0);
+    int reuse = 1;
+
+    if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if (fd < 0
+        || bind(fd, addresses->ai_addr, addresses->ai_addrlen) < 0
+        || (type == SOCK_STREAM && listen(fd, SOMAXCONN) < 0)) {
+
+        int cause = errno;
+
+        if (fd >= 0) close(fd);
+        freeaddrinfo(addresses);
+        throw system_error(cause, system_category(), "Unable to listen on " + endpoint);
+    }
+
+    freeaddrinfo(addresses);
+
+    return fd;
+}
+
+cpu_set_t Util::cpuSet(const string& list) {
+    cpu_set_t cpus;
+    vector<string> ranges;
+
+    CPU_ZERO(&cpus);
+    boost::split(ranges, list, boost::is_any_of(","));
+
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        string range = boost::trim_copy(ranges[i]);
+        size_t dash = range.find('-');
+        int first;
+        int last;
+
+        try {
+            first = boost::lexical_cast<int>(range.substr(0, dash));
+            last = dash == string::npos ? first : boost::lexical_cast<int>(range.substr(dash + 1));
+        }
+        catch (const boost::bad_lexical_cast&) {
+            throw invalid_argument("Invalid CPU list '" + list + "'. Expected: ej. 0-3,8");
+        }
+
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            throw invalid_argument("Invalid CPU range '" + range + "' in '" + list + "'");
+        }
+
+        for (int cpu = first; cpu <= last; ++cpu) CPU_SET(cpu, &cpus);
+    }
+
+    return cpus;
+}
+
+cpu_set_t Util::threadCpus() {
+    cpu_set_t cpus;
+
+    CPU_ZERO(&cpus);
+    pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    return cpus;
+}
+
+void Util::pinThread(const cpu_set_t& cpus) {
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    if (error != 0) {
+        LOG_WARN("Unable to set the thread CPU affinity: " << strerror(error));
+    }
+}
@@ -30,6 +30,8 @@
 #ifndef _LOG2KAFKA_UTIL_HH_
 #define _LOG2KAFKA_UTIL_HH_
 
+#include <sched.h>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 
@@ -47,6 +49,37 @@ public:
      */
     static boost::filesystem::path getTempDirectoryPath();
 
+    /**
+     * Open a non blocking socket bound to an inet address, listening if it
+     * is a stream socket.
+     *
+     * @param endpoint the address as <b>[&lt;address&gt;:]&lt;port&gt;</b>,
+     *                 using brackets for IPv6 addresses
+     * @param type SOCK_DGRAM or SOCK_STREAM
+     * @return the socket descriptor
+     * @throw system_error if the socket cannot be bound
+     */
+    static int listenInet(const std::string& endpoint, int type);
+
+    /**
+     * Parse a CPU list, ej. <b>0-3,8</b>.
+     *
+     * @throw invalid_argument if the list is not valid
+     */
+    static cpu_set_t cpuSet(const std::string& list);
+
+    /**
+     * Return the CPUs the calling thread may run on.
+     */
+    static cpu_set_t threadCpus();
+
+    /**
+     * Restrict the calling thread to a set of CPUs. The threads it creates
+     * inherit them, and the memory it touches first is allocated on their
+     * NUMA node. Failures are logged.
+     */
+    static void pinThread(const cpu_set_t& cpus);
+
 private:
 
     /*-- static fields --*/
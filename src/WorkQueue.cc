@@ -0,0 +1,167 @@
+/**
+ * @file WorkQueue.cc
+ * @brief Bounded entries queue class.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iterator>
+
+#include "MemoryBudget.hh"
+#include "Metrics.hh"
+#include "WorkQueue.hh"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Wait for the memory budget between two admission attempts, in ms.
+ */
+const int BUDGET_WAIT = 10;
+
+/**
+ * Memory held by a queued entry.
+ */
+inline size_t footprint(const WorkItem& item) {
+    return sizeof(WorkItem) + item.entry.capacity();
+}
+
+} // namespace
+
+/*-- constructors/destructor --*/
+
+WorkQueue::WorkQueue(size_t capacity, Backpressure backpressure) :
+    capacity_(capacity), backpressure_(backpressure), closed_(false), dropped_(0), bytes_(0) {
+}
+
+WorkQueue::~WorkQueue() {
+    MemoryBudget::release(MemoryBudget::QUEUE, bytes_);
+}
+
+/*-- getters/setters --*/
+
+int64_t WorkQueue::dropped() const {
+    lock_guard<mutex> lock(mutex_);
+    return dropped_;
+}
+
+/*-- methods --*/
+
+bool WorkQueue::push(vector<WorkItem>& batch) {
+    size_t bytes = 0;
+
+    // Waiting for the budget out of the lock, so the worker keeps popping
+    if (backpressure_ == BLOCK) {
+        for (size_t i = 0; i < batch.size(); ++i) bytes += footprint(batch[i]);
+
+        while (!MemoryBudget::acquire(MemoryBudget::QUEUE, bytes)) {
+            {
+                lock_guard<mutex> lock(mutex_);
+                if (closed_) return false;
+            }
+
+            MemoryBudget::wait(BUDGET_WAIT);
+        }
+    }
+
+    unique_lock<mutex> lock(mutex_);
+
+    if (backpressure_ == BLOCK) {
+        notFull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+    }
+
+    if (closed_) {
+        if (backpressure_ == BLOCK) MemoryBudget::release(MemoryBudget::QUEUE, bytes);
+        return false;
+    }
+
+    size_t room = capacity_ > items_.size() ? capacity_ - items_.size() : 0;
+
+    if (batch.size() > room) {
+        // Only possible with DROP, or with BLOCK and a batch over capacity
+        if (backpressure_ == DROP) {
+            dropped_ += batch.size() - room;
+            Metrics::count(Metrics::ENTRIES_DROPPED, batch.size() - room);
+            batch.resize(room);
+        }
+    }
+
+    if (backpressure_ == DROP) {
+        size_t kept = 0;
+
+        // Keep the entries that fit in the budget
+        for (; kept < batch.size(); ++kept) {
+            size_t size = footprint(batch[kept]);
+
+            if (!MemoryBudget::acquire(MemoryBudget::QUEUE, size)) break;
+
+            bytes += size;
+        }
+
+        if (kept < batch.size()) {
+            Metrics::count(Metrics::ENTRIES_OVER_BUDGET, batch.size() - kept);
+            batch.resize(kept);
+        }
+    }
+
+    bytes_ += bytes;
+
+    items_.insert(items_.end(), make_move_iterator(batch.begin()),
+        make_move_iterator(batch.end()));
+    batch.clear();
+
+    lock.unlock();
+    notEmpty_.notify_one();
+
+    return true;
+}
+
+bool WorkQueue::pop(vector<WorkItem>& batch) {
+    unique_lock<mutex> lock(mutex_);
+
+    notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+
+    if (items_.empty()) return false;
+
+    batch.swap(items_);
+    items_.clear();
+
+    MemoryBudget::release(MemoryBudget::QUEUE, bytes_);
+    bytes_ = 0;
+
+    lock.unlock();
+    notFull_.notify_one();
+
+    return true;
+}
+
+void WorkQueue::close() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        closed_ = true;
+    }
+
+    notEmpty_.notify_all();
+    notFull_.notify_all();
+}
@@ -0,0 +1,148 @@
+/**
+ * @file WorkQueue.hh
+ * @brief Bounded entries queue class header.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifndef _LOG2KAFKA_WORK_QUEUE_HH_
+#define _LOG2KAFKA_WORK_QUEUE_HH_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Channel;
+
+/**
+ * An entry waiting to be sent, with the channel it belongs to.
+ */
+struct WorkItem {
+    Channel* channel;
+    std::string entry;
+};
+
+/**
+ * Bounded queue of entries between the input reader and a worker thread.
+ *
+ * Entries are moved in and out in batches, so the lock is taken once per
+ * read buffer and not once per entry.
+ *
+ * Queued entries are charged to the queue stage of the MemoryBudget, and
+ * the backpressure behavior also applies when it is reached.
+ */
+class WorkQueue {
+public:
+
+    /**
+     * Behavior when the queue is full.
+     */
+    enum Backpressure {
+        BLOCK, /**< wait for the worker or the budget, which blocks the log writers */
+        DROP   /**< discard the entries that do not fit */
+    };
+
+    /**
+     * Class constructor.
+     *
+     * @param capacity maximum entries queued
+     * @param backpressure behavior when the queue is full
+     */
+    WorkQueue(size_t capacity, Backpressure backpressure);
+    virtual ~WorkQueue();
+
+    /*-- getters/setters --*/
+
+    /**
+     * Return the entries discarded because the queue was full.
+     */
+    int64_t dropped() const;
+
+    /*-- methods --*/
+
+    /**
+     * Move a batch of entries to the queue. The batch is left empty.
+     *
+     * @return false if the queue is closed
+     */
+    bool push(std::vector<WorkItem>& batch);
+
+    /**
+     * Move all the queued entries to the batch, waiting for some if empty.
+     *
+     * @return false if the queue is closed and fully drained
+     */
+    bool pop(std::vector<WorkItem>& batch);
+
+    /**
+     * Close the queue. Already queued entries can still be popped.
+     */
+    void close();
+
+private:
+
+    /*-- fields --*/
+
+    /**
+     * Maximum entries queued.
+     */
+    size_t capacity_;
+
+    /**
+     * Behavior when the queue is full.
+     */
+    Backpressure backpressure_;
+
+    /**
+     * Queued entries.
+     */
+    std::vector<WorkItem> items_;
+
+    /**
+     * Whether the queue was closed.
+     */
+    bool closed_;
+
+    /**
+     * Entries discarded because the queue was full.
+     */
+    int64_t dropped_;
+
+    /**
+     * Bytes of the queued entries charged to the memory budget.
+     */
+    size_t bytes_;
+
+    /**
+     * Queue state lock and conditions.
+     */
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+};
+
+#endif /* _LOG2KAFKA_WORK_QUEUE_HH_ */
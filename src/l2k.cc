@@ -0,0 +1,157 @@
+/**
+ * @file l2k.cc
+ * @brief Embedded log2kafka C API.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstring>
+#include <memory>
+
+#include "ClientFacade.hh"
+#include "MemoryBudget.hh"
+#include "MetricsServer.hh"
+#include "Options.hh"
+#include "l2k.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+#ifdef _LOG2KAFKA_USE_LOG4CXX_
+using namespace log4cxx;
+
+static LoggerPtr logger(Logger::getLogger("l2k"));
+#endif
+
+/**
+ * Producer handle.
+ */
+struct l2k_s {
+    unique_ptr<ClientFacade> facade;
+    unique_ptr<MetricsServer> metrics;
+};
+
+/**
+ * Copy an error description to the caller buffer.
+ */
+static void setError(char* errstr, size_t errstr_size, const char* error) {
+
+    if (errstr == NULL || errstr_size == 0) return;
+
+    strncpy(errstr, error, errstr_size - 1);
+    errstr[errstr_size - 1] = '\0';
+}
+
+l2k_t* l2k_open(int argc, const char* const* argv, char* errstr, size_t errstr_size) {
+
+    try {
+        po::variables_map vm;
+
+        // parse_command_line() skips the program name
+        vector<const char*> arguments(argv, argv + argc);
+        arguments.insert(arguments.begin(), BUILD_NAME);
+
+        Options::parseCommandLine(arguments.size(), &arguments[0], vm);
+        Options::parseConfigFile(vm);
+        Options::validate(vm);
+        po::notify(vm);
+
+        if (vm.count("daemon") || vm.count("connect")) {
+            throw invalid_argument("'daemon' and 'connect' arguments are not supported embedded.");
+        }
+
+#ifndef _LOG2KAFKA_USE_LOG4CXX_
+        if (vm.count("verbose")) {
+            Constants::LOG_VERBOSITY = true;
+            Constants::IS_TRACE_ENABLED = true;
+            Constants::IS_DEBUG_ENABLED = true;
+        }
+#endif
+
+        MemoryBudget::limit(size_t(vm["memory.budget"].as<int>()) << 20);
+
+        unique_ptr<l2k_t> handle(new l2k_t());
+        handle->facade.reset(new ClientFacade());
+        handle->facade->configure(vm);
+        handle->facade->warmUp();
+
+        if (vm.count("metrics.listen")) {
+            handle->metrics.reset(new MetricsServer());
+            handle->metrics->configure(vm);
+        }
+
+        return handle.release();
+    }
+    catch (exception& e) {
+        setError(errstr, errstr_size, e.what());
+    }
+    catch (...) {
+        setError(errstr, errstr_size, "Unexpected exception");
+    }
+
+    return NULL;
+}
+
+int l2k_send(l2k_t* handle, const char* buf, size_t len) {
+
+    int count = 0;
+
+    try {
+        const char* end = buf + len;
+        string entry;
+
+        while (buf < end) {
+            const char* newline = static_cast<const char*>(memchr(buf, '\n', end - buf));
+            const char* last = newline != NULL ? newline : end;
+
+            entry.assign(buf, last - buf);
+            handle->facade->sendMessage(entry);
+
+            ++count;
+            buf = last + 1;
+        }
+    }
+    catch (exception& e) {
+        LOG_ERROR("Unexpected exception: " << e.what());
+        return -1;
+    }
+    catch (...) {
+        LOG_ERROR("Unexpected exception ");
+        return -1;
+    }
+
+    return count;
+}
+
+int l2k_flush(l2k_t* handle, int timeout_ms) {
+    return handle->facade->flush(timeout_ms);
+}
+
+int l2k_reload(l2k_t* handle) {
+    return handle->facade->reload() == 0 ? 0 : -1;
+}
+
+void l2k_close(l2k_t* handle) {
+    delete handle;
+}
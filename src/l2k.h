@@ -0,0 +1,110 @@
+/**
+ * @file l2k.h
+ * @brief Embedded log2kafka C API.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _LOG2KAFKA_L2K_H_
+#define _LOG2KAFKA_L2K_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * An embedded producer: the same mapping, serialization and flow control
+ * of the log2kafka command, running inside the calling process.
+ *
+ * A handle is not thread safe. Applications sending from several threads
+ * should open one handle per thread, or serialize the calls.
+ */
+typedef struct l2k_s l2k_t;
+
+/**
+ * Create a producer.
+ *
+ * The arguments are the same accepted by the log2kafka command (without
+ * the program name), ej. <b>{ "-b", "broker:9092", "-t", "topic", "-s",
+ * "apache-combined.conf" }</b>, including <b>--config</b> files. A target
+ * topic is required. With <b>--startup.timeout</b>, waits up to that many
+ * milliseconds for the topic metadata before returning.
+ *
+ * @param argc the arguments count
+ * @param argv the arguments
+ * @param errstr buffer receiving the error description on failure
+ * @param errstr_size the error buffer size
+ * @return the producer handle, or NULL on failure
+ */
+l2k_t* l2k_open(int argc, const char* const* argv, char* errstr, size_t errstr_size);
+
+/**
+ * Map, serialize and queue the log entries in a buffer.
+ *
+ * Entries are separated by new lines. A last entry without a trailing new
+ * line is sent too. Messages are batched by the kafka client; call
+ * l2k_flush() to wait for their delivery.
+ *
+ * @param handle the producer handle
+ * @param buf the entries
+ * @param len the buffer length
+ * @return the entries queued, or -1 on failure (see the log)
+ */
+int l2k_send(l2k_t* handle, const char* buf, size_t len);
+
+/**
+ * Wait for the queued messages to be delivered.
+ *
+ * @param handle the producer handle
+ * @param timeout_ms maximum time to wait, in milliseconds
+ * @return the messages still queued (0 when all were delivered)
+ */
+int l2k_flush(l2k_t* handle, int timeout_ms);
+
+/**
+ * Load the schema configuration file again, ej. after a pattern change.
+ * The new configuration applies from the next entry; if it is not valid
+ * the current one is kept. May be called from any thread.
+ *
+ * @param handle the producer handle
+ * @return 0 on success, or -1 if the file was not valid (see the log)
+ */
+int l2k_reload(l2k_t* handle);
+
+/**
+ * Flush and destroy a producer. Waits up to the shutdown.timeout option
+ * for the queued messages, then spools the rest to the shutdown.spool file
+ * if set.
+ *
+ * @param handle the producer handle, may be NULL
+ */
+void l2k_close(l2k_t* handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LOG2KAFKA_L2K_H_ */
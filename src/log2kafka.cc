@@ -25,7 +25,24 @@
  * limitations under the License.
  */
 
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "ArchiveReader.hh"
 #include "ClientFacade.hh"
+#include "Daemon.hh"
+#include "FileSink.hh"
+#include "LineReader.hh"
+#include "MemoryBudget.hh"
+#include "MetricsServer.hh"
+#include "MultilineAssembler.hh"
+#include "Options.hh"
+#include "Reloader.hh"
+#include "Util.hh"
 
 #ifdef _LOG2KAFKA_USE_LOG4CXX_
 using namespace log4cxx;
@@ -35,14 +52,23 @@ LoggerPtr logger(Logger::getLogger(BUILD_NAME));
 #endif
 
 namespace po = boost::program_options;
-using namespace boost::filesystem;
 using namespace std;
 
 /* Forward function declaration */
 
 void parseArguments(int argc, char** argv, po::variables_map& vm);
-inline void validateArguments(const po::variables_map& vm);
 inline void debugArguments(const po::variables_map& vm);
+void sendStandardInput(Sink& proxy);
+void sendFiles(Sink& proxy, const vector<string>& paths, int threads);
+void handleStop();
+void requestStop(int signal);
+void requestDump(int signal);
+void requestReload(int signal);
+
+/**
+ * Stop request flag, set on SIGTERM and SIGINT.
+ */
+volatile sig_atomic_t stopRequested = 0;
 
 /**
  * Main function.
@@ -98,34 +124,85 @@ int main(int argc, char** argv) {
     /* Select action course route */
 
     try {
-        /* Prepare client connection proxy */
+        if (vm.count("connect")) { // thin client of a daemon
+            string declaration = vm["kafka.topic"].as<string>();
+
+            if (vm.count("schema")) declaration += "," + vm["schema"].as<string>();
+
+            Daemon::forward(vm["connect"].as<string>(), declaration);
+            return result;
+        }
+
+        /* Prepare client connection proxy, or the local files sink, within
+         * the memory budget */
+
+        MemoryBudget::limit(size_t(vm["memory.budget"].as<int>()) << 20);
+
+        unique_ptr<Sink> proxy;
+
+        if (vm["sink"].as<string>() == "file") {
+            proxy.reset(new FileSink());
+        }
+        else {
+            proxy.reset(new ClientFacade());
+        }
+
+        // The kafka client threads inherit the CPUs of this thread
+        cpu_set_t startCpus = Util::threadCpus();
+
+        if (vm.count("cpus.kafka")) Util::pinThread(Util::cpuSet(vm["cpus.kafka"].as<string>()));
 
-        auto proxy = unique_ptr<ClientFacade>(new ClientFacade());
         proxy->configure(vm);
 
-        /* Retrieve message to serialize */
+        if (vm.count("cpus.kafka")) Util::pinThread(startCpus);
+
+        /* Expose metrics, also dumped to stderr on SIGUSR1 */
+
+        MetricsServer metrics;
+        metrics.configure(vm);
+        signal(SIGUSR1, requestDump);
+
+        /* Reload the schema configuration files on SIGHUP */
+
+        Reloader reloader(*proxy);
+        reloader.start();
+        signal(SIGHUP, requestReload);
+
+        /* Stop the intake on SIGTERM/SIGINT, then drain the queue */
+
+        handleStop();
+
+        /* Retrieve message to serialize, once the sink is ready for the
+         * channels of the sources (the daemon creates them first) */
 
         string entry;
 
-        if (vm.count("message")) {
+        if (!vm.count("daemon")) {
+            if (vm.count("cpus.reader")) Util::pinThread(Util::cpuSet(vm["cpus.reader"].as<string>()));
+
+            proxy->warmUp();
+        }
+
+        if (vm.count("daemon")) {
+            Daemon daemon(*proxy);
+
+            daemon.configure(vm);
+            proxy->warmUp();
+            daemon.run();
+        }
+        else if (vm.count("message")) {
             entry = vm["message"].as<string>();
             proxy->sendMessage(entry);
         }
+        else if (vm.count("input")) {
+            sendFiles(*proxy, vm["input"].as<vector<string>>(), vm["input.threads"].as<int>());
+        }
         else { // read from standard input
             LOG_DEBUG("Read from standard input");
-
-            /* Read a buffer's worth of log file data, exiting on errors */
-
-            string line;
-
-            for (;;) {
-                getline(cin, line);
-
-                if (cin.fail()) break;
-
-                proxy->sendMessage(line);
-            }
+            sendStandardInput(*proxy);
         }
+
+        if (proxy->shutdown() > 0) result = EXIT_FAILURE;
     }
     catch (exception& e) {
         LOG_ERROR("Unexpected exception: " << e.what());
@@ -141,78 +218,12 @@ int main(int argc, char** argv) {
 
 void parseArguments(int argc, char** argv, po::variables_map& vm) {
 
-    po::options_description generic("Generic options");
-    po::options_description avroOptions("Avro options");
-    po::options_description kafkaOptions("Kafka options");
-
-    /* General options */
-
-    generic.add_options()
-    ("version", "display version number")
-    ("help,?", "produce help message")
-    ("config,f", po::value<std::string>(), "client configuration file path")
-    #ifdef _LOG2KAFKA_USE_LOG4CXX_
-    ("log-config,l", po::value<std::string>(), "log4cxx configuration file path")
-#else
-    ("verbose", "increase verbosity")
-    #endif
-    ("message,m", po::value<std::string>(),
-        "message to send - if not indicated then standard input is used");
-
-    /* Avro options */
-
-    avroOptions.add_options()
-    ("schema,s", po::value<std::string>(),
-        "Avro definitition file to use for serialization - if omitted the raw entry will be sent");
-
-    /* Kafka options */
-
-    kafkaOptions.add_options()
-    ("kafka.client.id,c", po::value<std::string>()->default_value(Constants::DEFAULT_CLIENT_ID),
-        "producer client name/id")
-    ("kafka.metadata.broker.list,b", po::value<std::string>(),
-        "A comma separated list of brokers:\n <host>[:<port>][,...]")
-    ("kafka.topic,t", po::value<std::string>(), "target topic: <topic_name>[:<partition>]")
-    ("kafka_topic.request.required.acks", po::value<int>())
-    ("kafka_topic.request.timeout.ms", po::value<int>())
-    ("kafka_topic.message.timeout.ms", po::value<int>())
-    ("kafka.key,k", po::value<string>(), "kafka message key to use")
-    ("kafka.codec,z", po::value<std::string>(), "Compression codec to use: gzip|snappy")
-    ("kafka.message.max.bytes", po::value<int>())
-    ("kafka.metadata.request.timeout.ms", po::value<int>())
-    ("kafka.topic.metadata.refresh.interval.ms", po::value<int>())
-    ("kafka.topic.metadata.refresh.fast.cnt", po::value<int>())
-    ("kafka.topic.metadata.refresh.fast.interval.ms", po::value<int>())
-    ("kafka.socket.timeout.ms", po::value<int>())
-    ("kafka.socket.send.buffer.bytes", po::value<int>())
-    ("kafka.socket.receive.buffer.bytes", po::value<int>())
-    ("kafka.broker.address.ttl", po::value<int>())
-    ("kafka.statistics.interval.ms", po::value<int>())
-    ("kafka.queued.min.messages", po::value<int>())
-    ("kafka.fetch.wait.max.ms", po::value<int>())
-    ("kafka.fetch.min.bytes", po::value<int>())
-    ("kafka.fetch.error.backoff.ms", po::value<int>())
-    ("kafka.queue.buffering.max.messages", po::value<int>())
-    ("kafka.queue.buffering.max.ms", po::value<int>())
-    ("kafka.message.send.max.retries", po::value<int>())
-    ("kafka.retry.backoff.ms", po::value<int>())
-    ("kafka.batch.num.messages", po::value<int>())
-    ("kafka.request.required.acks", po::value<int>())
-    ("kafka.request.timeout.ms", po::value<int>())
-    ("kafka.message.timeout.ms", po::value<int>())
-    ("kafka.debug", po::value<std::string>(),
-        "A comma-separated list of debug contexts to enable: all,generic,broker,topic,metadata,producer,queue,msg")
-        ;
-
-    po::options_description cmdline_options;
-    cmdline_options.add(generic).add(avroOptions).add(kafkaOptions);
-
     /*  Parse command line */
 
-    po::store(po::parse_command_line(argc, argv, cmdline_options), vm);
+    Options::parseCommandLine(argc, argv, vm);
 
     if (vm.count("help")) {
-        cout << cmdline_options;
+        cout << Options::commandLine();
         exit(EXIT_SUCCESS);
     }
     else if (vm.count("version")) {
@@ -222,42 +233,14 @@ void parseArguments(int argc, char** argv, po::variables_map& vm) {
 
     /* Parse config file */
 
-    if (vm.count("config")) {
-        path configFilePath(vm["config"].as<string>());
-        path configPath(Constants::DEFAULT_CONFIG_PATH);
-
-        if (!configFilePath.is_complete()) {
-            configFilePath = configPath / configFilePath;
-        }
-
-        if (exists(configFilePath)) {
-            ifstream configFile(configFilePath.string());
-
-            LOG_DEBUG("Reading additional options from: " << configFilePath);
-            po::store(po::parse_config_file(configFile, kafkaOptions), vm);
-        }
-        else {
-            LOG_WARN("The indicated configuration file '" << configFilePath << "' does not exist");
-        }
-    }
+    Options::parseConfigFile(vm);
 
     /* Validate arguments and prepare options map */
 
-    validateArguments(vm);
+    Options::validate(vm);
     po::notify(vm);
 }
 
-inline void validateArguments(const po::variables_map& vm) {
-
-    if (!vm.count("kafka.metadata.broker.list")) {
-        throw invalid_argument("'kafka.metadata.broker.list (-b)' argument was not set.");
-    }
-
-    if (!vm.count("kafka.topic")) {
-        throw invalid_argument("'kafka.topic (-t)' argument was not set.");
-    }
-}
-
 inline void debugArguments(const po::variables_map& vm) {
 
     if (Constants::IS_DEBUG_ENABLED) {
@@ -269,6 +252,13 @@ inline void debugArguments(const po::variables_map& vm) {
             if (typeid(int) == it->second.value().type()) {
                 buffer << it->second.as<int>();
             }
+            else if (typeid(vector<string>) == it->second.value().type()) {
+                const vector<string>& values = it->second.as<vector<string>>();
+
+                for (size_t i = 0; i < values.size(); ++i) {
+                    buffer << (i > 0 ? " " : "") << values[i];
+                }
+            }
             else {
                 buffer << it->second.as<string>();
             }
@@ -277,3 +267,127 @@ inline void debugArguments(const po::variables_map& vm) {
         LOG_DEBUG(buffer.str());
     }
 }
+
+void sendStandardInput(Sink& proxy) {
+
+    Channel* channel = proxy.defaultChannel();
+    string line;
+
+    if (channel == NULL || channel->multiline() == NULL) {
+
+        /* Read a buffer's worth of log file data, exiting on errors */
+
+        while (!stopRequested) {
+            getline(cin, line);
+
+            if (cin.fail()) break; // EOF, or interrupted by a stop request
+
+            proxy.sendMessage(line);
+        }
+
+        return;
+    }
+
+    /* Join the lines of each record, sending it when the next one starts or
+     * when no line arrives in time */
+
+    MultilineAssembler assembler(*channel->multiline());
+    LineReader reader(STDIN_FILENO, Constants::DEFAULT_READ_BUFFER_SIZE);
+    string record;
+
+    pollfd input;
+    input.fd = STDIN_FILENO;
+    input.events = POLLIN;
+
+    int timeout = channel->multiline()->timeout().count();
+
+    for (ssize_t count = 1; count != 0 && !stopRequested;) {
+        input.revents = 0;
+
+        int ready = poll(&input, 1, timeout);
+
+        if (ready < 0) {
+            if (errno == EINTR) continue; // ej. a stop request
+            break;
+        }
+
+        if (ready == 0) {
+            if (assembler.flush(record)) proxy.sendMessage(record);
+            continue;
+        }
+
+        count = reader.fill();
+
+        if (count < 0 && errno != EINTR && errno != EAGAIN) break;
+
+        while (reader.next(line)) {
+            if (assembler.add(line, record)) proxy.sendMessage(record);
+        }
+
+        if (count == 0 && reader.rest(line)) {
+            if (assembler.add(line, record)) proxy.sendMessage(record);
+        }
+    }
+
+    if (assembler.flush(record)) proxy.sendMessage(record);
+}
+
+void sendFiles(Sink& proxy, const vector<string>& paths, int threads) {
+
+    Channel* channel = proxy.defaultChannel();
+    unique_ptr<MultilineAssembler> assembler;
+
+    if (channel != NULL && channel->multiline() != NULL) {
+        assembler.reset(new MultilineAssembler(*channel->multiline()));
+    }
+
+    ArchiveReader reader(paths, threads, Constants::DEFAULT_READ_BUFFER_SIZE);
+    string line;
+    string record;
+
+    auto send = [&](string& entry) {
+        if (!assembler) {
+            proxy.sendMessage(entry);
+        }
+        else if (assembler->add(entry, record)) {
+            proxy.sendMessage(record);
+        }
+    };
+
+    /* Decompressed data is always available, no timeouts to honor */
+
+    for (ssize_t count = 1; count > 0 && !stopRequested;) {
+        count = reader.fill();
+
+        while (reader.next(line)) send(line);
+
+        if (count == 0 && reader.rest(line)) send(line);
+    }
+
+    if (assembler && assembler->flush(record)) proxy.sendMessage(record);
+}
+
+void handleStop() {
+    struct sigaction action;
+
+    // No SA_RESTART: a blocked read of the standard input is interrupted
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+}
+
+void requestStop(int signal) {
+    stopRequested = 1;
+    Daemon::stop();
+}
+
+void requestDump(int signal) {
+    MetricsServer::dump();
+}
+
+void requestReload(int signal) {
+    Reloader::request();
+}
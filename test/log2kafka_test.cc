@@ -0,0 +1,400 @@
+/**
+ * @file log2kafka_test.cc
+ * @brief Regression checks.
+ * @author Reinaldo Silva
+ * @version 1.0
+ * @date 2013
+ * @copyright Copyright 2013 Produban. All rights reserved.
+ * @copyright Licensed under the Apache License, Version 2.0
+ * @copyright http://www.apache.org/licenses/LICENSE-2.0
+ */
+
+/*
+ * Copyright 2013 Produban
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <avro/Compiler.hh>
+#include <avro/Generic.hh>
+
+#include "BuiltinFormat.hh"
+#include "Exceptions.hh"
+#include "FieldSplitter.hh"
+#include "Mapper.hh"
+#include "NetworkMap.hh"
+#include "Serializer.hh"
+#include "Throttle.hh"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+/**
+ * Record of three string columns.
+ */
+const char* const COLUMNS_SCHEMA =
+    "{\"type\": \"record\", \"name\": \"Columns\", \"fields\": ["
+    "{\"name\": \"a\", \"type\": \"string\"}, "
+    "{\"name\": \"b\", \"type\": \"string\"}, "
+    "{\"name\": \"c\", \"type\": \"string\"}]}";
+
+/**
+ * Record with the default sampling keep field.
+ */
+const char* const STATUS_SCHEMA =
+    "{\"type\": \"record\", \"name\": \"Status\", \"fields\": ["
+    "{\"name\": \"request\", \"type\": \"string\"}, "
+    "{\"name\": \"status\", \"type\": \"int\"}]}";
+
+/**
+ * Report a failed check.
+ */
+void check(bool condition, const string& description) {
+    if (!condition) {
+        cerr << "FAIL " << description << endl;
+        ++failures;
+    }
+}
+
+/**
+ * Split an entry into the three columns and compare them with the
+ * expected values.
+ */
+void checkSplit(const FieldSplitter& splitter, const string& entry, const string& a,
+    const string& b, const string& c) {
+
+    avro::GenericDatum datum(avro::compileJsonSchemaFromString(COLUMNS_SCHEMA));
+
+    try {
+        splitter.split(datum, entry);
+    }
+    catch (exception& e) {
+        cerr << "FAIL split(" << entry << "): " << e.what() << endl;
+        ++failures;
+        return;
+    }
+
+    const avro::GenericRecord& record = datum.value<avro::GenericRecord>();
+    const string values[] = { a, b, c };
+
+    for (size_t i = 0; i < 3; ++i) {
+        const string& value = record.fieldAt(i).value<string>();
+
+        if (value != values[i]) {
+            cerr << "FAIL split(" << entry << ") column " << i << ": '" << value
+                << "' instead of '" << values[i] << "'" << endl;
+            ++failures;
+        }
+    }
+}
+
+/**
+ * Quoted fields keep the delimiters they contain, with or without an
+ * escape character.
+ */
+void testQuotedDelimiter() {
+    FieldSplitter quoted(',', false);
+
+    quoted.quote('"');
+
+    for (size_t i = 0; i < 3; ++i) quoted.bind(i, i);
+
+    checkSplit(quoted, "1,\"a,b\",2", "1", "a,b", "2");
+    checkSplit(quoted, "\"a,\",x,y", "a,", "x", "y");
+
+    FieldSplitter escaped(',', false);
+
+    escaped.quote('"');
+    escaped.escape('\\');
+
+    for (size_t i = 0; i < 3; ++i) escaped.bind(i, i);
+
+    checkSplit(escaped, "1,\"a,\\\"b\",2", "1", "a,\"b", "2");
+    checkSplit(escaped, "a\\,b,c,d", "a,b", "c", "d");
+}
+
+/**
+ * The token bucket lets a burst through at once, and nothing more until
+ * it refills.
+ */
+void testTokenBucket() {
+    Throttle throttle;
+
+    throttle.rate(1);
+    throttle.burst(3);
+
+    for (int i = 0; i < 3; ++i) check(throttle.acquire(), "acquire() within the burst");
+
+    check(!throttle.acquire(), "acquire() over the burst");
+
+    Throttle unlimited;
+
+    for (int i = 0; i < 1000; ++i) {
+        if (!unlimited.acquire()) {
+            check(false, "acquire() without a rate");
+            break;
+        }
+    }
+}
+
+/**
+ * Once a window exceeds the threshold, one of every N lines is sampled,
+ * and lines with a status at or above the keep minimum are exempted.
+ */
+void testSampling() {
+    Mapper mapper;
+    istringstream schema(STATUS_SCHEMA);
+
+    avro::compileJsonSchema(schema, mapper);
+
+    Throttle throttle;
+
+    throttle.samplingThreshold(10);
+    throttle.samplingRate(4);
+    throttle.bind(mapper);
+
+    for (int i = 0; i < 100; ++i) throttle.acquire();
+
+    check(throttle.sample() && throttle.currentSampleRate() == 1, "sample() under the threshold");
+
+    // The window closes with the first line after one second
+    this_thread::sleep_for(chrono::milliseconds(1100));
+    throttle.acquire();
+
+    check(throttle.currentSampleRate() == 4, "currentSampleRate() over the threshold");
+
+    int sampled = 0;
+
+    for (int i = 0; i < 8; ++i) sampled += throttle.sample() ? 1 : 0;
+
+    check(sampled == 2, "sample() passes 1 in 4 lines");
+
+    size_t status;
+
+    check(mapper.fieldIndex("status", status), "fieldIndex(status)");
+
+    avro::GenericDatum datum(mapper);
+
+    mapper.assign(datum, status, "503");
+    check(throttle.keep(datum), "keep() of a 503 line");
+
+    mapper.assign(datum, status, "400");
+    check(throttle.keep(datum), "keep() of a 400 line");
+
+    mapper.assign(datum, status, "200");
+    check(!throttle.keep(datum), "keep() of a 200 line");
+}
+
+/**
+ * Map an entry with the built-in parser of a format and with the pattern
+ * it replaces, and compare the results.
+ */
+void checkFormat(const BuiltinFormat& format, Serializer& serializer, const string& entry) {
+    avro::GenericDatum parsed(serializer.mapper());
+    avro::GenericDatum matched(serializer.mapper());
+
+    bool isParsed = format.map(parsed, entry);
+    bool isMatched = true;
+
+    try {
+        serializer.mapper().map(matched, entry);
+    }
+    catch (MapperMatchException&) {
+        isMatched = false;
+    }
+
+    if (isParsed != isMatched) {
+        cerr << "FAIL " << format.name() << " parsed " << isParsed << ", matched "
+            << isMatched << ": " << entry << endl;
+        ++failures;
+        return;
+    }
+
+    if (!isParsed) return;
+
+    const avro::GenericRecord& a = parsed.value<avro::GenericRecord>();
+    const avro::GenericRecord& b = matched.value<avro::GenericRecord>();
+
+    for (size_t i = 0; i < a.fieldCount(); ++i) {
+        const string& value = a.fieldAt(i).value<string>();
+
+        if (value != b.fieldAt(i).value<string>()) {
+            cerr << "FAIL " << format.name() << " field " << i << ": '" << value
+                << "' instead of '" << b.fieldAt(i).value<string>() << "': " << entry << endl;
+            ++failures;
+        }
+    }
+}
+
+/**
+ * The built-in parsers accept the same entries as the patterns of their
+ * configuration files, and split them into the same fields.
+ */
+void testBuiltinFormats() {
+    const char* const names[] = { "apache-combined", "websphere", "liferay" };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        string name = names[i];
+        unique_ptr<BuiltinFormat> format(BuiltinFormat::create(name));
+        Serializer serializer(string(LOG2KAFKA_CONF_DIR) + "/" + name + ".conf");
+        ifstream corpus((string(LOG2KAFKA_CORPUS_DIR) + "/" + name + ".log").c_str());
+        string line;
+        size_t lines = 0;
+
+        if (!format) {
+            check(false, "create(" + name + ")");
+            continue;
+        }
+
+        while (getline(corpus, line)) {
+            checkFormat(*format, serializer, line);
+
+            // Cut short, most entries are in no format
+            checkFormat(*format, serializer, line.substr(0, line.length() / 2));
+            checkFormat(*format, serializer, line.substr(0, line.length() - 1));
+            ++lines;
+        }
+
+        check(lines > 0, "corpus of " + name);
+
+        checkFormat(*format, serializer, "");
+        checkFormat(*format, serializer, "x");
+    }
+
+    // The bracketed timestamp shape of the apache pattern
+    unique_ptr<BuiltinFormat> apache(BuiltinFormat::create("apache-combined"));
+    Serializer serializer(string(LOG2KAFKA_CONF_DIR) + "/apache-combined.conf");
+    const string request = " \"GET / HTTP/1.0\" 200 5 \"a\" \"b\"";
+    const char* const timestamps[] = {
+        "[12/Oct/2013:10:00:00 +0000]", "[12/Oct/2013 +0000]", "[1//2:3:4:5 +1]",
+        "[1/a/2:3:4:5 ++0]", "[1/a/2:3:4:5  -07]", "[1/a/b/2:3:4:5 +0]", "[1/a/2:3:4 +0]"
+    };
+
+    for (size_t i = 0; i < sizeof(timestamps) / sizeof(timestamps[0]); ++i) {
+        checkFormat(*apache, serializer, string("1.2.3.4 - - ") + timestamps[i] + request);
+    }
+}
+
+/**
+ * Add a network to a table, in the networks file notation.
+ */
+void insertNetwork(NetworkMap::Table& table, const string& address, size_t length,
+    const string& datacenter) {
+
+    uint8_t bytes[16];
+    NetworkMap::Network network;
+
+    network.datacenter = datacenter;
+
+    check(NetworkMap::parse(address.c_str(), bytes), "parse(" + address + ")");
+
+    // IPv4 prefixes are of the address mapped to IPv6
+    table.insert(bytes, (address.find(':') == string::npos ? 96 : 0) + length, network);
+}
+
+/**
+ * Look an address up and compare the datacenter of its network, empty
+ * if no network contains it.
+ */
+void checkLookup(const NetworkMap::Table& table, const string& address, const string& datacenter) {
+    uint8_t bytes[16];
+
+    check(NetworkMap::parse(address.c_str(), bytes), "parse(" + address + ")");
+
+    const NetworkMap::Network* network = table.lookup(bytes);
+    string found = network ? network->datacenter : "";
+
+    if (found != datacenter) {
+        cerr << "FAIL lookup(" << address << "): '" << found << "' instead of '"
+            << datacenter << "'" << endl;
+        ++failures;
+    }
+}
+
+/**
+ * The longest prefix wins, whatever the insertion order, and IPv4
+ * addresses match the IPv4-mapped IPv6 prefixes.
+ */
+void testNetworkLookup() {
+    NetworkMap::Table table(1);
+
+    // Inner prefixes first, so the outer ones split the trie edges
+    insertNetwork(table, "10.20.30.0", 24, "dmz");
+    insertNetwork(table, "10.20.0.0", 16, "mad2");
+    insertNetwork(table, "10.0.0.0", 8, "mad1");
+    insertNetwork(table, "10.20.30.128", 25, "edge");
+    insertNetwork(table, "192.168.0.0", 16, "bcn1");
+    insertNetwork(table, "2001:db8::", 32, "v6");
+    insertNetwork(table, "::ffff:172.16.0.0", 108, "mapped");
+
+    check(table.size() == 7, "size() of 7 networks");
+
+    checkLookup(table, "10.20.30.5", "dmz");
+    checkLookup(table, "10.20.30.200", "edge");
+    checkLookup(table, "10.20.31.1", "mad2");
+    checkLookup(table, "10.21.0.1", "mad1");
+    checkLookup(table, "11.0.0.1", "");
+    checkLookup(table, "192.168.255.255", "bcn1");
+    checkLookup(table, "192.169.0.0", "");
+    checkLookup(table, "172.16.4.1", "mapped");
+    checkLookup(table, "172.32.0.1", "");
+    checkLookup(table, "::ffff:10.20.30.5", "dmz");
+    checkLookup(table, "2001:db8:1::1", "v6");
+    checkLookup(table, "2001:db9::1", "");
+    checkLookup(table, "::a14:1e05", "");
+
+    // The same prefix again replaces the attributes
+    insertNetwork(table, "10.20.0.0", 16, "mad3");
+
+    check(table.size() == 7, "size() after replacing a network");
+    checkLookup(table, "10.20.31.1", "mad3");
+    checkLookup(table, "10.20.30.5", "dmz");
+
+    // A default route contains everything
+    insertNetwork(table, "::", 0, "any");
+
+    checkLookup(table, "11.0.0.1", "any");
+    checkLookup(table, "2001:db9::1", "any");
+    checkLookup(table, "10.20.30.200", "edge");
+}
+
+} // namespace
+
+int main() {
+    testQuotedDelimiter();
+    testTokenBucket();
+    testSampling();
+    testBuiltinFormats();
+    testNetworkLookup();
+
+    if (failures > 0) {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+
+    cout << "All checks passed" << endl;
+    return 0;
+}